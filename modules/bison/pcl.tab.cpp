@@ -76,9 +76,23 @@
     #include <typeinfo>
     #include <type_traits>
     #include <chrono>
+    #include <algorithm>
 
     #include "pcl_bison.hpp"
     #include "../paracl/memory_manager.hpp"
+    #include "../paracl/vm.hpp"
+    #include "../paracl/regvm.hpp"
+    #include "../paracl/jit.hpp"
+    #include "../paracl/cgen.hpp"
+    #include "../paracl/closure.hpp"
+    #include "../paracl/tracejit.hpp"
+    #include "../paracl/tier.hpp"
+    #include "../paracl/llvm_jit.hpp"
+    #include "../paracl/ssa.hpp"
+    #include "../paracl/passes.hpp"
+    #include "../paracl/specialize.hpp"
+    #include "../paracl/profile.hpp"
+    #include "../paracl/range.hpp"
 
     #include <boost/program_options.hpp>
     namespace po = boost::program_options;
@@ -88,6 +102,7 @@
     using std::chrono::duration_cast;
     using std::chrono::high_resolution_clock;
     using std::chrono::milliseconds;
+    using std::chrono::nanoseconds;
    
     extern int yylineno;
     extern int yylex();
@@ -102,7 +117,7 @@
     
 
 
-#line 106 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 121 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -628,13 +643,13 @@ static const yytype_int8 yytranslate[] =
 
 #if YYDEBUG
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
-static const yytype_int8 yyrline[] =
+static const yytype_uint8 yyrline[] =
 {
-       0,    52,    52,    55,    58,    59,    62,    63,    65,    66,
-      67,    68,    71,    72,    73,    76,    78,    78,    80,    81,
-      82,    84,    85,    86,    89,    90,    91,    92,    93,    94,
-      95,    98,    99,   100,   103,   104,   105,   106,   109,   111,
-     112,   113,   114,   115,   116,   117,   118,   119
+       0,    67,    67,    70,    73,    74,    77,    78,    80,    81,
+      82,    83,    86,    87,    88,    91,    93,    93,    95,    96,
+      97,    99,   100,   101,   104,   105,   106,   107,   108,   109,
+     110,   113,   114,   115,   118,   119,   120,   121,   124,   126,
+     127,   128,   129,   130,   131,   132,   133,   134
 };
 #endif
 
@@ -1249,235 +1264,235 @@ yyreduce:
   switch (yyn)
     {
   case 3: /* BLOCK: OPS  */
-#line 55 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 70 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { tmp = new ptree::Block(std::move(*(yyvsp[0].blk))); delete (yyvsp[0].blk); tmp->update_blk_info(offset++, blk_num++); blocks.push_back(tmp); (yyval.blk) = tmp;}
-#line 1255 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1270 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 4: /* OPS: OP  */
-#line 58 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 73 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         {tmp = new ptree::Block(); tmp->push_expression((yyvsp[0].oper)); (yyval.blk) = tmp;}
-#line 1261 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1276 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 5: /* OPS: OPS OP  */
-#line 59 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 74 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         {tmp = new ptree::Block(std::move(*(yyvsp[-1].blk))); delete (yyvsp[-1].blk); tmp->push_expression((yyvsp[0].oper)); (yyval.blk) = tmp;}
-#line 1267 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1282 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 6: /* SCOPE: LCB RCB  */
-#line 62 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 77 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.blk) = new ptree::Block();}
-#line 1273 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1288 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 7: /* SCOPE: LCB BLOCK RCB  */
-#line 63 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 78 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.blk) = (yyvsp[-1].blk); }
-#line 1279 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1294 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 8: /* OP1: SCOPE  */
-#line 65 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 80 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           {(yyval.oper) = (yyvsp[0].blk);}
-#line 1285 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1300 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 9: /* OP1: EXPR SEQUENCE  */
-#line 66 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 81 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.oper) = new ptree::Expression(nullptr, (yyvsp[-1].oper));}
-#line 1291 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1306 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 10: /* OP1: IF LPAR COND RPAR OP1 ELSE OP1  */
-#line 67 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 82 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.oper) = new ptree::IfBlk((yyvsp[-4].cnd), nullptr, wrap_block((yyvsp[0].oper)), wrap_block((yyvsp[-2].oper)));}
-#line 1297 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1312 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 11: /* OP1: WHILE LPAR COND RPAR OP1  */
-#line 68 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 83 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.oper) = new ptree::WhileBlk((yyvsp[-2].cnd), nullptr, wrap_block((yyvsp[0].oper)));}
-#line 1303 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1318 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 12: /* OP2: IF LPAR COND RPAR OP  */
-#line 71 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 86 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.oper) = new ptree::IfBlk((yyvsp[-2].cnd), nullptr, nullptr, wrap_block((yyvsp[0].oper))); }
-#line 1309 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1324 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 13: /* OP2: IF LPAR COND RPAR OP1 ELSE OP2  */
-#line 72 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 87 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.oper) = new ptree::IfBlk((yyvsp[-4].cnd), nullptr, wrap_block((yyvsp[0].oper)), wrap_block((yyvsp[-2].oper))); }
-#line 1315 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1330 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 14: /* OP2: WHILE LPAR COND RPAR OP2  */
-#line 73 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 88 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.oper) = new ptree::WhileBlk((yyvsp[-2].cnd), nullptr, wrap_block((yyvsp[0].oper))); }
-#line 1321 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1336 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 15: /* COND: EXPR  */
-#line 76 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 91 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           {(yyval.cnd) = new ptree::Condition(nullptr, (yyvsp[0].oper));}
-#line 1327 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1342 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 19: /* EXPR: VAR ASSIGN EXPR  */
-#line 81 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 96 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                          { (yyval.oper) = new ptree::Assign(nullptr, (yyvsp[-2].lval), (yyvsp[0].oper)); }
-#line 1333 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1348 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 20: /* EXPR: PRINT EXPR  */
-#line 82 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 97 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                          { (yyval.oper) = new ptree::Output(nullptr, (yyvsp[0].oper));}
-#line 1339 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1354 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 22: /* EXPR1: EXPR1 AND EXPR2  */
-#line 85 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 100 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                        { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::LOG_AND, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1345 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1360 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 23: /* EXPR1: EXPR1 OR EXPR2  */
-#line 86 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 101 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                        { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::LOG_OR, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1351 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1366 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 25: /* EXPR2: EXPR2 EQ EXPR3  */
-#line 90 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 105 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::EQUAL, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper));}
-#line 1357 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1372 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 26: /* EXPR2: EXPR2 LE EXPR3  */
-#line 91 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 106 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::LESS_EQUAL, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1363 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1378 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 27: /* EXPR2: EXPR2 GE EXPR3  */
-#line 92 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 107 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::MORE_EQUAL, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper));}
-#line 1369 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1384 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 28: /* EXPR2: EXPR2 NE EXPR3  */
-#line 93 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 108 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::NON_EQUAL, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper));}
-#line 1375 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1390 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 29: /* EXPR2: EXPR2 GREAT EXPR3  */
-#line 94 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 109 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::MORE, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1381 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1396 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 30: /* EXPR2: EXPR2 LESS EXPR3  */
-#line 95 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 110 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::LESS, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1387 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1402 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 32: /* EXPR3: EXPR3 PLUS TERM  */
-#line 99 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 114 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                          { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::ADDITION, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1393 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1408 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 33: /* EXPR3: EXPR3 MINUS TERM  */
-#line 100 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 115 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                           { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::SUBTRACTION, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1399 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1414 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 35: /* TERM: TERM MUL VAL  */
-#line 104 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 119 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::MULTIPLICATION, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1405 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1420 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 36: /* TERM: TERM DIV VAL  */
-#line 105 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 120 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::DIVISION, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper)); }
-#line 1411 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1426 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 37: /* TERM: TERM MOD VAL  */
-#line 106 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 121 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::BinOp(ptree::BinOpType::REMAINDER, nullptr, (yyvsp[-2].oper), (yyvsp[0].oper));}
-#line 1417 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1432 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 38: /* VAR: ID  */
-#line 109 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 124 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.lval) = new ptree::NameInt(nullptr, 0, (yyvsp[0].str));}
-#line 1423 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1438 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 39: /* VAL: NUM  */
-#line 111 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 126 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::Imidiate<int>(nullptr, std::stoi((yyvsp[0].str)));}
-#line 1429 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1444 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 40: /* VAL: INPUT  */
-#line 112 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 127 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::Reserved(nullptr, ptree::Reserved::Types::Input);}
-#line 1435 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1450 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 41: /* VAL: MINUS VAR  */
-#line 113 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 128 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::UnOp(ptree::UnOpType::MINUS, nullptr, (yyvsp[0].lval));}
-#line 1441 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1456 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 42: /* VAL: MINUS NUM  */
-#line 114 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 129 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::Imidiate<int>(nullptr, -std::stoi((yyvsp[0].str)));}
-#line 1447 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1462 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 43: /* VAL: NOT VAL  */
-#line 115 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 130 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::UnOp(ptree::UnOpType::NOT, nullptr, (yyvsp[0].oper)); }
-#line 1453 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1468 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 44: /* VAL: VAR P_PLUS  */
-#line 116 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 131 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::UnOp(ptree::UnOpType::POST_ADDITION, nullptr, (yyvsp[-1].lval)); }
-#line 1459 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1474 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 45: /* VAL: VAR P_MINUS  */
-#line 117 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 132 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = new ptree::UnOp(ptree::UnOpType::POST_SUBTRACTION, nullptr, (yyvsp[-1].lval)); }
-#line 1465 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1480 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 46: /* VAL: LPAR EXPR RPAR  */
-#line 118 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 133 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = (yyvsp[-1].oper); }
-#line 1471 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1486 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
   case 47: /* VAL: VAR  */
-#line 119 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 134 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
                                         { (yyval.oper) = (yyvsp[0].lval);}
-#line 1477 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1492 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
     break;
 
 
-#line 1481 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
+#line 1496 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.tab.cpp"
 
       default: break;
     }
@@ -1670,7 +1685,7 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 126 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
+#line 141 "/home/ilya/Документы/GitHub/ParaCL/modules/bison/pcl.y"
 
 
 
@@ -1686,6 +1701,28 @@ int main(int ac, char* av[]) {
         ("dump-tree, d", "dumps built tree to file default: out.dot")
         ("dump-out", po::value<std::string>(), "sets output file name")
         ("time-stamp", "makes time measurements on building and execution")
+        ("engine", po::value<std::string>()->default_value("tree"), "execution engine: tree, vm, supervm, regvm, closure, tiered")
+        ("jit", "compiles program to native code, falls back to the engine if it is not possible")
+        ("llvm", "compiles program with LLVM ORC JIT, falls back to the engine if LLVM is not available")
+        ("llvm-opt", po::value<int>()->default_value(2), "optimization level of LLVM backend: 0, 1, 2 or 3")
+        ("emit-llvm", po::value<std::string>(), "writes optimized LLVM IR to given file when llvm option is used")
+        ("trace-jit", "records and compiles hot while loops to native code in tree engine")
+        ("trace-threshold", po::value<long>()->default_value(1000), "loop iterations before trace recording")
+        ("tier-threshold", po::value<long>()->default_value(100), "block executions or loop iterations before compilation in tiered engine")
+        ("emit-c", po::value<std::string>(), "translates program to C and writes it to given file without execution")
+        ("native", "compiles program to C with system compiler and runs native code")
+        ("opcode-profile", po::value<std::string>(), "runs program on vm (or supervm) engine and adds opcode n-gram histogram to given file")
+        ("ngram", po::value<int>()->default_value(2), "length of opcode sequences in opcode-profile histogram")
+        ("dump-bytecode", "prints compiled bytecode when vm, supervm or regvm engine is used")
+        ("dump-ssa", "prints SSA form of program after optimization passes")
+        ("dump-ranges", "prints divisions which can trap and operations which can wrap around after optimization passes")
+        ("optimize,O", po::value<int>()->default_value(0), "optimization level: 0, 1 or 2")
+        ("passes", po::value<std::string>(), ("comma separated list of passes instead of optimization level: " + ptree::pass_names()).c_str())
+        ("time-passes", "prints wall time and tree size before and after each pass")
+        ("specialize", po::value<std::string>(), "treats numbers from given file as first inputs, writes residual program without execution")
+        ("specialize-out", po::value<std::string>(), "sets residual program file name default: out.pcl")
+        ("profile-generate", po::value<std::string>(), "runs program without passes and adds branch, loop and operand counts to given file")
+        ("profile-use", po::value<std::string>(), "reorders branches, specialises statements and unrolls loops with profile from given file")
         ("input-file", po::value<std::string>(), "input file")
     ;
     po::positional_options_description p;
@@ -1713,6 +1750,38 @@ int main(int ac, char* av[]) {
     }
     
 
+    std::string engine = vm["engine"].as<std::string>();
+    if (engine != "tree" && engine != "vm" && engine != "supervm" && engine != "regvm" && engine != "closure"
+        && engine != "tiered")
+        throw std::invalid_argument("unknown engine: " + engine);
+
+    if (vm.count("trace-jit")) {
+        if (engine != "tree")
+            throw std::invalid_argument("trace-jit is supported only by tree engine");
+        ptree::LoopTrace::threshold = std::max(vm["trace-threshold"].as<long>(), 1L);
+    }
+
+    if (engine == "tiered")
+        ptree::TierManager::threshold = std::max(vm["tier-threshold"].as<long>(), 1L);
+
+    ptree::PassManager passmanager;
+    if (vm.count("passes"))
+        passmanager.parse(vm["passes"].as<std::string>());
+    else if (vm.count("specialize") && vm["optimize"].defaulted())
+        passmanager.add_level(2);
+    else
+        passmanager.add_level(vm["optimize"].as<int>());
+
+    std::vector<int> known_inputs;
+    if (vm.count("specialize")) {
+        std::ifstream inputs_in(vm["specialize"].as<std::string>());
+        if (!inputs_in)
+            throw std::invalid_argument("can not open inputs file: " + vm["specialize"].as<std::string>());
+        int value;
+        while (inputs_in >> value)
+            known_inputs.push_back(value);
+    }
+
     if (!vm.count("input-file")) {
         std::cout << "No input file provided" << std::endl;
         return -1;
@@ -1721,14 +1790,117 @@ int main(int ac, char* av[]) {
     if ((fh = fopen(vm["input-file"].as<std::string>().c_str(), "r"))) yyin = fh;
     auto tstart = high_resolution_clock::now();
     int res = yyparse();
+    // ids of parsed tree are the same for every parse of the program
+    std::map<const ptree::PTree *, int> nodeids = ptree::number_nodes(blocks.back());
+    ptree::Specializer specializer(known_inputs);
+    if (vm.count("specialize"))
+        specializer.bind(blocks.back());
     ptree::MemManager  memfunc = ptree::manage_tree_mem(blocks.back());
+    int stacksize = memfunc.getmaxstacksize();
+    if (vm.count("profile-generate")) {
+        // counts are accumulated over several runs, like opcode histogram
+        std::string profile_file = vm["profile-generate"].as<std::string>();
+        ptree::Profile profile;
+        std::ifstream profile_in(profile_file);
+        profile.load(profile_in);
+        profile_in.close();
+        ptree::Stack profilestack{stacksize};
+        ptree::Profiler profiler(profile, nodeids);
+        profiler.run(blocks.back(), &profilestack);
+        std::ofstream profile_out(profile_file, std::ios::out);
+        profile.save(profile_out);
+        return 0;
+    }
+    if (vm.count("profile-use")) {
+        std::ifstream profile_in(vm["profile-use"].as<std::string>());
+        if (!profile_in)
+            throw std::invalid_argument("can not open profile file: " + vm["profile-use"].as<std::string>());
+        ptree::Profile profile;
+        profile.load(profile_in);
+        ptree::ProfileGuide guide(profile, nodeids);
+        guide.run(blocks.back());
+        if (opt_time)
+            std::cout << guide.report() << std::endl;
+    }
+    blocks.back() = passmanager.run(blocks.back(), stacksize);
+    if (vm.count("dump-ssa")) {
+        try {
+            std::cout << ptree::ssa::compile_tree(blocks.back()).dump();
+        } catch (std::logic_error &e) {
+            std::cout << "SSA is not built: " << e.what() << std::endl;
+        }
+    }
+    if (vm.count("dump-ranges")) {
+        try {
+            ptree::ssa::Function function = ptree::ssa::compile_tree(blocks.back());
+            ptree::ssa::RangeAnalysis analysis(function);
+            analysis.run();
+            std::cout << "Divisions which can not trap: " << analysis.getsafe() << " of " << analysis.getdivisions()
+                << ", operations which can not wrap: " << analysis.getnowrap() << " of " << analysis.getarithmetic()
+                << std::endl << analysis.report();
+        } catch (std::logic_error &e) {
+            std::cout << "SSA is not built: " << e.what() << std::endl;
+        }
+    }
+    if (vm.count("specialize")) {
+        std::string out = "out.pcl";
+        if (vm.count("specialize-out")) out = vm["specialize-out"].as<std::string>();
+        std::string residual = specializer.residual(blocks.back(), stacksize);
+        std::ofstream pcl_out(out, std::ios::out);
+        pcl_out << residual;
+        if (vm.count("time-passes"))
+            passmanager.report(std::cout);
+        return 0;
+    }
+    ptree::bytecode::Program program;
+    ptree::regcode::Program regprogram;
+    if (engine == "vm" || engine == "supervm" || vm.count("opcode-profile"))
+        program = ptree::bytecode::compile_tree(blocks.back());
+    if (engine == "supervm")
+        program = ptree::bytecode::fuse_superinstructions(program);
+    if (engine == "regvm")
+        regprogram = ptree::regcode::compile_tree(blocks.back());
+    ptree::closure::Stmt closureprogram;
+    if (engine == "closure")
+        closureprogram = ptree::closure::compile_tree(blocks.back());
+    ptree::JitCompiler jitcompiler;
+    std::unique_ptr<ptree::JitCode> jitcode;
+    if (vm.count("jit"))
+        jitcode = jitcompiler.compile(blocks.back());
+    ptree::LlvmCompiler llvmcompiler(vm["llvm-opt"].as<int>());
+    std::unique_ptr<ptree::LlvmCode> llvmcode;
+    if (vm.count("llvm")) {
+        llvmcode = llvmcompiler.compile(blocks.back());
+        if (vm.count("emit-llvm")) {
+            std::ofstream ir_out(vm["emit-llvm"].as<std::string>(), std::ios::out);
+            ir_out << llvmcompiler.getir();
+        }
+    }
+    std::unique_ptr<ptree::NativeCode> nativecode;
+    if (vm.count("emit-c") || vm.count("native")) {
+        ptree::CEmitter cemitter;
+        std::string csource = cemitter.emit(blocks.back());
+        if (vm.count("emit-c")) {
+            std::ofstream c_out(vm["emit-c"].as<std::string>(), std::ios::out);
+            c_out << csource;
+        }
+        if (vm.count("native"))
+            nativecode.reset(new ptree::NativeCode(csource));
+    }
     auto tfin = high_resolution_clock::now();
     
     if (opt_time) {
         std::cout << "Build finished, elapsed time: " << duration_cast<milliseconds>(tfin - tstart).count()
            << " ms" << std::endl;
+        if (vm.count("jit") && !jitcode)
+            std::cout << "JIT is not used: " << jitcompiler.geterror() << std::endl;
+        if (vm.count("llvm") && !llvmcode)
+            std::cout << "LLVM is not used: " << llvmcompiler.geterror() << std::endl;
     }
 
+    if (vm.count("time-passes"))
+        passmanager.report(std::cout);
+
     if (vm.count("dump-tree")) {
         std::string dump = "digraph G {\n";
         dump += (blocks.back())->dump();
@@ -1744,19 +1916,68 @@ int main(int ac, char* av[]) {
 
     }
     
+    if (vm.count("dump-bytecode")) {
+        if (engine == "vm" || engine == "supervm")
+            std::cout << program.dump();
+        else if (engine == "regvm")
+            std::cout << regprogram.dump();
+    }
+
     if (vm.count("build")) {
         std::cout << "Build finished, no error catched" << std::endl;
         return 0;
     } 
 
+    if (vm.count("emit-c") && !vm.count("native"))
+        return 0;
+
     tstart = high_resolution_clock::now();
-    ptree::Stack* stack = new ptree::Stack{memfunc.getmaxstacksize()};
-    (blocks.back())->execute(stack);
+    ptree::Stack* stack = new ptree::Stack{stacksize};
+    if (vm.count("opcode-profile")) {
+        // histogram is accumulated over several runs to profile a corpus of programs
+        std::string profile_file = vm["opcode-profile"].as<std::string>();
+        ptree::OpcodeProfile profile(vm["ngram"].as<int>());
+        std::ifstream profile_in(profile_file);
+        profile.load(profile_in);
+        profile_in.close();
+        ptree::StackVM machine;
+        machine.run(program, stack, profile);
+        std::ofstream profile_out(profile_file, std::ios::out);
+        profile.save(profile_out);
+    } else if (nativecode) {
+        nativecode->run();
+    } else if (llvmcode) {
+        llvmcode->run(stack);
+    } else if (jitcode) {
+        jitcode->run(stack);
+    } else if (engine == "vm" || engine == "supervm") {
+        ptree::StackVM machine;
+        machine.run(program, stack);
+    } else if (engine == "regvm") {
+        ptree::RegisterVM machine;
+        machine.run(regprogram, stack);
+    } else if (engine == "closure") {
+        closureprogram(stack);
+    } else if (engine == "tiered") {
+        ptree::TierManager tiers;
+        tiers.run(blocks.back(), stack);
+    } else if (vm.count("trace-jit")) {
+        ptree::TraceEngine tracer;
+        tracer.run(blocks.back(), stack);
+    } else {
+        (blocks.back())->execute(stack);
+    }
     tfin = high_resolution_clock::now();
+    ptree::TierManager::wait();
 
     if (opt_time) {
         std::cout << "Execute finished, elapsed time: " << duration_cast<milliseconds>(tfin - tstart).count()
             << " ms" << std::endl;
+        if (engine == "tiered")
+            ptree::TierManager::report(std::cout, duration_cast<nanoseconds>(tfin - tstart).count());
+        if (vm.count("trace-jit"))
+            std::cout << "Traces compiled: " << ptree::LoopTrace::traces << ", side traces: "
+                << ptree::LoopTrace::sidetraces << ", failed: " << ptree::LoopTrace::failed << std::endl;
     }
 
     delete stack;
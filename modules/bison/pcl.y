@@ -6,9 +6,23 @@
     #include <typeinfo>
     #include <type_traits>
     #include <chrono>
+    #include <algorithm>
 
     #include "pcl_bison.hpp"
     #include "../paracl/memory_manager.hpp"
+    #include "../paracl/vm.hpp"
+    #include "../paracl/regvm.hpp"
+    #include "../paracl/jit.hpp"
+    #include "../paracl/cgen.hpp"
+    #include "../paracl/closure.hpp"
+    #include "../paracl/tracejit.hpp"
+    #include "../paracl/tier.hpp"
+    #include "../paracl/llvm_jit.hpp"
+    #include "../paracl/ssa.hpp"
+    #include "../paracl/passes.hpp"
+    #include "../paracl/specialize.hpp"
+    #include "../paracl/profile.hpp"
+    #include "../paracl/range.hpp"
 
     #include <boost/program_options.hpp>
     namespace po = boost::program_options;
@@ -18,6 +32,7 @@
     using std::chrono::duration_cast;
     using std::chrono::high_resolution_clock;
     using std::chrono::milliseconds;
+    using std::chrono::nanoseconds;
    
     extern int yylineno;
     extern int yylex();
@@ -138,6 +153,28 @@ int main(int ac, char* av[]) {
         ("dump-tree, d", "dumps built tree to file default: out.dot")
         ("dump-out", po::value<std::string>(), "sets output file name")
         ("time-stamp", "makes time measurements on building and execution")
+        ("engine", po::value<std::string>()->default_value("tree"), "execution engine: tree, vm, supervm, regvm, closure, tiered")
+        ("jit", "compiles program to native code, falls back to the engine if it is not possible")
+        ("llvm", "compiles program with LLVM ORC JIT, falls back to the engine if LLVM is not available")
+        ("llvm-opt", po::value<int>()->default_value(2), "optimization level of LLVM backend: 0, 1, 2 or 3")
+        ("emit-llvm", po::value<std::string>(), "writes optimized LLVM IR to given file when llvm option is used")
+        ("trace-jit", "records and compiles hot while loops to native code in tree engine")
+        ("trace-threshold", po::value<long>()->default_value(1000), "loop iterations before trace recording")
+        ("tier-threshold", po::value<long>()->default_value(100), "block executions or loop iterations before compilation in tiered engine")
+        ("emit-c", po::value<std::string>(), "translates program to C and writes it to given file without execution")
+        ("native", "compiles program to C with system compiler and runs native code")
+        ("opcode-profile", po::value<std::string>(), "runs program on vm (or supervm) engine and adds opcode n-gram histogram to given file")
+        ("ngram", po::value<int>()->default_value(2), "length of opcode sequences in opcode-profile histogram")
+        ("dump-bytecode", "prints compiled bytecode when vm, supervm or regvm engine is used")
+        ("dump-ssa", "prints SSA form of program after optimization passes")
+        ("dump-ranges", "prints divisions which can trap and operations which can wrap around after optimization passes")
+        ("optimize,O", po::value<int>()->default_value(0), "optimization level: 0, 1 or 2")
+        ("passes", po::value<std::string>(), ("comma separated list of passes instead of optimization level: " + ptree::pass_names()).c_str())
+        ("time-passes", "prints wall time and tree size before and after each pass")
+        ("specialize", po::value<std::string>(), "treats numbers from given file as first inputs, writes residual program without execution")
+        ("specialize-out", po::value<std::string>(), "sets residual program file name default: out.pcl")
+        ("profile-generate", po::value<std::string>(), "runs program without passes and adds branch, loop and operand counts to given file")
+        ("profile-use", po::value<std::string>(), "reorders branches, specialises statements and unrolls loops with profile from given file")
         ("input-file", po::value<std::string>(), "input file")
     ;
     po::positional_options_description p;
@@ -165,6 +202,38 @@ int main(int ac, char* av[]) {
     }
     
 
+    std::string engine = vm["engine"].as<std::string>();
+    if (engine != "tree" && engine != "vm" && engine != "supervm" && engine != "regvm" && engine != "closure"
+        && engine != "tiered")
+        throw std::invalid_argument("unknown engine: " + engine);
+
+    if (vm.count("trace-jit")) {
+        if (engine != "tree")
+            throw std::invalid_argument("trace-jit is supported only by tree engine");
+        ptree::LoopTrace::threshold = std::max(vm["trace-threshold"].as<long>(), 1L);
+    }
+
+    if (engine == "tiered")
+        ptree::TierManager::threshold = std::max(vm["tier-threshold"].as<long>(), 1L);
+
+    ptree::PassManager passmanager;
+    if (vm.count("passes"))
+        passmanager.parse(vm["passes"].as<std::string>());
+    else if (vm.count("specialize") && vm["optimize"].defaulted())
+        passmanager.add_level(2);
+    else
+        passmanager.add_level(vm["optimize"].as<int>());
+
+    std::vector<int> known_inputs;
+    if (vm.count("specialize")) {
+        std::ifstream inputs_in(vm["specialize"].as<std::string>());
+        if (!inputs_in)
+            throw std::invalid_argument("can not open inputs file: " + vm["specialize"].as<std::string>());
+        int value;
+        while (inputs_in >> value)
+            known_inputs.push_back(value);
+    }
+
     if (!vm.count("input-file")) {
         std::cout << "No input file provided" << std::endl;
         return -1;
@@ -173,14 +242,117 @@ int main(int ac, char* av[]) {
     if ((fh = fopen(vm["input-file"].as<std::string>().c_str(), "r"))) yyin = fh;
     auto tstart = high_resolution_clock::now();
     int res = yyparse();
+    // ids of parsed tree are the same for every parse of the program
+    std::map<const ptree::PTree *, int> nodeids = ptree::number_nodes(blocks.back());
+    ptree::Specializer specializer(known_inputs);
+    if (vm.count("specialize"))
+        specializer.bind(blocks.back());
     ptree::MemManager  memfunc = ptree::manage_tree_mem(blocks.back());
+    int stacksize = memfunc.getmaxstacksize();
+    if (vm.count("profile-generate")) {
+        // counts are accumulated over several runs, like opcode histogram
+        std::string profile_file = vm["profile-generate"].as<std::string>();
+        ptree::Profile profile;
+        std::ifstream profile_in(profile_file);
+        profile.load(profile_in);
+        profile_in.close();
+        ptree::Stack profilestack{stacksize};
+        ptree::Profiler profiler(profile, nodeids);
+        profiler.run(blocks.back(), &profilestack);
+        std::ofstream profile_out(profile_file, std::ios::out);
+        profile.save(profile_out);
+        return 0;
+    }
+    if (vm.count("profile-use")) {
+        std::ifstream profile_in(vm["profile-use"].as<std::string>());
+        if (!profile_in)
+            throw std::invalid_argument("can not open profile file: " + vm["profile-use"].as<std::string>());
+        ptree::Profile profile;
+        profile.load(profile_in);
+        ptree::ProfileGuide guide(profile, nodeids);
+        guide.run(blocks.back());
+        if (opt_time)
+            std::cout << guide.report() << std::endl;
+    }
+    blocks.back() = passmanager.run(blocks.back(), stacksize);
+    if (vm.count("dump-ssa")) {
+        try {
+            std::cout << ptree::ssa::compile_tree(blocks.back()).dump();
+        } catch (std::logic_error &e) {
+            std::cout << "SSA is not built: " << e.what() << std::endl;
+        }
+    }
+    if (vm.count("dump-ranges")) {
+        try {
+            ptree::ssa::Function function = ptree::ssa::compile_tree(blocks.back());
+            ptree::ssa::RangeAnalysis analysis(function);
+            analysis.run();
+            std::cout << "Divisions which can not trap: " << analysis.getsafe() << " of " << analysis.getdivisions()
+                << ", operations which can not wrap: " << analysis.getnowrap() << " of " << analysis.getarithmetic()
+                << std::endl << analysis.report();
+        } catch (std::logic_error &e) {
+            std::cout << "SSA is not built: " << e.what() << std::endl;
+        }
+    }
+    if (vm.count("specialize")) {
+        std::string out = "out.pcl";
+        if (vm.count("specialize-out")) out = vm["specialize-out"].as<std::string>();
+        std::string residual = specializer.residual(blocks.back(), stacksize);
+        std::ofstream pcl_out(out, std::ios::out);
+        pcl_out << residual;
+        if (vm.count("time-passes"))
+            passmanager.report(std::cout);
+        return 0;
+    }
+    ptree::bytecode::Program program;
+    ptree::regcode::Program regprogram;
+    if (engine == "vm" || engine == "supervm" || vm.count("opcode-profile"))
+        program = ptree::bytecode::compile_tree(blocks.back());
+    if (engine == "supervm")
+        program = ptree::bytecode::fuse_superinstructions(program);
+    if (engine == "regvm")
+        regprogram = ptree::regcode::compile_tree(blocks.back());
+    ptree::closure::Stmt closureprogram;
+    if (engine == "closure")
+        closureprogram = ptree::closure::compile_tree(blocks.back());
+    ptree::JitCompiler jitcompiler;
+    std::unique_ptr<ptree::JitCode> jitcode;
+    if (vm.count("jit"))
+        jitcode = jitcompiler.compile(blocks.back());
+    ptree::LlvmCompiler llvmcompiler(vm["llvm-opt"].as<int>());
+    std::unique_ptr<ptree::LlvmCode> llvmcode;
+    if (vm.count("llvm")) {
+        llvmcode = llvmcompiler.compile(blocks.back());
+        if (vm.count("emit-llvm")) {
+            std::ofstream ir_out(vm["emit-llvm"].as<std::string>(), std::ios::out);
+            ir_out << llvmcompiler.getir();
+        }
+    }
+    std::unique_ptr<ptree::NativeCode> nativecode;
+    if (vm.count("emit-c") || vm.count("native")) {
+        ptree::CEmitter cemitter;
+        std::string csource = cemitter.emit(blocks.back());
+        if (vm.count("emit-c")) {
+            std::ofstream c_out(vm["emit-c"].as<std::string>(), std::ios::out);
+            c_out << csource;
+        }
+        if (vm.count("native"))
+            nativecode.reset(new ptree::NativeCode(csource));
+    }
     auto tfin = high_resolution_clock::now();
     
     if (opt_time) {
         std::cout << "Build finished, elapsed time: " << duration_cast<milliseconds>(tfin - tstart).count()
            << " ms" << std::endl;
+        if (vm.count("jit") && !jitcode)
+            std::cout << "JIT is not used: " << jitcompiler.geterror() << std::endl;
+        if (vm.count("llvm") && !llvmcode)
+            std::cout << "LLVM is not used: " << llvmcompiler.geterror() << std::endl;
     }
 
+    if (vm.count("time-passes"))
+        passmanager.report(std::cout);
+
     if (vm.count("dump-tree")) {
         std::string dump = "digraph G {\n";
         dump += (blocks.back())->dump();
@@ -196,19 +368,68 @@ int main(int ac, char* av[]) {
 
     }
     
+    if (vm.count("dump-bytecode")) {
+        if (engine == "vm" || engine == "supervm")
+            std::cout << program.dump();
+        else if (engine == "regvm")
+            std::cout << regprogram.dump();
+    }
+
     if (vm.count("build")) {
         std::cout << "Build finished, no error catched" << std::endl;
         return 0;
     } 
 
+    if (vm.count("emit-c") && !vm.count("native"))
+        return 0;
+
     tstart = high_resolution_clock::now();
-    ptree::Stack* stack = new ptree::Stack{memfunc.getmaxstacksize()};
-    (blocks.back())->execute(stack);
+    ptree::Stack* stack = new ptree::Stack{stacksize};
+    if (vm.count("opcode-profile")) {
+        // histogram is accumulated over several runs to profile a corpus of programs
+        std::string profile_file = vm["opcode-profile"].as<std::string>();
+        ptree::OpcodeProfile profile(vm["ngram"].as<int>());
+        std::ifstream profile_in(profile_file);
+        profile.load(profile_in);
+        profile_in.close();
+        ptree::StackVM machine;
+        machine.run(program, stack, profile);
+        std::ofstream profile_out(profile_file, std::ios::out);
+        profile.save(profile_out);
+    } else if (nativecode) {
+        nativecode->run();
+    } else if (llvmcode) {
+        llvmcode->run(stack);
+    } else if (jitcode) {
+        jitcode->run(stack);
+    } else if (engine == "vm" || engine == "supervm") {
+        ptree::StackVM machine;
+        machine.run(program, stack);
+    } else if (engine == "regvm") {
+        ptree::RegisterVM machine;
+        machine.run(regprogram, stack);
+    } else if (engine == "closure") {
+        closureprogram(stack);
+    } else if (engine == "tiered") {
+        ptree::TierManager tiers;
+        tiers.run(blocks.back(), stack);
+    } else if (vm.count("trace-jit")) {
+        ptree::TraceEngine tracer;
+        tracer.run(blocks.back(), stack);
+    } else {
+        (blocks.back())->execute(stack);
+    }
     tfin = high_resolution_clock::now();
+    ptree::TierManager::wait();
 
     if (opt_time) {
         std::cout << "Execute finished, elapsed time: " << duration_cast<milliseconds>(tfin - tstart).count()
             << " ms" << std::endl;
+        if (engine == "tiered")
+            ptree::TierManager::report(std::cout, duration_cast<nanoseconds>(tfin - tstart).count());
+        if (vm.count("trace-jit"))
+            std::cout << "Traces compiled: " << ptree::LoopTrace::traces << ", side traces: "
+                << ptree::LoopTrace::sidetraces << ", failed: " << ptree::LoopTrace::failed << std::endl;
     }
 
     delete stack;
@@ -0,0 +1,561 @@
+#include "bytecode.hpp"
+#include "fold.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+
+namespace ptree {
+
+namespace bytecode {
+
+std::string opcode_name(Opcode op) {
+  switch (op) {
+  case Opcode::PUSH:
+    return "PUSH";
+  case Opcode::LOAD:
+    return "LOAD";
+  case Opcode::STORE:
+    return "STORE";
+  case Opcode::DUP:
+    return "DUP";
+  case Opcode::POP:
+    return "POP";
+  case Opcode::ADD:
+    return "ADD";
+  case Opcode::SUB:
+    return "SUB";
+  case Opcode::MUL:
+    return "MUL";
+  case Opcode::DIV:
+    return "DIV";
+  case Opcode::REM:
+    return "REM";
+  case Opcode::EQ:
+    return "EQ";
+  case Opcode::GE:
+    return "GE";
+  case Opcode::LE:
+    return "LE";
+  case Opcode::NE:
+    return "NE";
+  case Opcode::GT:
+    return "GT";
+  case Opcode::LT:
+    return "LT";
+  case Opcode::AND:
+    return "AND";
+  case Opcode::OR:
+    return "OR";
+  case Opcode::SHL:
+    return "SHL";
+  case Opcode::SHR:
+    return "SHR";
+  case Opcode::BAND:
+    return "BAND";
+  case Opcode::MULHI:
+    return "MULHI";
+  case Opcode::NEG:
+    return "NEG";
+  case Opcode::NOT:
+    return "NOT";
+  case Opcode::INC:
+    return "INC";
+  case Opcode::DEC:
+    return "DEC";
+  case Opcode::INPUT:
+    return "INPUT";
+  case Opcode::PRINT:
+    return "PRINT";
+  case Opcode::JMP:
+    return "JMP";
+  case Opcode::JZ:
+    return "JZ";
+  case Opcode::HALT:
+    return "HALT";
+  case Opcode::ADD_VC:
+    return "ADD_VC";
+  case Opcode::SUB_VC:
+    return "SUB_VC";
+  case Opcode::MUL_VC:
+    return "MUL_VC";
+  case Opcode::DIV_VC:
+    return "DIV_VC";
+  case Opcode::REM_VC:
+    return "REM_VC";
+  case Opcode::EQ_VC:
+    return "EQ_VC";
+  case Opcode::NE_VC:
+    return "NE_VC";
+  case Opcode::LT_VC:
+    return "LT_VC";
+  case Opcode::GT_VC:
+    return "GT_VC";
+  case Opcode::LE_VC:
+    return "LE_VC";
+  case Opcode::GE_VC:
+    return "GE_VC";
+  case Opcode::SHL_VC:
+    return "SHL_VC";
+  case Opcode::SHR_VC:
+    return "SHR_VC";
+  case Opcode::BAND_VC:
+    return "BAND_VC";
+  case Opcode::MULHI_VC:
+    return "MULHI_VC";
+  case Opcode::JEQ:
+    return "JEQ";
+  case Opcode::JNE:
+    return "JNE";
+  case Opcode::JLT:
+    return "JLT";
+  case Opcode::JGE:
+    return "JGE";
+  case Opcode::JLE:
+    return "JLE";
+  case Opcode::JGT:
+    return "JGT";
+  case Opcode::JEQ_VC:
+    return "JEQ_VC";
+  case Opcode::JNE_VC:
+    return "JNE_VC";
+  case Opcode::JLT_VC:
+    return "JLT_VC";
+  case Opcode::JGE_VC:
+    return "JGE_VC";
+  case Opcode::JLE_VC:
+    return "JLE_VC";
+  case Opcode::JGT_VC:
+    return "JGT_VC";
+  case Opcode::STORE_C:
+    return "STORE_C";
+  case Opcode::ADD_VC_STORE:
+    return "ADD_VC_STORE";
+  case Opcode::INC_POP:
+    return "INC_POP";
+  case Opcode::DEC_POP:
+    return "DEC_POP";
+  }
+  return "?";
+}
+
+Opcode binop_opcode(BinOpType operation) {
+  switch (operation) {
+  case BinOpType::ADDITION:
+    return Opcode::ADD;
+  case BinOpType::SUBTRACTION:
+    return Opcode::SUB;
+  case BinOpType::MULTIPLICATION:
+    return Opcode::MUL;
+  case BinOpType::DIVISION:
+    return Opcode::DIV;
+  case BinOpType::REMAINDER:
+    return Opcode::REM;
+  case BinOpType::EQUAL:
+    return Opcode::EQ;
+  case BinOpType::MORE_EQUAL:
+    return Opcode::GE;
+  case BinOpType::LESS_EQUAL:
+    return Opcode::LE;
+  case BinOpType::NON_EQUAL:
+    return Opcode::NE;
+  case BinOpType::MORE:
+    return Opcode::GT;
+  case BinOpType::LESS:
+    return Opcode::LT;
+  case BinOpType::LOG_AND:
+    return Opcode::AND;
+  case BinOpType::LOG_OR:
+    return Opcode::OR;
+  case BinOpType::SHIFT_LEFT:
+    return Opcode::SHL;
+  case BinOpType::SHIFT_RIGHT:
+    return Opcode::SHR;
+  case BinOpType::BIT_AND:
+    return Opcode::BAND;
+  case BinOpType::MUL_HIGH:
+    return Opcode::MULHI;
+  default:
+    throw std::logic_error{"Undefined binary operation in bytecode compiler"};
+  }
+}
+
+//value stack change made by each opcode
+static int stack_effect(Opcode op) {
+  switch (op) {
+  case Opcode::PUSH:
+  case Opcode::LOAD:
+  case Opcode::DUP:
+  case Opcode::INC:
+  case Opcode::DEC:
+  case Opcode::INPUT:
+    return 1;
+  case Opcode::NEG:
+  case Opcode::NOT:
+  case Opcode::JMP:
+  case Opcode::HALT:
+    return 0;
+  default:
+    return -1;
+  }
+}
+
+bool is_jump(Opcode op) {
+  switch (op) {
+  case Opcode::JMP:
+  case Opcode::JZ:
+  case Opcode::JEQ:
+  case Opcode::JNE:
+  case Opcode::JLT:
+  case Opcode::JGE:
+  case Opcode::JLE:
+  case Opcode::JGT:
+  case Opcode::JEQ_VC:
+  case Opcode::JNE_VC:
+  case Opcode::JLT_VC:
+  case Opcode::JGE_VC:
+  case Opcode::JLE_VC:
+  case Opcode::JGT_VC:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::string Program::dump() const {
+  std::string res;
+  for (size_t i = 0; i < code.size(); ++i) {
+    res += std::to_string(i) + ": " + opcode_name(code[i].op);
+    switch (code[i].op) {
+    case Opcode::PUSH:
+    case Opcode::LOAD:
+    case Opcode::STORE:
+    case Opcode::INC:
+    case Opcode::DEC:
+    case Opcode::JMP:
+    case Opcode::JZ:
+    case Opcode::JEQ:
+    case Opcode::JNE:
+    case Opcode::JLT:
+    case Opcode::JGE:
+    case Opcode::JLE:
+    case Opcode::JGT:
+    case Opcode::INC_POP:
+    case Opcode::DEC_POP:
+      res += " " + std::to_string(code[i].arg);
+      break;
+    case Opcode::ADD_VC:
+    case Opcode::SUB_VC:
+    case Opcode::MUL_VC:
+    case Opcode::DIV_VC:
+    case Opcode::REM_VC:
+    case Opcode::EQ_VC:
+    case Opcode::NE_VC:
+    case Opcode::LT_VC:
+    case Opcode::GT_VC:
+    case Opcode::LE_VC:
+    case Opcode::GE_VC:
+    case Opcode::SHL_VC:
+    case Opcode::SHR_VC:
+    case Opcode::BAND_VC:
+    case Opcode::MULHI_VC:
+    case Opcode::STORE_C:
+      res += " " + std::to_string(code[i].arg) + " " + std::to_string(code[i].arg2);
+      break;
+    case Opcode::JEQ_VC:
+    case Opcode::JNE_VC:
+    case Opcode::JLT_VC:
+    case Opcode::JGE_VC:
+    case Opcode::JLE_VC:
+    case Opcode::JGT_VC:
+    case Opcode::ADD_VC_STORE:
+      res += " " + std::to_string(code[i].arg) + " " + std::to_string(code[i].arg2) +
+             " " + std::to_string(code[i].arg3);
+      break;
+    default:
+      break;
+    }
+    res += "\n";
+  }
+  return res;
+}
+
+int Compiler::emit(Opcode op, int arg) {
+  program_.code.push_back(Instruction{op, arg});
+  depth_ += stack_effect(op);
+  program_.maxdepth = std::max(program_.maxdepth, depth_);
+  return program_.code.size() - 1;
+}
+
+void Compiler::patch(int at) { program_.code[at].arg = program_.code.size(); }
+
+void Compiler::compile_stmt(const PTree *unit) {
+  if (unit == nullptr)
+    return;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      compile_stmt(expr);
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    std::vector<int> to_else;
+    compile_cond(ifblock->condition_, to_else);
+    compile_stmt(ifblock->getright());
+    int to_end = -1;
+    if (ifblock->getleft() != nullptr)
+      to_end = emit(Opcode::JMP);
+    for (int at : to_else)
+      patch(at);
+    if (ifblock->getleft() != nullptr) {
+      compile_stmt(ifblock->getleft());
+      patch(to_end);
+    }
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw std::logic_error{"No condition in while cycle"};
+    int start = program_.code.size();
+    std::vector<int> to_end;
+    compile_cond(whileblock->condition_, to_end);
+    compile_stmt(whileblock->getleft());
+    emit(Opcode::JMP, start);
+    for (int at : to_end)
+      patch(at);
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    compile_stmt(expression->getright());
+    return;
+  }
+  // assignation and print at statement level do not need their value
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    compile_expr(assign->getright());
+    emit(Opcode::STORE, assign->lval->getoffset());
+    return;
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    compile_expr(output->getright());
+    emit(Opcode::PRINT);
+    return;
+  }
+  compile_expr(unit);
+  emit(Opcode::POP);
+}
+
+void Compiler::compile_cond(const PTree *unit, std::vector<int> &to_false) {
+  if (auto condition = dynamic_cast<const Condition *>(unit)) {
+    compile_cond(condition->getleft(), to_false);
+    return;
+  }
+  auto binop = dynamic_cast<const BinOp *>(unit);
+  if (binop != nullptr && is_pure(binop->getright())) {
+    if (binop->operation_ == BinOpType::LOG_AND) {
+      compile_cond(binop->getleft(), to_false);
+      compile_cond(binop->getright(), to_false);
+      return;
+    }
+    if (binop->operation_ == BinOpType::LOG_OR) {
+      // true left operand jumps over the right one
+      std::vector<int> to_right;
+      compile_cond(binop->getleft(), to_right);
+      int to_true = emit(Opcode::JMP);
+      for (int at : to_right)
+        patch(at);
+      compile_cond(binop->getright(), to_false);
+      patch(to_true);
+      return;
+    }
+  }
+  compile_expr(unit);
+  to_false.push_back(emit(Opcode::JZ));
+}
+
+void Compiler::compile_expr(const PTree *unit) {
+  if (unit == nullptr)
+    throw std::logic_error{"Missing operand in bytecode compiler"};
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit)) {
+    emit(Opcode::PUSH, imidiate->getvalue());
+    return;
+  }
+  if (auto nameint = dynamic_cast<const NameInt *>(unit)) {
+    emit(Opcode::LOAD, nameint->getoffset());
+    return;
+  }
+  if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw std::logic_error{"Reserved word has no value"};
+    emit(Opcode::INPUT);
+    return;
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    compile_expr(binop->getleft());
+    compile_expr(binop->getright());
+    emit(binop_opcode(binop->operation_));
+    return;
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    switch (unop->operation_) {
+    case UnOpType::POST_ADDITION:
+    case UnOpType::POST_SUBTRACTION: {
+      auto var = dynamic_cast<const NameInt *>(unop->getleft());
+      if (var == nullptr)
+        throw std::logic_error{"Increment of not a variable"};
+      emit(unop->operation_ == UnOpType::POST_ADDITION ? Opcode::INC : Opcode::DEC,
+           var->getoffset());
+      return;
+    }
+    case UnOpType::MINUS:
+      compile_expr(unop->getleft());
+      emit(Opcode::NEG);
+      return;
+    case UnOpType::NOT:
+      compile_expr(unop->getleft());
+      emit(Opcode::NOT);
+      return;
+    default:
+      throw std::logic_error{"Undefined unary operation in bytecode compiler"};
+    }
+  }
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    compile_expr(assign->getright());
+    emit(Opcode::DUP);
+    emit(Opcode::STORE, assign->lval->getoffset());
+    return;
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    compile_expr(output->getright());
+    emit(Opcode::DUP);
+    emit(Opcode::PRINT);
+    return;
+  }
+  if (auto condition = dynamic_cast<const Condition *>(unit)) {
+    compile_expr(condition->getleft());
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    compile_expr(expression->getright());
+    return;
+  }
+  throw std::logic_error{"Node can not be compiled to bytecode"};
+}
+
+Program Compiler::compile(const PTree *root) {
+  program_ = Program{};
+  depth_ = 0;
+  compile_stmt(root);
+  emit(Opcode::HALT);
+  return program_;
+}
+
+Program compile_tree(const PTree *root) {
+  Compiler compiler;
+  return compiler.compile(root);
+}
+
+namespace {
+
+//superinstruction for LOAD PUSH op sequence
+bool var_const_opcode(Opcode op, Opcode &fused) {
+  switch (op) {
+  case Opcode::ADD: fused = Opcode::ADD_VC; return true;
+  case Opcode::SUB: fused = Opcode::SUB_VC; return true;
+  case Opcode::MUL: fused = Opcode::MUL_VC; return true;
+  case Opcode::DIV: fused = Opcode::DIV_VC; return true;
+  case Opcode::REM: fused = Opcode::REM_VC; return true;
+  case Opcode::EQ: fused = Opcode::EQ_VC; return true;
+  case Opcode::NE: fused = Opcode::NE_VC; return true;
+  case Opcode::LT: fused = Opcode::LT_VC; return true;
+  case Opcode::GT: fused = Opcode::GT_VC; return true;
+  case Opcode::LE: fused = Opcode::LE_VC; return true;
+  case Opcode::GE: fused = Opcode::GE_VC; return true;
+  case Opcode::SHL: fused = Opcode::SHL_VC; return true;
+  case Opcode::SHR: fused = Opcode::SHR_VC; return true;
+  case Opcode::BAND: fused = Opcode::BAND_VC; return true;
+  case Opcode::MULHI: fused = Opcode::MULHI_VC; return true;
+  default: return false;
+  }
+}
+
+//compare and branch for relation followed by JZ, so the relation is inverted
+bool branch_opcode(Opcode op, Opcode &fused, Opcode &fused_vc) {
+  switch (op) {
+  case Opcode::EQ: fused = Opcode::JNE; fused_vc = Opcode::JNE_VC; return true;
+  case Opcode::NE: fused = Opcode::JEQ; fused_vc = Opcode::JEQ_VC; return true;
+  case Opcode::LT: fused = Opcode::JGE; fused_vc = Opcode::JGE_VC; return true;
+  case Opcode::GE: fused = Opcode::JLT; fused_vc = Opcode::JLT_VC; return true;
+  case Opcode::LE: fused = Opcode::JGT; fused_vc = Opcode::JGT_VC; return true;
+  case Opcode::GT: fused = Opcode::JLE; fused_vc = Opcode::JLE_VC; return true;
+  default: return false;
+  }
+}
+
+} // namespace
+
+Program fuse_superinstructions(const Program &program) {
+  const std::vector<Instruction> &code = program.code;
+  std::vector<bool> target(code.size() + 1, false);
+  for (auto &instr : code)
+    if (is_jump(instr.op))
+      target[instr.arg] = true;
+  // sequence of length n starting at i can be fused if nobody jumps inside it
+  auto fusable = [&](size_t i, size_t n) {
+    if (i + n > code.size())
+      return false;
+    for (size_t k = i + 1; k < i + n; ++k)
+      if (target[k])
+        return false;
+    return true;
+  };
+
+  Program res;
+  res.maxdepth = program.maxdepth;
+  std::vector<int> newindex(code.size() + 1, 0);
+  size_t i = 0;
+  while (i < code.size()) {
+    newindex[i] = res.code.size();
+    Opcode fused, fused_vc;
+    if (fusable(i, 4) && code[i].op == Opcode::LOAD && code[i + 1].op == Opcode::PUSH &&
+        code[i + 3].op == Opcode::JZ && branch_opcode(code[i + 2].op, fused, fused_vc)) {
+      res.code.push_back(Instruction{fused_vc, code[i + 3].arg, code[i].arg, code[i + 1].arg});
+      i += 4;
+    } else if (fusable(i, 4) && code[i].op == Opcode::LOAD && code[i + 1].op == Opcode::PUSH &&
+               code[i + 3].op == Opcode::STORE &&
+               (code[i + 2].op == Opcode::ADD ||
+                (code[i + 2].op == Opcode::SUB && code[i + 1].arg != std::numeric_limits<int>::min()))) {
+      int value = code[i + 2].op == Opcode::ADD ? code[i + 1].arg : -code[i + 1].arg;
+      res.code.push_back(Instruction{Opcode::ADD_VC_STORE, code[i + 3].arg, code[i].arg, value});
+      i += 4;
+    } else if (fusable(i, 3) && code[i].op == Opcode::LOAD && code[i + 1].op == Opcode::PUSH &&
+               var_const_opcode(code[i + 2].op, fused)) {
+      res.code.push_back(Instruction{fused, code[i].arg, code[i + 1].arg});
+      i += 3;
+    } else if (fusable(i, 2) && code[i + 1].op == Opcode::JZ &&
+               branch_opcode(code[i].op, fused, fused_vc)) {
+      res.code.push_back(Instruction{fused, code[i + 1].arg});
+      i += 2;
+    } else if (fusable(i, 2) && code[i].op == Opcode::PUSH && code[i + 1].op == Opcode::STORE) {
+      res.code.push_back(Instruction{Opcode::STORE_C, code[i + 1].arg, code[i].arg});
+      i += 2;
+    } else if (fusable(i, 2) && code[i + 1].op == Opcode::POP &&
+               (code[i].op == Opcode::INC || code[i].op == Opcode::DEC)) {
+      res.code.push_back(Instruction{code[i].op == Opcode::INC ? Opcode::INC_POP : Opcode::DEC_POP,
+                                     code[i].arg});
+      i += 2;
+    } else {
+      res.code.push_back(code[i]);
+      ++i;
+    }
+  }
+  newindex[code.size()] = res.code.size();
+  for (auto &instr : res.code)
+    if (is_jump(instr.op))
+      instr.arg = newindex[instr.arg];
+  return res;
+}
+
+} // namespace bytecode
+
+} // namespace ptree
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+bytecode structure:
+1) Opcode - instructions of stack machine, all operands are taken from the value stack
+2) Instruction - opcode with one integer argument (immidiate value, stack offset or jump target)
+3) Program - flat array of instructions, result of the tree lowering
+4) Compiler - lowers Block/IfBlk/WhileBlk/BinOp tree (after manage_tree_mem) into Program
+5) fuse_superinstructions - replaces frequent opcode sequences with single instructions,
+   the set is chosen from n-gram histogram made by OpcodeProfile (see vm.hpp) over examples
+*/
+
+namespace ptree {
+
+namespace bytecode {
+
+enum class Opcode : unsigned char {
+  PUSH,   //push immidiate value (arg)
+  LOAD,   //push value from stack offset (arg)
+  STORE,  //pop value and write it to stack offset (arg)
+  DUP,    //duplicate top value
+  POP,    //drop top value
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  REM,
+  EQ,
+  GE,
+  LE,
+  NE,
+  GT,
+  LT,
+  AND,
+  OR,
+  SHL,    //operations produced by strength reduction: shift left,
+  SHR,    //arithmetic shift right,
+  BAND,   //bitwise and,
+  MULHI,  //high half of 64 bit product
+  NEG,    //negate top value
+  NOT,    //logical not of top value
+  INC,    //increment value in stack offset (arg) and push result
+  DEC,    //decrement value in stack offset (arg) and push result
+  INPUT,  //read integer from stdin and push it
+  PRINT,  //pop value and print it
+  JMP,    //jump to instruction number (arg)
+  JZ,     //pop value and jump to instruction number (arg) if it equals zero
+  HALT,
+  //superinstructions, var is value in stack offset (arg), const is arg2
+  ADD_VC, //LOAD PUSH ADD: push var + const
+  SUB_VC,
+  MUL_VC,
+  DIV_VC,
+  REM_VC,
+  EQ_VC,
+  NE_VC,
+  LT_VC,
+  GT_VC,
+  LE_VC,
+  GE_VC,
+  SHL_VC,
+  SHR_VC,
+  BAND_VC,
+  MULHI_VC,
+  //compare and branch: EQ JZ becomes JNE, pop two values and jump to (arg) if relation is true
+  JEQ,
+  JNE,
+  JLT,
+  JGE,
+  JLE,
+  JGT,
+  //LOAD PUSH LT JZ becomes JGE_VC: jump to (arg) if value in offset (arg2) relates to const (arg3)
+  JEQ_VC,
+  JNE_VC,
+  JLT_VC,
+  JGE_VC,
+  JLE_VC,
+  JGT_VC,
+  STORE_C,      //PUSH STORE: write const (arg2) to stack offset (arg)
+  ADD_VC_STORE, //LOAD PUSH ADD STORE: write value in offset (arg2) + const (arg3) to offset (arg)
+  INC_POP,      //INC POP: increment value in stack offset (arg)
+  DEC_POP       //DEC POP: decrement value in stack offset (arg)
+};
+
+//return text name of opcode
+std::string opcode_name(Opcode op);
+//return opcode which provides given binary operation
+Opcode binop_opcode(BinOpType operation);
+
+struct Instruction {
+  Opcode op;
+  int arg;
+  //additional arguments of superinstructions
+  int arg2 = 0;
+  int arg3 = 0;
+};
+
+class Program {
+  public:
+  std::vector<Instruction> code;
+  //max depth of value stack needed to run program
+  int maxdepth = 0;
+
+  //return std::string with program listing
+  std::string dump() const;
+};
+
+class Compiler {
+  Program program_;
+  int depth_ = 0;
+
+  int emit(Opcode op, int arg = 0);
+  //set jump target of instruction number at to the next emitted instruction
+  void patch(int at);
+  //compile statement, its value (if exists) is dropped
+  void compile_stmt(const PTree *unit);
+  //compile expression, its value is left on the value stack
+  void compile_expr(const PTree *unit);
+  //compile condition of if or while, jumps taken when it is false are added to to_false,
+  //&& and || with pure right operand skip it when left operand decides
+  void compile_cond(const PTree *unit, std::vector<int> &to_false);
+  public:
+  Program compile(const PTree *root);
+};
+
+//lower tree with assigned offsets into bytecode program
+Program compile_tree(const PTree *root);
+
+//return true if opcode takes jump target in arg
+bool is_jump(Opcode op);
+
+//return program with frequent opcode sequences replaced by superinstructions,
+//sequences containing jump targets inside are not fused
+Program fuse_superinstructions(const Program &program);
+
+} // namespace bytecode
+
+}
@@ -0,0 +1,373 @@
+#include "cgen.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace ptree {
+
+// arithmetic of translated program does not depend on compiler flags: overflow wraps around
+// through unsigned operations, division by zero and INT_MIN / -1 raise SIGFPE like idiv of engines
+static const char *c_prologue =
+    "#include <limits.h>\n"
+    "#include <signal.h>\n"
+    "#include <stdio.h>\n"
+    "\n"
+    "static int pcl_add(int lhs, int rhs) { return (int)((unsigned)lhs + (unsigned)rhs); }\n"
+    "static int pcl_sub(int lhs, int rhs) { return (int)((unsigned)lhs - (unsigned)rhs); }\n"
+    "static int pcl_mul(int lhs, int rhs) { return (int)((unsigned)lhs * (unsigned)rhs); }\n"
+    "static int pcl_neg(int value) { return (int)(0u - (unsigned)value); }\n"
+    "static int pcl_shl(int lhs, int rhs) { return (int)((unsigned)lhs << rhs); }\n"
+    "\n"
+    "static int pcl_div(int lhs, int rhs) {\n"
+    "  if (rhs == 0 || (lhs == INT_MIN && rhs == -1)) {\n"
+    "    raise(SIGFPE);\n"
+    "    return 0;\n"
+    "  }\n"
+    "  return lhs / rhs;\n"
+    "}\n"
+    "\n"
+    "static int pcl_rem(int lhs, int rhs) {\n"
+    "  if (rhs == 0 || (lhs == INT_MIN && rhs == -1)) {\n"
+    "    raise(SIGFPE);\n"
+    "    return 0;\n"
+    "  }\n"
+    "  return lhs % rhs;\n"
+    "}\n"
+    "\n"
+    "static int pcl_print(int value) {\n"
+    "  printf(\"%d\\n\", value);\n"
+    "  fflush(stdout);\n"
+    "  return value;\n"
+    "}\n"
+    "\n"
+    "static int pcl_mulhi(int lhs, int rhs) {\n"
+    "  return (int)((long long)lhs * rhs >> 32);\n"
+    "}\n"
+    "\n"
+    "static int pcl_input(void) {\n"
+    "  int value;\n"
+    "  if (scanf(\"%d\", &value) != 1)\n"
+    "    value = 0;\n"
+    "  return value;\n"
+    "}\n"
+    "\n";
+
+static const char *c_epilogue =
+    "\n"
+    "#ifndef PCL_NO_MAIN\n"
+    "int main(void) {\n"
+    "  pcl_main();\n"
+    "  return 0;\n"
+    "}\n"
+    "#endif\n";
+
+//prologue function for operations which are undefined in C for some operands, nullptr for the rest
+static const char *c_helper(BinOpType operation) {
+  switch (operation) {
+  case BinOpType::ADDITION:
+    return "pcl_add";
+  case BinOpType::SUBTRACTION:
+    return "pcl_sub";
+  case BinOpType::MULTIPLICATION:
+    return "pcl_mul";
+  case BinOpType::DIVISION:
+    return "pcl_div";
+  case BinOpType::REMAINDER:
+    return "pcl_rem";
+  case BinOpType::SHIFT_LEFT:
+    return "pcl_shl";
+  case BinOpType::MUL_HIGH:
+    return "pcl_mulhi";
+  default:
+    return nullptr;
+  }
+}
+
+static std::string c_op(BinOpType operation) {
+  switch (operation) {
+  case BinOpType::EQUAL:
+    return "==";
+  case BinOpType::MORE_EQUAL:
+    return ">=";
+  case BinOpType::LESS_EQUAL:
+    return "<=";
+  case BinOpType::NON_EQUAL:
+    return "!=";
+  case BinOpType::MORE:
+    return ">";
+  case BinOpType::LESS:
+    return "<";
+  // both operands are always evaluated, so logical operations use bitwise form
+  case BinOpType::LOG_AND:
+    return "&";
+  case BinOpType::LOG_OR:
+    return "|";
+  // arithmetic shift of gcc and clang
+  case BinOpType::SHIFT_RIGHT:
+    return ">>";
+  case BinOpType::BIT_AND:
+    return "&";
+  // only divisions which can not trap, see range.hpp
+  case BinOpType::DIVISION:
+    return "/";
+  case BinOpType::REMAINDER:
+    return "%";
+  default:
+    throw std::logic_error{"Undefined binary operation in C emitter"};
+  }
+}
+
+bool has_effects(const PTree *unit) {
+  if (unit == nullptr)
+    return false;
+  if (dynamic_cast<const Assign *>(unit) || dynamic_cast<const Output *>(unit))
+    return true;
+  if (auto reserved = dynamic_cast<const Reserved *>(unit))
+    return reserved->gettype() == Reserved::Types::Input;
+  if (auto unop = dynamic_cast<const UnOp *>(unit))
+    if (unop->operation_ == UnOpType::POST_ADDITION ||
+        unop->operation_ == UnOpType::POST_SUBTRACTION)
+      return true;
+  return has_effects(unit->getleft()) || has_effects(unit->getright());
+}
+
+std::string CEmitter::var(const NameInt *var) {
+  if (var->getoffset() < 0)
+    throw std::logic_error{"Usage of undeclared variable " + var->getvarname()};
+  maxoffset_ = std::max(maxoffset_, var->getoffset());
+  return "v" + std::to_string(var->getoffset());
+}
+
+std::string CEmitter::temp() { return "t" + std::to_string(temps_++); }
+
+std::string CEmitter::indent(int level) const { return std::string(2 * level, ' '); }
+
+std::string CEmitter::emit_expr(const PTree *unit) {
+  if (unit == nullptr)
+    throw std::logic_error{"Missing operand in C emitter"};
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit)) {
+    int value = imidiate->getvalue();
+    // -2147483648 is not a valid C literal
+    if (value == std::numeric_limits<int>::min())
+      return "(-2147483647 - 1)";
+    return value < 0 ? "(" + std::to_string(value) + ")" : std::to_string(value);
+  }
+  if (auto nameint = dynamic_cast<const NameInt *>(unit))
+    return var(nameint);
+  if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw std::logic_error{"Reserved word has no value"};
+    return "pcl_input()";
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    std::string lhs = emit_expr(binop->getleft());
+    std::string rhs = emit_expr(binop->getright());
+    // C does not specify operands evaluation order, left operand is sequenced
+    // through temporary variable when any of operands has side effects
+    std::string sequence;
+    if (has_effects(binop->getleft()) || has_effects(binop->getright())) {
+      std::string tmp = temp();
+      sequence = tmp + " = " + lhs + ", ";
+      lhs = tmp;
+    }
+    if (binop->operation_ == BinOpType::LOG_AND || binop->operation_ == BinOpType::LOG_OR) {
+      lhs = "(" + lhs + " != 0)";
+      rhs = "(" + rhs + " != 0)";
+    }
+    const char *helper = c_helper(binop->operation_);
+    // division proven safe by range analysis needs no trap check
+    if (binop->safe_ && (binop->operation_ == BinOpType::DIVISION || binop->operation_ == BinOpType::REMAINDER))
+      helper = nullptr;
+    if (helper)
+      return "(" + sequence + helper + "(" + lhs + ", " + rhs + "))";
+    return "(" + sequence + lhs + " " + c_op(binop->operation_) + " " + rhs + ")";
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    switch (unop->operation_) {
+    case UnOpType::POST_ADDITION:
+    case UnOpType::POST_SUBTRACTION: {
+      auto nameint = dynamic_cast<const NameInt *>(unop->getleft());
+      if (nameint == nullptr)
+        throw std::logic_error{"Increment of not a variable"};
+      // value goes through temporary, so the variable is not read or written again
+      // without sequence point in the enclosing expression (x = x++, x++ + x)
+      std::string tmp = temp();
+      return "(" + tmp + (unop->operation_ == UnOpType::POST_ADDITION ? " = ++" : " = --") + var(nameint) + ", " +
+             tmp + ")";
+    }
+    case UnOpType::MINUS:
+      return "pcl_neg(" + emit_expr(unop->getleft()) + ")";
+    case UnOpType::NOT:
+      return "(!" + emit_expr(unop->getleft()) + ")";
+    default:
+      throw std::logic_error{"Undefined unary operation in C emitter"};
+    }
+  }
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    // side effects of right operand (x = (x = 3), x = ?) are completed before the store
+    if (has_effects(assign->getright())) {
+      std::string tmp = temp();
+      return "(" + tmp + " = " + emit_expr(assign->getright()) + ", " + var(assign->lval) + " = " + tmp + ")";
+    }
+    return "(" + var(assign->lval) + " = " + emit_expr(assign->getright()) + ")";
+  }
+  if (auto output = dynamic_cast<const Output *>(unit))
+    return "pcl_print(" + emit_expr(output->getright()) + ")";
+  if (auto condition = dynamic_cast<const Condition *>(unit))
+    return emit_expr(condition->getleft());
+  if (auto expression = dynamic_cast<const Expression *>(unit))
+    return emit_expr(expression->getright());
+  throw std::logic_error{"Node can not be translated to C"};
+}
+
+void CEmitter::emit_stmt(const PTree *unit, int level) {
+  if (unit == nullptr)
+    return;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    body_ += indent(level) + "{\n";
+    for (auto expr : block->operations)
+      emit_stmt(expr, level + 1);
+    body_ += indent(level) + "}\n";
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    body_ += indent(level) + "if (" + emit_expr(ifblock->condition_) + ")\n";
+    if (ifblock->getright() != nullptr)
+      emit_stmt(ifblock->getright(), level);
+    else
+      body_ += indent(level) + "{\n" + indent(level) + "}\n";
+    if (ifblock->getleft() != nullptr) {
+      body_ += indent(level) + "else\n";
+      emit_stmt(ifblock->getleft(), level);
+    }
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw std::logic_error{"No condition in while cycle"};
+    body_ += indent(level) + "while (" + emit_expr(whileblock->condition_) + ")\n";
+    if (whileblock->getleft() != nullptr)
+      emit_stmt(whileblock->getleft(), level);
+    else
+      body_ += indent(level) + "{\n" + indent(level) + "}\n";
+    return;
+  }
+  std::string expr = emit_expr(unit);
+  body_ += indent(level) + (has_effects(unit) ? "" : "(void)") + expr + ";\n";
+}
+
+std::string CEmitter::emit(const PTree *root) {
+  body_.clear();
+  temps_ = 0;
+  maxoffset_ = -1;
+  emit_stmt(root, 1);
+
+  std::string res = c_prologue;
+  res += "void pcl_main(void) {\n";
+  for (int offset = 0; offset <= maxoffset_; offset += sizeof(int))
+    res += "  int v" + std::to_string(offset) + " = 0;\n";
+  for (int i = 0; i < temps_; ++i)
+    res += "  int t" + std::to_string(i) + ";\n";
+  res += body_;
+  res += "}\n";
+  res += c_epilogue;
+  return res;
+}
+
+//run program with arguments without shell, so paths are not parsed again,
+//return status of waitpid or -1 if program can not be started
+static int run_command(const std::vector<std::string> &args) {
+  std::vector<char *> argv;
+  for (auto &arg : args)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+  pid_t pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+  int status;
+  while (waitpid(pid, &status, 0) < 0)
+    if (errno != EINTR)
+      return -1;
+  return status;
+}
+
+NativeCode::NativeCode(const std::string &source) : handle_(nullptr), entry_(nullptr) {
+  // private directory, names in shared /tmp could be taken or linked by other users,
+  // $TMPDIR is used where /tmp is not writable
+  const char *tmpdir = std::getenv("TMPDIR");
+  std::string pattern = std::string(tmpdir != nullptr && *tmpdir != '\0' ? tmpdir : "/tmp") + "/pcl_native_XXXXXX";
+  if (mkdtemp(&pattern[0]) == nullptr)
+    throw std::runtime_error{"Can not create directory for native code in " + pattern};
+  directory_ = pattern;
+  std::string csource = directory_ + "/program.c";
+  library_ = directory_ + "/program.so";
+  try {
+    std::ofstream out(csource);
+    out << source;
+    out.close();
+    if (!out)
+      throw std::runtime_error{"Can not write C source to " + csource};
+
+    // $CC can hold compiler with its own options, like "ccache gcc"
+    const char *cc = std::getenv("CC");
+    std::istringstream compiler(cc != nullptr ? cc : "");
+    std::vector<std::string> args;
+    for (std::string word; compiler >> word;)
+      args.push_back(word);
+    if (args.empty())
+      args.push_back("cc");
+    for (const char *option : {"-O2", "-w", "-shared", "-fPIC", "-DPCL_NO_MAIN", "-o"})
+      args.push_back(option);
+    args.push_back(library_);
+    args.push_back(csource);
+    int status = run_command(args);
+    std::remove(csource.c_str());
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::string command;
+      for (auto &arg : args)
+        command += (command.empty() ? "" : " ") + arg;
+      throw std::runtime_error{"C compiler failed: " + command};
+    }
+
+    handle_ = dlopen(library_.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle_ == nullptr)
+      throw std::runtime_error{std::string("Can not load native code: ") + dlerror()};
+    entry_ = reinterpret_cast<void (*)()>(dlsym(handle_, "pcl_main"));
+    if (entry_ == nullptr)
+      throw std::runtime_error{"Native code has no pcl_main function"};
+  } catch (...) {
+    cleanup();
+    throw;
+  }
+}
+
+void NativeCode::cleanup() {
+  if (handle_ != nullptr)
+    dlclose(handle_);
+  handle_ = nullptr;
+  std::remove(library_.c_str());
+  rmdir(directory_.c_str());
+}
+
+NativeCode::~NativeCode() { cleanup(); }
+
+void NativeCode::run() const { entry_(); }
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+
+namespace ptree {
+
+//translates tree (after manage_tree_mem) to C source,
+//each Stack offset becomes local int variable v<offset>
+class CEmitter {
+  std::string body_;
+  int temps_ = 0;
+  int maxoffset_ = -1;
+
+  std::string var(const NameInt *var);
+  std::string temp();
+  std::string indent(int level) const;
+  void emit_stmt(const PTree *unit, int level);
+  std::string emit_expr(const PTree *unit);
+public:
+  //return C translation unit with pcl_main() function and main() which calls it,
+  //main() is skipped when PCL_NO_MAIN is defined
+  std::string emit(const PTree *root);
+};
+
+//return true if evaluation of subtree has side effects (writes variables or makes input/output)
+bool has_effects(const PTree *unit);
+
+//C source compiled by system compiler ($CC or cc) to shared library and loaded with dlopen
+class NativeCode {
+  void *handle_;
+  void (*entry_)();
+  std::string directory_;
+  std::string library_;
+  //unload library and remove it with its directory
+  void cleanup();
+public:
+  NativeCode(const std::string &source);
+  ~NativeCode();
+  NativeCode(const NativeCode &other) = delete;
+  NativeCode &operator=(const NativeCode &other) = delete;
+  void run() const;
+};
+
+}
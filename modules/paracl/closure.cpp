@@ -0,0 +1,229 @@
+#include "closure.hpp"
+#include "quicken.hpp"
+#include "fold.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace ptree {
+
+namespace closure {
+
+namespace {
+
+inline int load(Stack *stack, int offset) {
+  int value;
+  stack->read(offset, value);
+  return value;
+}
+
+int slot(const NameInt *var) {
+  if (var->getoffset() < 0)
+    throw std::logic_error{"Usage of undeclared variable " + var->getvarname()};
+  return var->getoffset();
+}
+
+template <BinOpType Op> Expr specialise(const BinOp *binop, Compiler &compiler) {
+  auto lvar = dynamic_cast<const NameInt *>(binop->getleft());
+  auto rvar = dynamic_cast<const NameInt *>(binop->getright());
+  auto rimm = dynamic_cast<const Imidiate<int> *>(binop->getright());
+
+  if (lvar && rimm) {
+    int offset = slot(lvar), value = rimm->getvalue();
+    return [offset, value](Stack *stack) { return binop_apply<Op>(load(stack, offset), value); };
+  }
+  if (lvar && rvar) {
+    int loffset = slot(lvar), roffset = slot(rvar);
+    return [loffset, roffset](Stack *stack) {
+      return binop_apply<Op>(load(stack, loffset), load(stack, roffset));
+    };
+  }
+  Expr lhs = compiler.compile_expr(binop->getleft());
+  if (rimm) {
+    int value = rimm->getvalue();
+    return [lhs, value](Stack *stack) { return binop_apply<Op>(lhs(stack), value); };
+  }
+  if (rvar) {
+    int offset = slot(rvar);
+    return [lhs, offset](Stack *stack) {
+      int left = lhs(stack);
+      return binop_apply<Op>(left, load(stack, offset));
+    };
+  }
+  Expr rhs = compiler.compile_expr(binop->getright());
+  // operands are evaluated from left to right as in tree interpreter
+  return [lhs, rhs](Stack *stack) {
+    int left = lhs(stack);
+    return binop_apply<Op>(left, rhs(stack));
+  };
+}
+
+} // namespace
+
+Expr Compiler::compile_binop(const BinOp *binop) {
+  switch (binop->operation_) {
+#define PCL_CLOSURE_CASE(name, expr) \
+  case BinOpType::name:              \
+    return specialise<BinOpType::name>(binop, *this);
+    PCL_QUICK_OPERATIONS(PCL_CLOSURE_CASE)
+#undef PCL_CLOSURE_CASE
+  default:
+    throw std::logic_error{"Undefined binary operation in closure compiler"};
+  }
+}
+
+Expr Compiler::compile_unop(const UnOp *unop) {
+  switch (unop->operation_) {
+  case UnOpType::POST_ADDITION:
+  case UnOpType::POST_SUBTRACTION: {
+    auto var = dynamic_cast<const NameInt *>(unop->getleft());
+    if (var == nullptr)
+      throw std::logic_error{"Increment of not a variable"};
+    int offset = slot(var);
+    int step = unop->operation_ == UnOpType::POST_ADDITION ? 1 : -1;
+    return [offset, step](Stack *stack) {
+      int value = load(stack, offset) + step;
+      stack->write(offset, value);
+      return value;
+    };
+  }
+  case UnOpType::MINUS: {
+    Expr operand = compile_expr(unop->getleft());
+    return [operand](Stack *stack) { return -operand(stack); };
+  }
+  case UnOpType::NOT: {
+    Expr operand = compile_expr(unop->getleft());
+    return [operand](Stack *stack) { return static_cast<int>(!operand(stack)); };
+  }
+  default:
+    throw std::logic_error{"Undefined unary operation in closure compiler"};
+  }
+}
+
+Expr Compiler::compile_cond(const PTree *unit) {
+  if (auto condition = dynamic_cast<const Condition *>(unit))
+    return compile_cond(condition->getleft());
+  if (auto unop = dynamic_cast<const UnOp *>(unit); unop != nullptr && unop->operation_ == UnOpType::NOT) {
+    Expr operand = compile_cond(unop->getleft());
+    return [operand](Stack *stack) { return static_cast<int>(!operand(stack)); };
+  }
+  auto binop = dynamic_cast<const BinOp *>(unit);
+  if (binop != nullptr && (binop->operation_ == BinOpType::LOG_AND || binop->operation_ == BinOpType::LOG_OR) &&
+      is_pure(binop->getright())) {
+    Expr lhs = compile_cond(binop->getleft());
+    Expr rhs = compile_cond(binop->getright());
+    if (binop->operation_ == BinOpType::LOG_AND)
+      return [lhs, rhs](Stack *stack) { return static_cast<int>(lhs(stack) && rhs(stack)); };
+    return [lhs, rhs](Stack *stack) { return static_cast<int>(lhs(stack) || rhs(stack)); };
+  }
+  return compile_expr(unit);
+}
+
+Expr Compiler::compile_expr(const PTree *unit) {
+  if (unit == nullptr)
+    throw std::logic_error{"Missing operand in closure compiler"};
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit)) {
+    int value = imidiate->getvalue();
+    return [value](Stack *) { return value; };
+  }
+  if (auto nameint = dynamic_cast<const NameInt *>(unit)) {
+    int offset = slot(nameint);
+    return [offset](Stack *stack) { return load(stack, offset); };
+  }
+  if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw std::logic_error{"Reserved word has no value"};
+    return [](Stack *) { return readint(); };
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit))
+    return compile_binop(binop);
+  if (auto unop = dynamic_cast<const UnOp *>(unit))
+    return compile_unop(unop);
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    int offset = slot(assign->lval);
+    Expr rhs = compile_expr(assign->getright());
+    return [offset, rhs](Stack *stack) {
+      int value = rhs(stack);
+      stack->write(offset, value);
+      return value;
+    };
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    Expr value = compile_expr(output->getright());
+    return [value](Stack *stack) {
+      int res = value(stack);
+      std::cout << res << std::endl;
+      return res;
+    };
+  }
+  if (auto condition = dynamic_cast<const Condition *>(unit))
+    return compile_expr(condition->getleft());
+  if (auto expression = dynamic_cast<const Expression *>(unit))
+    return compile_expr(expression->getright());
+  throw std::logic_error{"Node can not be compiled to closure"};
+}
+
+Stmt Compiler::compile_stmt(const PTree *unit) {
+  if (unit == nullptr)
+    return [](Stack *) {};
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    std::vector<Stmt> operations;
+    for (auto expr : block->operations)
+      operations.push_back(compile_stmt(expr));
+    return [operations](Stack *stack) {
+      for (auto &operation : operations)
+        operation(stack);
+    };
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    Expr condition = compile_cond(ifblock->condition_);
+    Stmt on_true = compile_stmt(ifblock->getright());
+    if (ifblock->getleft() == nullptr)
+      return [condition, on_true](Stack *stack) {
+        if (condition(stack))
+          on_true(stack);
+      };
+    Stmt on_false = compile_stmt(ifblock->getleft());
+    return [condition, on_true, on_false](Stack *stack) {
+      if (condition(stack))
+        on_true(stack);
+      else
+        on_false(stack);
+    };
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw std::logic_error{"No condition in while cycle"};
+    Expr condition = compile_cond(whileblock->condition_);
+    Stmt body = compile_stmt(whileblock->getleft());
+    return [condition, body](Stack *stack) {
+      while (condition(stack))
+        body(stack);
+    };
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit))
+    return compile_stmt(expression->getright());
+  // assignation and print at statement level do not return value
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    int offset = slot(assign->lval);
+    Expr rhs = compile_expr(assign->getright());
+    return [offset, rhs](Stack *stack) { stack->write(offset, rhs(stack)); };
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    Expr value = compile_expr(output->getright());
+    return [value](Stack *stack) { std::cout << value(stack) << std::endl; };
+  }
+  Expr expr = compile_expr(unit);
+  return [expr](Stack *stack) { expr(stack); };
+}
+
+Stmt compile_tree(const PTree *root) {
+  Compiler compiler;
+  return compiler.compile_stmt(root);
+}
+
+} // namespace closure
+
+} // namespace ptree
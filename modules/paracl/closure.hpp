@@ -0,0 +1,35 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace ptree {
+
+namespace closure {
+
+//compiled expression returns its value
+using Expr = std::function<int(Stack *)>;
+//compiled statement
+using Stmt = std::function<void(Stack *)>;
+
+//turns tree (after manage_tree_mem) into tree of pre-bound closures,
+//binary operations are specialised by operator and operand kinds (constant, stack slot or expression)
+class Compiler {
+  Expr compile_binop(const BinOp *binop);
+  Expr compile_unop(const UnOp *unop);
+public:
+  Stmt compile_stmt(const PTree *unit);
+  Expr compile_expr(const PTree *unit);
+  //compile condition of if or while, only truth of returned value matters,
+  //&& and || with pure right operand skip it when left operand decides
+  Expr compile_cond(const PTree *unit);
+};
+
+//compile whole program
+Stmt compile_tree(const PTree *root);
+
+} // namespace closure
+
+}
@@ -0,0 +1,124 @@
+#include "dce.hpp"
+
+#include <algorithm>
+
+namespace ptree {
+
+namespace ssa {
+
+DeadCodeElimination::DeadCodeElimination(Function &function) : f_(function) {}
+
+//edge can be taken if branch at its start is not decided by constant the other way
+bool DeadCodeElimination::taken(int from, int to) const {
+  if (!reachable_[from])
+    return false;
+  const Instr &term = f_.terminator(from);
+  if (term.op != Op::CBR || f_.instrs[term.operands[0]].op != Op::CONST)
+    return true;
+  const BasicBlock &block = f_.blocks[from];
+  return block.succs[f_.instrs[term.operands[0]].imm != 0 ? 0 : 1] == to;
+}
+
+//value of phi on edge which is never taken and of dead branch condition
+int DeadCodeElimination::zero() {
+  if (zero_ < 0) {
+    Instr constant;
+    constant.op = Op::CONST;
+    zero_ = f_.insert(0, constant);
+  }
+  return zero_;
+}
+
+void DeadCodeElimination::sweep_unreachable() {
+  reachable_.assign(f_.blocks.size(), 0);
+  std::vector<int> worklist{0};
+  reachable_[0] = 1;
+  while (!worklist.empty()) {
+    int b = worklist.back();
+    worklist.pop_back();
+    for (int succ : f_.blocks[b].succs)
+      if (!reachable_[succ] && taken(b, succ)) {
+        reachable_[succ] = 1;
+        worklist.push_back(succ);
+      }
+  }
+
+  auto rewire = [this](int user, int index) {
+    int operand = f_.instrs[user].operands[index];
+    std::vector<int> &users = f_.users[operand];
+    users.erase(std::find(users.begin(), users.end(), user));
+    f_.instrs[user].operands[index] = zero();
+    f_.users[zero_].push_back(user);
+  };
+  for (size_t b = 0; b < f_.blocks.size(); ++b) {
+    if (reachable_[b]) {
+      const std::vector<int> &preds = f_.blocks[b].preds;
+      for (int id : f_.blocks[b].instrs) {
+        if (f_.instrs[id].op != Op::PHI)
+          break;
+        for (size_t i = 0; i < preds.size(); ++i)
+          if (!taken(preds[i], b))
+            rewire(id, i);
+      }
+      continue;
+    }
+    ++unreachable_;
+    // terminators keep shape of CFG for regions, condition does not matter
+    std::vector<int> instrs = f_.blocks[b].instrs;
+    for (int id : instrs) {
+      if (f_.instrs[id].op == Op::CBR)
+        rewire(id, 0);
+      else if (f_.instrs[id].op != Op::BR && f_.instrs[id].op != Op::RET)
+        f_.erase(id);
+    }
+  }
+}
+
+void DeadCodeElimination::sweep_dead() {
+  std::vector<char> live(f_.instrs.size(), 0);
+  std::vector<int> worklist;
+  for (size_t b = 0; b < f_.blocks.size(); ++b) {
+    if (!reachable_[b])
+      continue;
+    for (int id : f_.blocks[b].instrs) {
+      Op op = f_.instrs[id].op;
+      if (op == Op::PRINT || op == Op::INPUT || op == Op::CBR || op == Op::BR || op == Op::RET || f_.may_trap(id)) {
+        live[id] = 1;
+        worklist.push_back(id);
+      }
+    }
+  }
+  while (!worklist.empty()) {
+    int id = worklist.back();
+    worklist.pop_back();
+    for (int operand : f_.instrs[id].operands)
+      if (!live[operand]) {
+        live[operand] = 1;
+        worklist.push_back(operand);
+      }
+  }
+  for (size_t b = 0; b < f_.blocks.size(); ++b) {
+    if (!reachable_[b])
+      continue;
+    std::vector<int> instrs = f_.blocks[b].instrs;
+    for (int id : instrs)
+      if (!live[id]) {
+        f_.erase(id);
+        ++removed_;
+      }
+  }
+}
+
+void DeadCodeElimination::run() {
+  f_.compute_uses();
+  sweep_unreachable();
+  sweep_dead();
+}
+
+int DeadCodeElimination::getremoved() const { return removed_; }
+
+int DeadCodeElimination::getunreachable() const { return unreachable_; }
+
+}
+
+}
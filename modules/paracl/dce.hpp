@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <vector>
+
+namespace ptree {
+
+namespace ssa {
+
+//dead code elimination: blocks behind branches on constants are unreachable and lose their
+//code, values which do not reach print, input, branch or trapping division are removed,
+//dead stores disappear with them because stores are SSA values
+class DeadCodeElimination {
+  Function &f_;
+  std::vector<char> reachable_;
+  int zero_ = -1;
+  int removed_ = 0;
+  int unreachable_ = 0;
+
+  bool taken(int from, int to) const;
+  int zero();
+  void sweep_unreachable();
+  void sweep_dead();
+
+  public:
+  DeadCodeElimination(Function &function);
+  void run();
+  //count of removed values in reachable code
+  int getremoved() const;
+  //count of unreachable blocks
+  int getunreachable() const;
+};
+
+}
+
+}
@@ -0,0 +1,404 @@
+#include "fold.hpp"
+#include "passes.hpp"
+
+#include <climits>
+
+namespace ptree {
+
+static const Imidiate<int> *literal(const PTree *unit) { return dynamic_cast<const Imidiate<int> *>(unit); }
+
+static bool is_compare(BinOpType operation) {
+  switch (operation) {
+  case BinOpType::EQUAL:
+  case BinOpType::MORE_EQUAL:
+  case BinOpType::LESS_EQUAL:
+  case BinOpType::NON_EQUAL:
+  case BinOpType::MORE:
+  case BinOpType::LESS:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool fold_binop(BinOpType operation, int lhs, int rhs, int &result) {
+  // arithmetic wraps around as in all engines
+  unsigned ulhs = lhs;
+  unsigned urhs = rhs;
+  switch (operation) {
+  case BinOpType::ADDITION:
+    result = static_cast<int>(ulhs + urhs);
+    return true;
+  case BinOpType::SUBTRACTION:
+    result = static_cast<int>(ulhs - urhs);
+    return true;
+  case BinOpType::MULTIPLICATION:
+    result = static_cast<int>(ulhs * urhs);
+    return true;
+  case BinOpType::DIVISION:
+  case BinOpType::REMAINDER:
+    if (rhs == 0 || (lhs == INT_MIN && rhs == -1))
+      return false;
+    result = operation == BinOpType::DIVISION ? lhs / rhs : lhs % rhs;
+    return true;
+  case BinOpType::EQUAL:
+    result = lhs == rhs;
+    return true;
+  case BinOpType::MORE_EQUAL:
+    result = lhs >= rhs;
+    return true;
+  case BinOpType::LESS_EQUAL:
+    result = lhs <= rhs;
+    return true;
+  case BinOpType::NON_EQUAL:
+    result = lhs != rhs;
+    return true;
+  case BinOpType::MORE:
+    result = lhs > rhs;
+    return true;
+  case BinOpType::LESS:
+    result = lhs < rhs;
+    return true;
+  case BinOpType::LOG_AND:
+    result = lhs && rhs;
+    return true;
+  case BinOpType::LOG_OR:
+    result = lhs || rhs;
+    return true;
+  case BinOpType::SHIFT_LEFT:
+  case BinOpType::SHIFT_RIGHT:
+    if (rhs < 0 || rhs >= 32)
+      return false;
+    result = operation == BinOpType::SHIFT_LEFT ? shift_left(lhs, rhs) : lhs >> rhs;
+    return true;
+  case BinOpType::BIT_AND:
+    result = lhs & rhs;
+    return true;
+  case BinOpType::MUL_HIGH:
+    result = mul_high(lhs, rhs);
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool is_pure(const PTree *unit) {
+  if (literal(unit) || dynamic_cast<const NameInt *>(unit))
+    return true;
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    if ((binop->operation_ == BinOpType::DIVISION || binop->operation_ == BinOpType::REMAINDER) && !binop->safe_) {
+      auto divisor = literal(binop->getright());
+      if (divisor == nullptr || divisor->getvalue() == 0 || divisor->getvalue() == -1)
+        return false;
+    }
+    return is_pure(binop->getleft()) && is_pure(binop->getright());
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit))
+    return (unop->operation_ == UnOpType::MINUS || unop->operation_ == UnOpType::NOT) && is_pure(unop->getleft());
+  return false;
+}
+
+bool is_bool(const PTree *unit) {
+  if (auto imidiate = literal(unit))
+    return imidiate->getvalue() == 0 || imidiate->getvalue() == 1;
+  if (auto binop = dynamic_cast<const BinOp *>(unit))
+    return is_compare(binop->operation_) || binop->operation_ == BinOpType::LOG_AND ||
+           binop->operation_ == BinOpType::LOG_OR;
+  if (auto unop = dynamic_cast<const UnOp *>(unit))
+    return unop->operation_ == UnOpType::NOT;
+  return false;
+}
+
+static bool matches(Match match, const PTree *unit, const PTree *other) {
+  auto imidiate = literal(unit);
+  auto binop = dynamic_cast<const BinOp *>(unit);
+  auto unop = dynamic_cast<const UnOp *>(unit);
+  switch (match) {
+  case Match::ANY:
+    return true;
+  case Match::CONST:
+    return imidiate != nullptr;
+  case Match::ZERO:
+    return imidiate && imidiate->getvalue() == 0;
+  case Match::ONE:
+    return imidiate && imidiate->getvalue() == 1;
+  case Match::NONZERO:
+    return imidiate && imidiate->getvalue() != 0;
+  case Match::PURE:
+    return is_pure(unit);
+  case Match::BOOL:
+    return is_bool(unit);
+  case Match::SAME: {
+    auto lhs = dynamic_cast<const NameInt *>(unit);
+    auto rhs = dynamic_cast<const NameInt *>(other);
+    return lhs && rhs && lhs->getoffset() >= 0 && lhs->getoffset() == rhs->getoffset();
+  }
+  case Match::ADD_CONST:
+    return binop && binop->operation_ == BinOpType::ADDITION && literal(binop->getright());
+  case Match::MUL_CONST:
+    return binop && binop->operation_ == BinOpType::MULTIPLICATION && literal(binop->getright());
+  case Match::NEGATED:
+    return unop && unop->operation_ == UnOpType::MINUS;
+  case Match::NOT_BOOL:
+    return unop && unop->operation_ == UnOpType::NOT && is_bool(unop->getleft());
+  case Match::COMPARE:
+    return binop && is_compare(binop->operation_);
+  }
+  return false;
+}
+
+//rewrite returns replacement of node or nullptr if rule is not applicable,
+//nodes which are not in replacement are deleted by rewrite
+using BinRewrite = PTree *(*)(BinOp *binop);
+using UnRewrite = PTree *(*)(UnOp *unop);
+
+struct BinRule {
+  const char *name;
+  BinOpType operation;
+  Match lhs;
+  Match rhs;
+  BinRewrite rewrite;
+};
+
+struct UnRule {
+  const char *name;
+  UnOpType operation;
+  Match operand;
+  UnRewrite rewrite;
+};
+
+static int value(const PTree *unit) { return literal(unit)->getvalue(); }
+
+//operand is detached from node, the rest of node subtree is deleted
+static PTree *take_left(PTree *unit) {
+  PTree *res = unit->getleft();
+  unit->setleft(nullptr);
+  delete_tree(unit);
+  return res;
+}
+
+static PTree *take_right(PTree *unit) {
+  PTree *res = unit->getright();
+  unit->setright(nullptr);
+  delete_tree(unit);
+  return res;
+}
+
+static PTree *left(BinOp *binop) { return take_left(binop); }
+static PTree *right(BinOp *binop) { return take_right(binop); }
+
+//operands are pure, so they are dropped with node
+static PTree *zero(BinOp *binop) {
+  delete_tree(binop);
+  return new Imidiate<int>(nullptr, 0);
+}
+
+static PTree *one(BinOp *binop) {
+  delete_tree(binop);
+  return new Imidiate<int>(nullptr, 1);
+}
+
+static PTree *nonzero_left(BinOp *binop) {
+  return new BinOp(BinOpType::NON_EQUAL, nullptr, take_left(binop), new Imidiate<int>(nullptr, 0));
+}
+
+static PTree *negate_right(BinOp *binop) { return new UnOp(UnOpType::MINUS, nullptr, take_right(binop)); }
+
+//literal goes to the right, operands have no side effects to reorder
+static PTree *swap(BinOp *binop) {
+  PTree *lhs = binop->getleft();
+  binop->setleft(binop->getright());
+  binop->setright(lhs);
+  return binop;
+}
+
+//x - c -> x + (-c)
+static PTree *add_negated(BinOp *binop) {
+  int rhs = value(binop->getright());
+  if (rhs == INT_MIN)
+    return nullptr;
+  binop->operation_ = BinOpType::ADDITION;
+  delete binop->getright();
+  binop->setright(new Imidiate<int>(nullptr, -rhs));
+  return binop;
+}
+
+//(x op c1) op c2 -> x op (c1 op c2)
+static PTree *reassociate(BinOp *binop) {
+  auto inner = static_cast<BinOp *>(binop->getleft());
+  int result;
+  if (!fold_binop(binop->operation_, value(inner->getright()), value(binop->getright()), result))
+    return nullptr;
+  binop->setleft(take_left(inner));
+  delete binop->getright();
+  binop->setright(new Imidiate<int>(nullptr, result));
+  return binop;
+}
+
+//(x + c) + y -> (x + y) + c
+static PTree *hoist_left(BinOp *binop) {
+  auto inner = static_cast<BinOp *>(binop->getleft());
+  PTree *constant = inner->getright();
+  inner->setright(binop->getright());
+  binop->setright(constant);
+  return binop;
+}
+
+//x + (y + c) -> (x + y) + c
+static PTree *hoist_right(BinOp *binop) {
+  auto inner = static_cast<BinOp *>(binop->getright());
+  PTree *lhs = binop->getleft();
+  PTree *constant = inner->getright();
+  inner->setright(inner->getleft());
+  inner->setleft(lhs);
+  binop->setleft(inner);
+  binop->setright(constant);
+  return binop;
+}
+
+static PTree *inner(UnOp *unop) {
+  unop->setleft(take_left(unop->getleft()));
+  return take_left(unop);
+}
+
+static PTree *fold_unop(UnOp *unop) {
+  int operand = value(unop->getleft());
+  bool minus = unop->operation_ == UnOpType::MINUS;
+  delete_tree(unop);
+  if (minus)
+    return new Imidiate<int>(nullptr, static_cast<int>(0u - static_cast<unsigned>(operand)));
+  return new Imidiate<int>(nullptr, !operand);
+}
+
+static PTree *invert_compare(UnOp *unop) {
+  auto compare = static_cast<BinOp *>(unop->getleft());
+  switch (compare->operation_) {
+  case BinOpType::EQUAL:
+    compare->operation_ = BinOpType::NON_EQUAL;
+    break;
+  case BinOpType::NON_EQUAL:
+    compare->operation_ = BinOpType::EQUAL;
+    break;
+  case BinOpType::LESS:
+    compare->operation_ = BinOpType::MORE_EQUAL;
+    break;
+  case BinOpType::MORE_EQUAL:
+    compare->operation_ = BinOpType::LESS;
+    break;
+  case BinOpType::MORE:
+    compare->operation_ = BinOpType::LESS_EQUAL;
+    break;
+  case BinOpType::LESS_EQUAL:
+    compare->operation_ = BinOpType::MORE;
+    break;
+  default:
+    return nullptr;
+  }
+  return take_left(unop);
+}
+
+//rules are tried in order, the first applicable one wins
+static const BinRule binrules[] = {
+    {"c + x", BinOpType::ADDITION, Match::CONST, Match::ANY, swap},
+    {"c * x", BinOpType::MULTIPLICATION, Match::CONST, Match::ANY, swap},
+    {"x + 0", BinOpType::ADDITION, Match::ANY, Match::ZERO, left},
+    {"x - 0", BinOpType::SUBTRACTION, Match::ANY, Match::ZERO, left},
+    {"0 - x", BinOpType::SUBTRACTION, Match::ZERO, Match::ANY, negate_right},
+    {"x - x", BinOpType::SUBTRACTION, Match::SAME, Match::SAME, zero},
+    {"x - c", BinOpType::SUBTRACTION, Match::ANY, Match::CONST, add_negated},
+    {"x * 1", BinOpType::MULTIPLICATION, Match::ANY, Match::ONE, left},
+    {"x * 0", BinOpType::MULTIPLICATION, Match::PURE, Match::ZERO, zero},
+    {"x / 1", BinOpType::DIVISION, Match::ANY, Match::ONE, left},
+    {"x % 1", BinOpType::REMAINDER, Match::PURE, Match::ONE, zero},
+    {"(x + c) + c", BinOpType::ADDITION, Match::ADD_CONST, Match::CONST, reassociate},
+    {"(x * c) * c", BinOpType::MULTIPLICATION, Match::MUL_CONST, Match::CONST, reassociate},
+    {"(x + c) + y", BinOpType::ADDITION, Match::ADD_CONST, Match::ANY, hoist_left},
+    {"x + (y + c)", BinOpType::ADDITION, Match::ANY, Match::ADD_CONST, hoist_right},
+    {"x == x", BinOpType::EQUAL, Match::SAME, Match::SAME, one},
+    {"x >= x", BinOpType::MORE_EQUAL, Match::SAME, Match::SAME, one},
+    {"x <= x", BinOpType::LESS_EQUAL, Match::SAME, Match::SAME, one},
+    {"x != x", BinOpType::NON_EQUAL, Match::SAME, Match::SAME, zero},
+    {"x > x", BinOpType::MORE, Match::SAME, Match::SAME, zero},
+    {"x < x", BinOpType::LESS, Match::SAME, Match::SAME, zero},
+    {"x && 0", BinOpType::LOG_AND, Match::PURE, Match::ZERO, zero},
+    {"0 && x", BinOpType::LOG_AND, Match::ZERO, Match::PURE, zero},
+    {"b && c", BinOpType::LOG_AND, Match::BOOL, Match::NONZERO, left},
+    {"c && b", BinOpType::LOG_AND, Match::NONZERO, Match::BOOL, right},
+    {"x && c", BinOpType::LOG_AND, Match::ANY, Match::NONZERO, nonzero_left},
+    {"x || c", BinOpType::LOG_OR, Match::PURE, Match::NONZERO, one},
+    {"c || x", BinOpType::LOG_OR, Match::NONZERO, Match::PURE, one},
+    {"b || 0", BinOpType::LOG_OR, Match::BOOL, Match::ZERO, left},
+    {"0 || b", BinOpType::LOG_OR, Match::ZERO, Match::BOOL, right},
+    {"x || 0", BinOpType::LOG_OR, Match::ANY, Match::ZERO, nonzero_left},
+};
+
+static const UnRule unrules[] = {
+    {"-c", UnOpType::MINUS, Match::CONST, fold_unop},
+    {"!c", UnOpType::NOT, Match::CONST, fold_unop},
+    {"--x", UnOpType::MINUS, Match::NEGATED, inner},
+    {"!!b", UnOpType::NOT, Match::NOT_BOOL, inner},
+    {"!(x < y)", UnOpType::NOT, Match::COMPARE, invert_compare},
+};
+
+PTree *Folder::simplify(BinOp *binop) {
+  PTree *lhs = binop->getleft();
+  PTree *rhs = binop->getright();
+  int result;
+  if (literal(lhs) && literal(rhs) && fold_binop(binop->operation_, value(lhs), value(rhs), result)) {
+    applied_.push_back("c op c");
+    delete_tree(binop);
+    return new Imidiate<int>(nullptr, result);
+  }
+  for (auto &rule : binrules) {
+    if (rule.operation != binop->operation_ || !matches(rule.lhs, lhs, rhs) || !matches(rule.rhs, rhs, lhs))
+      continue;
+    PTree *replacement = rule.rewrite(binop);
+    if (replacement == nullptr)
+      continue;
+    applied_.push_back(rule.name);
+    // rewritten node and its operands can match other rules
+    return rewrite(replacement);
+  }
+  return binop;
+}
+
+PTree *Folder::simplify(UnOp *unop) {
+  for (auto &rule : unrules) {
+    if (rule.operation != unop->operation_ || !matches(rule.operand, unop->getleft(), nullptr))
+      continue;
+    PTree *replacement = rule.rewrite(unop);
+    if (replacement == nullptr)
+      continue;
+    applied_.push_back(rule.name);
+    return rewrite(replacement);
+  }
+  return unop;
+}
+
+PTree *Folder::rewrite(PTree *unit) {
+  if (unit == nullptr)
+    return nullptr;
+  if (auto block = dynamic_cast<Block *>(unit)) {
+    for (auto &expr : block->operations)
+      expr = rewrite(expr);
+    return block;
+  }
+  if (auto branch = dynamic_cast<Branch *>(unit))
+    rewrite(branch->condition_);
+  if (auto unop = dynamic_cast<UnOp *>(unit)) {
+    // operand of increment is variable
+    if (unop->operation_ == UnOpType::POST_ADDITION || unop->operation_ == UnOpType::POST_SUBTRACTION)
+      return unop;
+    unop->setleft(rewrite(unop->getleft()));
+    return simplify(unop);
+  }
+  unit->setleft(rewrite(unit->getleft()));
+  unit->setright(rewrite(unit->getright()));
+  if (auto binop = dynamic_cast<BinOp *>(unit))
+    return simplify(binop);
+  return unit;
+}
+
+const std::vector<std::string> &Folder::getapplied() const { return applied_; }
+
+}
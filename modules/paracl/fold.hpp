@@ -0,0 +1,55 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+fold structure:
+1) Match - pattern of operand in rewrite rule (literal, zero, one, pure expression, ...)
+2) BinRule/UnRule - rows of rule tables in fold.cpp: operation, operand patterns and rewrite,
+   new rule is a new row
+3) Folder - rewrites tree bottom up: constant subtrees are evaluated, then rules are applied
+   to each node until none matches
+*/
+
+namespace ptree {
+
+enum class Match {
+  ANY,
+  CONST,     //Imidiate<int>
+  ZERO,      //literal 0
+  ONE,       //literal 1
+  NONZERO,   //literal not equal to 0
+  PURE,      //expression without side effects and traps, it can be dropped
+  BOOL,      //expression with value 0 or 1
+  SAME,      //variable equal to the other operand
+  ADD_CONST, //x + literal
+  MUL_CONST, //x * literal
+  NEGATED,   //-x
+  NOT_BOOL,  //!x where x is BOOL
+  COMPARE    //comparison
+};
+
+//evaluate binary operation on literals with wrap around, return false if it traps
+bool fold_binop(BinOpType operation, int lhs, int rhs, int &result);
+//return true if expression has no side effects and can not trap
+bool is_pure(const PTree *unit);
+//return true if expression value is 0 or 1
+bool is_bool(const PTree *unit);
+
+class Folder {
+  std::vector<std::string> applied_;
+
+  PTree *simplify(BinOp *binop);
+  PTree *simplify(UnOp *unop);
+
+  public:
+  //rewrite tree in place, return new root, replaced nodes are deleted
+  PTree *rewrite(PTree *unit);
+  //names of applied rules in order of application
+  const std::vector<std::string> &getapplied() const;
+};
+
+}
@@ -0,0 +1,84 @@
+#include "gvn.hpp"
+
+#include <algorithm>
+
+namespace ptree {
+
+namespace ssa {
+
+static bool is_commutative(BinOpType op) {
+  return op == BinOpType::ADDITION || op == BinOpType::MULTIPLICATION || op == BinOpType::EQUAL ||
+         op == BinOpType::NON_EQUAL || op == BinOpType::LOG_AND || op == BinOpType::LOG_OR ||
+         op == BinOpType::BIT_AND || op == BinOpType::MUL_HIGH;
+}
+
+ValueNumbering::ValueNumbering(Function &function) : f_(function) {}
+
+//operations are equal if their keys are equal, a > b is the same as b < a
+bool ValueNumbering::key(int id, Key &result) const {
+  const Instr &instr = f_.instrs[id];
+  BinOpType binop = instr.binop;
+  std::vector<int> operands = instr.operands;
+  int imm = instr.imm;
+  switch (instr.op) {
+  case Op::CONST:
+  case Op::ENTRY:
+  case Op::NEG:
+  case Op::NOT:
+    break;
+  case Op::PHI:
+    // phis of different blocks choose by different edges
+    imm = instr.block;
+    break;
+  case Op::BINARY:
+    if (binop == BinOpType::MORE || binop == BinOpType::MORE_EQUAL) {
+      binop = binop == BinOpType::MORE ? BinOpType::LESS : BinOpType::LESS_EQUAL;
+      std::swap(operands[0], operands[1]);
+    } else if (is_commutative(binop) && operands[0] > operands[1]) {
+      std::swap(operands[0], operands[1]);
+    }
+    break;
+  default:
+    return false;
+  }
+  result = Key{instr.op, binop, imm, std::move(operands)};
+  return true;
+}
+
+//values of block are visible in blocks which it dominates
+void ValueNumbering::visit(int block) {
+  std::vector<Key> scope;
+  std::vector<int> instrs = f_.blocks[block].instrs;
+  for (int id : instrs) {
+    Key k;
+    if (!key(id, k))
+      continue;
+    auto found = table_.find(k);
+    if (found == table_.end()) {
+      table_.emplace(k, id);
+      scope.push_back(std::move(k));
+      continue;
+    }
+    // division which traps does it in dominating block first
+    if (f_.instrs[id].op != Op::CONST)
+      ++removed_;
+    f_.replace_uses(id, found->second);
+    f_.erase(id);
+  }
+  for (int child : f_.blocks[block].children)
+    visit(child);
+  for (auto &k : scope)
+    table_.erase(k);
+}
+
+void ValueNumbering::run() {
+  f_.compute_dominators();
+  f_.compute_uses();
+  visit(0);
+}
+
+int ValueNumbering::getremoved() const { return removed_; }
+
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace ptree {
+
+namespace ssa {
+
+//global value numbering on dominator tree: operation with the same operands as an operation
+//in dominating block is replaced by its value (the value gets a temporary slot when tree is
+//rebuilt); assignments, ++, -- and ? define new SSA values, so reads after them never match
+class ValueNumbering {
+  using Key = std::tuple<Op, BinOpType, int, std::vector<int>>;
+
+  Function &f_;
+  std::map<Key, int> table_;
+  int removed_ = 0;
+
+  bool key(int id, Key &result) const;
+  void visit(int block);
+
+  public:
+  ValueNumbering(Function &function);
+  void run();
+  //count of removed redundant operations
+  int getremoved() const;
+};
+
+}
+
+}
@@ -0,0 +1,160 @@
+#include "ifconv.hpp"
+
+namespace ptree {
+
+namespace ssa {
+
+//operations which give 0 or 1
+static bool is_boolean(const Instr &instr) {
+  if (instr.op == Op::NOT)
+    return true;
+  if (instr.op != Op::BINARY)
+    return false;
+  switch (instr.binop) {
+  case BinOpType::EQUAL:
+  case BinOpType::NON_EQUAL:
+  case BinOpType::LESS:
+  case BinOpType::LESS_EQUAL:
+  case BinOpType::MORE:
+  case BinOpType::MORE_EQUAL:
+  case BinOpType::LOG_AND:
+  case BinOpType::LOG_OR:
+    return true;
+  default:
+    return false;
+  }
+}
+
+IfConversion::IfConversion(Function &function) : f_(function) {}
+
+int IfConversion::constant(int value) {
+  Instr instr;
+  instr.op = Op::CONST;
+  instr.imm = value;
+  return f_.insert(0, instr);
+}
+
+int IfConversion::emit(int block, Op op, BinOpType binop, std::vector<int> operands) {
+  Instr instr;
+  instr.op = op;
+  instr.binop = binop;
+  instr.operands = std::move(operands);
+  return f_.insert(block, instr);
+}
+
+//arms are sequences of code regions, so all their blocks run one after another
+bool IfConversion::convert(std::vector<Region> &seq, size_t index) {
+  const Region &region = seq[index];
+  int head = region.block;
+  int merge = region.merge;
+  std::vector<int> ends;
+  std::vector<int> moved;
+  for (auto &arm : region.arms) {
+    size_t size = 0;
+    for (auto &inner : arm) {
+      if (inner.kind != Region::Kind::Code)
+        return false;
+      for (int id : f_.blocks[inner.block].instrs) {
+        const Instr &instr = f_.instrs[id];
+        if (instr.op == Op::BR)
+          continue;
+        // division is slower than a mispredicted branch, strength reduction can remove it first
+        if ((instr.op != Op::BINARY && instr.op != Op::NEG && instr.op != Op::NOT && instr.op != Op::CONST) ||
+            instr.binop == BinOpType::DIVISION || instr.binop == BinOpType::REMAINDER)
+          return false;
+        moved.push_back(id);
+        ++size;
+      }
+    }
+    if (size > arm_limit)
+      return false;
+    ends.push_back(arm.back().block);
+  }
+  const std::vector<int> &preds = f_.blocks[merge].preds;
+  if (preds.size() != 2)
+    return false;
+  size_t thenindex = preds[0] == ends[0] ? 0 : 1;
+  std::vector<int> phis;
+  for (int id : f_.blocks[merge].instrs)
+    if (f_.instrs[id].op == Op::PHI)
+      phis.push_back(id);
+  if (phis.empty())
+    return false;
+
+  for (int id : moved)
+    f_.move(id, head);
+  int branch = f_.blocks[head].instrs.back();
+  int cond = f_.instrs[branch].operands[0];
+  if (!is_boolean(f_.instrs[cond]))
+    cond = emit(head, Op::BINARY, BinOpType::NON_EQUAL, {cond, constant(0)});
+  int mask = -1;
+  for (int phi : phis) {
+    int thenvalue = f_.instrs[phi].operands[thenindex];
+    int elsevalue = f_.instrs[phi].operands[1 - thenindex];
+    const Instr lhs = f_.instrs[thenvalue];
+    const Instr rhs = f_.instrs[elsevalue];
+    int result;
+    if (thenvalue == elsevalue) {
+      result = thenvalue;
+    } else if (lhs.op == Op::CONST && rhs.op == Op::CONST && lhs.imm == 1 && rhs.imm == 0) {
+      result = cond;
+    } else {
+      if (mask < 0)
+        mask = emit(head, Op::NEG, BinOpType::UNDEF, {cond});
+      int difference;
+      if (lhs.op == Op::CONST && rhs.op == Op::CONST)
+        difference = constant(static_cast<unsigned>(lhs.imm) - static_cast<unsigned>(rhs.imm));
+      else
+        difference = emit(head, Op::BINARY, BinOpType::SUBTRACTION, {thenvalue, elsevalue});
+      result = emit(head, Op::BINARY, BinOpType::BIT_AND, {difference, mask});
+      if (rhs.op != Op::CONST || rhs.imm != 0)
+        result = emit(head, Op::BINARY, BinOpType::ADDITION, {elsevalue, result});
+      ++selects_;
+    }
+    f_.replace_uses(phi, result);
+    f_.erase(phi);
+  }
+
+  // head jumps to merge block, arms are left without predecessors
+  f_.instrs[branch].op = Op::BR;
+  f_.instrs[branch].operands.clear();
+  for (auto &arm : region.arms)
+    for (auto &inner : arm) {
+      for (int id : f_.blocks[inner.block].instrs)
+        f_.instrs[id].block = -1;
+      f_.blocks[inner.block].instrs.clear();
+      f_.blocks[inner.block].preds.clear();
+      f_.blocks[inner.block].succs.clear();
+    }
+  f_.blocks[head].succs = {merge};
+  f_.blocks[merge].preds = {head};
+  seq.erase(seq.begin() + index);
+  ++converted_;
+  return true;
+}
+
+//inner ifs are converted first, so their arms become straight code of outer arms
+void IfConversion::optimize(std::vector<Region> &seq) {
+  for (size_t i = 0; i < seq.size(); ++i) {
+    if (seq[i].kind == Region::Kind::Code)
+      continue;
+    for (auto &arm : seq[i].arms)
+      optimize(arm);
+    if (seq[i].kind == Region::Kind::If && convert(seq, i))
+      --i;
+  }
+}
+
+void IfConversion::run() {
+  f_.compute_uses();
+  optimize(f_.body);
+  f_.compute_dominators();
+}
+
+int IfConversion::getconverted() const { return converted_; }
+
+int IfConversion::getselects() const { return selects_; }
+
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <vector>
+
+namespace ptree {
+
+namespace ssa {
+
+//if-conversion: if which only computes values (no print, ?, loops or divisions)
+//computes both arms before the condition and merges them without branch,
+//select(c, a, b) is b + ((a - b) & -c) for c equal to 0 or 1
+class IfConversion {
+  Function &f_;
+  int converted_ = 0;
+  int selects_ = 0;
+
+  int constant(int value);
+  int emit(int block, Op op, BinOpType binop, std::vector<int> operands);
+  bool convert(std::vector<Region> &seq, size_t index);
+  void optimize(std::vector<Region> &seq);
+
+  public:
+  //arms with more instructions are left with branch
+  static const size_t arm_limit = 8;
+
+  IfConversion(Function &function);
+  void run();
+  //count of removed ifs
+  int getconverted() const;
+  //count of selects which replaced phis
+  int getselects() const;
+};
+
+}
+
+}
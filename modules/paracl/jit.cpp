@@ -0,0 +1,393 @@
+#include "jit.hpp"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef PCL_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+namespace ptree {
+
+//runtime helpers called from native code
+static void jit_print(int value) { std::cout << value << std::endl; }
+
+static int jit_input() { return readint(); }
+
+JitCode::JitCode(const std::vector<unsigned char> &code) : memory_(nullptr), size_(code.size()) {
+#ifdef PCL_JIT_X86_64
+  memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory_ == MAP_FAILED)
+    throw std::runtime_error{"Can not allocate memory for native code"};
+  memcpy(memory_, code.data(), size_);
+  if (mprotect(memory_, size_, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory_, size_);
+    throw std::runtime_error{"Can not make native code executable"};
+  }
+#else
+  throw std::runtime_error{"Native code is not supported on this target"};
+#endif
+}
+
+JitCode::~JitCode() {
+#ifdef PCL_JIT_X86_64
+  if (memory_ != nullptr)
+    munmap(memory_, size_);
+#endif
+}
+
+void JitCode::run(Stack *stack) const {
+  using entry_t = void (*)(char *);
+  reinterpret_cast<entry_t>(memory_)(stack->getmemory());
+}
+
+int JitCode::enter(Stack *stack) const {
+  using entry_t = int (*)(char *);
+  return reinterpret_cast<entry_t>(memory_)(stack->getmemory());
+}
+
+// x86-64 encoding helpers, rbx keeps address of Stack memory
+namespace {
+const unsigned char RAX = 0x58;
+// condition codes for jcc (0x0F 0x80 + cc) and setcc (0x0F 0x90 + cc)
+const unsigned char CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF;
+
+bool relational(BinOpType operation, unsigned char &cc) {
+  switch (operation) {
+  case BinOpType::EQUAL:
+    cc = CC_E;
+    return true;
+  case BinOpType::NON_EQUAL:
+    cc = CC_NE;
+    return true;
+  case BinOpType::LESS:
+    cc = CC_L;
+    return true;
+  case BinOpType::MORE_EQUAL:
+    cc = CC_GE;
+    return true;
+  case BinOpType::LESS_EQUAL:
+    cc = CC_LE;
+    return true;
+  case BinOpType::MORE:
+    cc = CC_G;
+    return true;
+  default:
+    return false;
+  }
+}
+} // namespace
+
+void JitCompiler::byte(unsigned char value) { code_.push_back(value); }
+
+void JitCompiler::dword(int value) {
+  unsigned char bytes[sizeof(value)];
+  memcpy(bytes, &value, sizeof(value));
+  code_.insert(code_.end(), bytes, bytes + sizeof(value));
+}
+
+void JitCompiler::qword(unsigned long long value) {
+  unsigned char bytes[sizeof(value)];
+  memcpy(bytes, &value, sizeof(value));
+  code_.insert(code_.end(), bytes, bytes + sizeof(value));
+}
+
+int JitCompiler::newlabel() {
+  labels_.push_back(-1);
+  return labels_.size() - 1;
+}
+
+void JitCompiler::bind(int label) { labels_[label] = code_.size(); }
+
+void JitCompiler::rel32(int label) {
+  fixups_.emplace_back(code_.size(), label);
+  dword(0);
+}
+
+void JitCompiler::call(const void *function) {
+  // native stack should be aligned to 16 bytes before call
+  bool align = depth_ % 2 != 0;
+  if (align) {
+    byte(0x48); byte(0x83); byte(0xEC); byte(0x08); // sub rsp, 8
+  }
+  byte(0x48); byte(0xB8); // mov rax, imm64
+  qword(reinterpret_cast<unsigned long long>(function));
+  byte(0xFF); byte(0xD0); // call rax
+  if (align) {
+    byte(0x48); byte(0x83); byte(0xC4); byte(0x08); // add rsp, 8
+  }
+}
+
+void JitCompiler::push_eax() {
+  byte(0x50); // push rax
+  ++depth_;
+}
+
+void JitCompiler::pop(unsigned char opcode) {
+  byte(opcode);
+  --depth_;
+}
+
+int JitCompiler::offset(const NameInt *var) {
+  if (var->getoffset() < 0)
+    throw jit_unsupported{"usage of undeclared variable " + var->getvarname()};
+  return var->getoffset();
+}
+
+bool JitCompiler::load_ecx(const PTree *unit) {
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit)) {
+    byte(0xB9); // mov ecx, imm32
+    dword(imidiate->getvalue());
+    return true;
+  }
+  if (auto nameint = dynamic_cast<const NameInt *>(unit)) {
+    byte(0x8B); byte(0x8B); // mov ecx, [rbx + disp32]
+    dword(offset(nameint));
+    return true;
+  }
+  return false;
+}
+
+void JitCompiler::compile_operands(const BinOp *binop) {
+  compile_expr(binop->getleft());
+  if (load_ecx(binop->getright()))
+    return;
+  push_eax();
+  compile_expr(binop->getright());
+  byte(0x89); byte(0xC1); // mov ecx, eax
+  pop(RAX);
+}
+
+void JitCompiler::compile_expr(const PTree *unit) {
+  if (unit == nullptr)
+    throw jit_unsupported{"missing operand"};
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit)) {
+    byte(0xB8); // mov eax, imm32
+    dword(imidiate->getvalue());
+    return;
+  }
+  if (auto nameint = dynamic_cast<const NameInt *>(unit)) {
+    byte(0x8B); byte(0x83); // mov eax, [rbx + disp32]
+    dword(offset(nameint));
+    return;
+  }
+  if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw jit_unsupported{"reserved word without value"};
+    call(reinterpret_cast<const void *>(&jit_input));
+    return;
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    compile_operands(binop);
+    unsigned char cc;
+    if (relational(binop->operation_, cc)) {
+      byte(0x39); byte(0xC8);             // cmp eax, ecx
+      byte(0x0F); byte(0x90 | cc); byte(0xC0); // setcc al
+      byte(0x0F); byte(0xB6); byte(0xC0); // movzx eax, al
+      return;
+    }
+    switch (binop->operation_) {
+    case BinOpType::ADDITION:
+      byte(0x01); byte(0xC8); // add eax, ecx
+      return;
+    case BinOpType::SUBTRACTION:
+      byte(0x29); byte(0xC8); // sub eax, ecx
+      return;
+    case BinOpType::MULTIPLICATION:
+      byte(0x0F); byte(0xAF); byte(0xC1); // imul eax, ecx
+      return;
+    case BinOpType::DIVISION:
+      byte(0x99);             // cdq
+      byte(0xF7); byte(0xF9); // idiv ecx
+      return;
+    case BinOpType::REMAINDER:
+      byte(0x99);             // cdq
+      byte(0xF7); byte(0xF9); // idiv ecx
+      byte(0x89); byte(0xD0); // mov eax, edx
+      return;
+    case BinOpType::LOG_AND:
+    case BinOpType::LOG_OR:
+      byte(0x85); byte(0xC0);             // test eax, eax
+      byte(0x0F); byte(0x95); byte(0xC0); // setne al
+      byte(0x85); byte(0xC9);             // test ecx, ecx
+      byte(0x0F); byte(0x95); byte(0xC1); // setne cl
+      // and al, cl / or al, cl
+      byte(binop->operation_ == BinOpType::LOG_AND ? 0x20 : 0x08); byte(0xC8);
+      byte(0x0F); byte(0xB6); byte(0xC0); // movzx eax, al
+      return;
+    case BinOpType::SHIFT_LEFT:
+      byte(0xD3); byte(0xE0); // shl eax, cl
+      return;
+    case BinOpType::SHIFT_RIGHT:
+      byte(0xD3); byte(0xF8); // sar eax, cl
+      return;
+    case BinOpType::BIT_AND:
+      byte(0x21); byte(0xC8); // and eax, ecx
+      return;
+    case BinOpType::MUL_HIGH:
+      byte(0xF7); byte(0xE9); // imul ecx
+      byte(0x89); byte(0xD0); // mov eax, edx
+      return;
+    default:
+      throw jit_unsupported{"binary operation " + binop->get_op()};
+    }
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    switch (unop->operation_) {
+    case UnOpType::POST_ADDITION:
+    case UnOpType::POST_SUBTRACTION: {
+      auto var = dynamic_cast<const NameInt *>(unop->getleft());
+      if (var == nullptr)
+        throw jit_unsupported{"increment of not a variable"};
+      // inc/dec dword [rbx + disp32]
+      byte(0xFF); byte(unop->operation_ == UnOpType::POST_ADDITION ? 0x83 : 0x8B);
+      dword(offset(var));
+      byte(0x8B); byte(0x83); // mov eax, [rbx + disp32]
+      dword(offset(var));
+      return;
+    }
+    case UnOpType::MINUS:
+      compile_expr(unop->getleft());
+      byte(0xF7); byte(0xD8); // neg eax
+      return;
+    case UnOpType::NOT:
+      compile_expr(unop->getleft());
+      byte(0x85); byte(0xC0);             // test eax, eax
+      byte(0x0F); byte(0x94); byte(0xC0); // sete al
+      byte(0x0F); byte(0xB6); byte(0xC0); // movzx eax, al
+      return;
+    default:
+      throw jit_unsupported{"unary operation " + unop->get_op()};
+    }
+  }
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    compile_expr(assign->getright());
+    byte(0x89); byte(0x83); // mov [rbx + disp32], eax
+    dword(offset(assign->lval));
+    return;
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    compile_expr(output->getright());
+    push_eax();
+    byte(0x89); byte(0xC7); // mov edi, eax
+    call(reinterpret_cast<const void *>(&jit_print));
+    pop(RAX);
+    return;
+  }
+  if (auto condition = dynamic_cast<const Condition *>(unit)) {
+    compile_expr(condition->getleft());
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    compile_expr(expression->getright());
+    return;
+  }
+  throw jit_unsupported{"node can not be compiled to native code"};
+}
+
+void JitCompiler::compile_branch(const PTree *unit, int label, bool jump_if) {
+  if (auto condition = dynamic_cast<const Condition *>(unit)) {
+    compile_branch(condition->getleft(), label, jump_if);
+    return;
+  }
+  auto binop = dynamic_cast<const BinOp *>(unit);
+  unsigned char cc;
+  if (binop != nullptr && relational(binop->operation_, cc)) {
+    compile_operands(binop);
+    byte(0x39); byte(0xC8); // cmp eax, ecx
+    // inverted condition code differs only in the lowest bit
+    byte(0x0F); byte(0x80 | (jump_if ? cc : cc ^ 1)); // jcc rel32
+    rel32(label);
+    return;
+  }
+  compile_expr(unit);
+  byte(0x85); byte(0xC0); // test eax, eax
+  byte(0x0F); byte(jump_if ? 0x85 : 0x84); // jnz/jz rel32
+  rel32(label);
+}
+
+void JitCompiler::compile_stmt(const PTree *unit) {
+  if (unit == nullptr)
+    return;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      compile_stmt(expr);
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw jit_unsupported{"missing condition in if block"};
+    int else_label = newlabel();
+    compile_branch(ifblock->condition_, else_label, false);
+    compile_stmt(ifblock->getright());
+    if (ifblock->getleft() != nullptr) {
+      int end_label = newlabel();
+      byte(0xE9); // jmp rel32
+      rel32(end_label);
+      bind(else_label);
+      compile_stmt(ifblock->getleft());
+      bind(end_label);
+    } else {
+      bind(else_label);
+    }
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw jit_unsupported{"missing condition in while cycle"};
+    int body_label = newlabel();
+    int cond_label = newlabel();
+    byte(0xE9); // jmp rel32
+    rel32(cond_label);
+    bind(body_label);
+    compile_stmt(whileblock->getleft());
+    bind(cond_label);
+    compile_branch(whileblock->condition_, body_label, true);
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    compile_stmt(expression->getright());
+    return;
+  }
+  compile_expr(unit);
+}
+
+void JitCompiler::reset() {
+  code_.clear();
+  labels_.clear();
+  fixups_.clear();
+  depth_ = 0;
+  error_.clear();
+}
+
+std::unique_ptr<JitCode> JitCompiler::finish() {
+  for (auto &fixup : fixups_) {
+    int target = labels_[fixup.second] - (fixup.first + 4);
+    memcpy(code_.data() + fixup.first, &target, sizeof(target));
+  }
+  return std::unique_ptr<JitCode>{new JitCode(code_)};
+}
+
+std::unique_ptr<JitCode> JitCompiler::compile(const PTree *root) {
+#ifdef PCL_JIT_X86_64
+  reset();
+  try {
+    byte(0x53);                         // push rbx
+    byte(0x48); byte(0x89); byte(0xFB); // mov rbx, rdi
+    compile_stmt(root);
+    byte(0x5B); // pop rbx
+    byte(0xC3); // ret
+  } catch (jit_unsupported &e) {
+    error_ = e.what();
+    return std::unique_ptr<JitCode>{};
+  }
+  return finish();
+#else
+  error_ = "native code generation is not supported on this target";
+  return std::unique_ptr<JitCode>{};
+#endif
+}
+
+std::string JitCompiler::geterror() const { return error_; }
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+//native code generation is available only for x86-64 unix systems,
+//on other targets JitCompiler always reports fail
+#if defined(__x86_64__) && defined(__unix__)
+#define PCL_JIT_X86_64
+#endif
+
+namespace ptree {
+
+//native code made by JitCompiler, owns executable memory
+class JitCode {
+  void *memory_;
+  size_t size_;
+public:
+  //copy code to executable memory
+  JitCode(const std::vector<unsigned char> &code);
+  ~JitCode();
+  JitCode(const JitCode &other) = delete;
+  JitCode &operator=(const JitCode &other) = delete;
+  //run code, variables are kept in stack memory on their offsets
+  void run(Stack *stack) const;
+  //run code and return its exit code (eax value at return)
+  int enter(Stack *stack) const;
+};
+
+//thrown when tree contains construct which JitCompiler can not compile
+class jit_unsupported : public std::runtime_error {
+public:
+  jit_unsupported(const std::string &what) : std::runtime_error(what) {}
+};
+
+//compiles whole tree (after manage_tree_mem) to x86-64 code,
+//expression value is kept in eax, temporary values are pushed to native stack
+class JitCompiler {
+protected:
+  std::vector<unsigned char> code_;
+  std::vector<int> labels_;
+  std::vector<std::pair<int, int>> fixups_;
+  int depth_ = 0;
+  std::string error_;
+
+  void byte(unsigned char value);
+  void dword(int value);
+  void qword(unsigned long long value);
+  int newlabel();
+  void bind(int label);
+  //emit rel32 field which will be resolved to label address
+  void rel32(int label);
+  //emit call to runtime helper with respect to stack alignment
+  void call(const void *function);
+  void push_eax();
+  void pop(unsigned char opcode);
+  //load leaf value to ecx, return false if node is not a leaf
+  bool load_ecx(const PTree *unit);
+  int offset(const NameInt *var);
+
+  void compile_stmt(const PTree *unit);
+  void compile_expr(const PTree *unit);
+  //evaluate operands of binary operation to eax (left) and ecx (right)
+  void compile_operands(const BinOp *binop);
+  //jump to label if condition value equals jump_if
+  void compile_branch(const PTree *unit, int label, bool jump_if);
+  //clear state before compilation
+  void reset();
+  //resolve labels and copy code to executable memory
+  std::unique_ptr<JitCode> finish();
+public:
+  //compile tree to native code, return nullptr if it can not be compiled
+  std::unique_ptr<JitCode> compile(const PTree *root);
+  //return reason of the last compilation fail
+  std::string geterror() const;
+};
+
+}
@@ -10,13 +10,17 @@ std::unique_ptr<PTree> Leaf::execute(Stack *stack) const {
   return std::unique_ptr<PTree>{};
 }
 
-std::unique_ptr<PTree> intinput() {
-  int x;
+int readint() {
+  int x = 0;
   std::cin >> x;
 #ifdef DBG_CALL
   std::cout << "Input called" << std::endl;
 #endif
-  return std::unique_ptr<PTree>(new Imidiate<int>(x)); 
+  return x;
+}
+
+std::unique_ptr<PTree> intinput() {
+  return std::unique_ptr<PTree>(new Imidiate<int>(readint())); 
 }
 
 Reserved::Reserved(PTree* parent, Reserved::Types type) : Leaf(parent), type_(type) {}
@@ -34,7 +38,7 @@ std::string Reserved::typetostr() const {
   }
   return "Smth strange";
 }
-std::unique_ptr<PTree> Reserved::execute(Stack *stack) const {
+std::unique_ptr<PTree> Reserved::execute(Stack *) const {
 #ifdef DBG_CALL
     std::cout << "Resrved called" << std::endl;
 #endif
@@ -46,6 +50,11 @@ std::unique_ptr<PTree> Reserved::execute(Stack *stack) const {
     }
     return std::unique_ptr<PTree>{};
 }
+int Reserved::eval(Stack *) const {
+  if (gettype() != Types::Input)
+    throw std::logic_error{"Reserved word has no value"};
+  return readint();
+}
 std::string Reserved::dump() const {
   std::string res;
   std::string parentname = getparent()->getname();
@@ -93,5 +102,8 @@ std::string NameInt::dump() const {
 std::unique_ptr<PTree> NameInt::execute(Stack *stack) const {
   return std::unique_ptr<PTree>{new Imidiate<int>(getvalue(stack))};
 }
+int NameInt::eval(Stack *stack) const {
+  return getvalue(stack);
+}
 
 }
\ No newline at end of file
@@ -35,11 +35,16 @@ public:
     return res;
   }
 
-  std::unique_ptr<PTree> execute(Stack *stack = nullptr) const override {
+  std::unique_ptr<PTree> execute(Stack * = nullptr) const override {
     return std::unique_ptr<PTree>{new Imidiate<int>(*this)}; 
   }
+  int eval(Stack * = nullptr) const override {
+    return value_;
+  }
 };
 
+//read integer from stdin, missing or bad input is 0, every engine reads input with it
+int readint();
 std::unique_ptr<PTree> intinput();
 
 class Reserved : public Leaf {
@@ -55,6 +60,7 @@ public:
   Types gettype() const;
   std::string typetostr() const;
   virtual std::unique_ptr<PTree> execute(Stack *stack = nullptr) const override;
+  virtual int eval(Stack *stack = nullptr) const override;
   virtual std::string dump() const override;
 };
 
@@ -87,6 +93,7 @@ public:
 
   virtual std::string dump() const override;
   std::unique_ptr<PTree> execute(Stack *stack) const override;
+  int eval(Stack *stack) const override;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "licm.hpp"
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+namespace ptree {
+
+namespace ssa {
+
+//blocks of region sequence, inner loops are included
+static void collect_blocks(const std::vector<Region> &seq, std::set<int> &out) {
+  for (auto &region : seq) {
+    out.insert(region.block);
+    for (auto &arm : region.arms)
+      collect_blocks(arm, out);
+  }
+}
+
+static std::set<int> loop_blocks(const Region &loop) {
+  std::set<int> blocks{loop.block};
+  collect_blocks(loop.arms[0], blocks);
+  return blocks;
+}
+
+static Region clone_region(const Region &region, const std::unordered_map<int, int> &blockmap) {
+  Region res{region.kind, blockmap.at(region.block), region.merge, {}};
+  if (region.merge >= 0)
+    res.merge = blockmap.count(region.merge) ? blockmap.at(region.merge) : region.merge;
+  for (auto &arm : region.arms) {
+    res.arms.emplace_back();
+    for (auto &inner : arm)
+      res.arms.back().push_back(clone_region(inner, blockmap));
+  }
+  return res;
+}
+
+LoopInvariantMotion::LoopInvariantMotion(Function &function) : f_(function) {}
+
+int LoopInvariantMotion::newblock() {
+  f_.blocks.emplace_back();
+  return f_.blocks.size() - 1;
+}
+
+//first predecessor of header is the block before loop, the other one is the end of body
+void LoopInvariantMotion::hoist(const Region &loop) {
+  std::set<int> inside = loop_blocks(loop);
+  int preheader = f_.blocks[loop.block].preds[0];
+  for (int b : f_.reverse_postorder()) {
+    if (!inside.count(b))
+      continue;
+    std::vector<int> instrs = f_.blocks[b].instrs;
+    for (int id : instrs) {
+      const Instr &instr = f_.instrs[id];
+      if ((instr.op != Op::BINARY && instr.op != Op::NEG && instr.op != Op::NOT) || f_.may_trap(id, true))
+        continue;
+      bool invariant = true;
+      bool literal = true;
+      for (int operand : instr.operands) {
+        bool constant = f_.instrs[operand].op == Op::CONST;
+        invariant &= constant || !inside.count(f_.instrs[operand].block);
+        literal &= constant;
+      }
+      // operation on literals is left to folding
+      if (!invariant || literal)
+        continue;
+      // literals go first, preheader dominates their other users in loop
+      for (int operand : f_.instrs[id].operands)
+        if (inside.count(f_.instrs[operand].block))
+          f_.move(operand, preheader);
+      f_.move(id, preheader);
+      ++hoisted_;
+    }
+  }
+}
+
+bool LoopInvariantMotion::unswitch(std::vector<Region> &seq, size_t index) {
+  std::set<int> inside = loop_blocks(seq[index]);
+  size_t size = 0;
+  for (int b : inside)
+    size += f_.blocks[b].instrs.size();
+  if (size > unswitch_limit)
+    return false;
+  int ifblock = -1;
+  for (auto &region : seq[index].arms[0]) {
+    if (region.kind != Region::Kind::If)
+      continue;
+    const Instr &cond = f_.instrs[f_.terminator(region.block).operands[0]];
+    if (cond.op != Op::CONST && !inside.count(cond.block)) {
+      ifblock = region.block;
+      break;
+    }
+  }
+  if (ifblock < 0)
+    return false;
+  Region loop = std::move(seq[index]);
+  int header = loop.block;
+  int exit = loop.merge;
+  int preheader = f_.blocks[header].preds[0];
+  int cond = f_.terminator(ifblock).operands[0];
+
+  // copy of loop, operands defined in loop are renamed
+  int first = f_.blocks.size();
+  std::unordered_map<int, int> blockmap;
+  std::unordered_map<int, int> valuemap;
+  for (int b : inside)
+    blockmap[b] = newblock();
+  auto mapblock = [&blockmap](int b) { return blockmap.count(b) ? blockmap.at(b) : b; };
+  for (int b : inside) {
+    BasicBlock &copy = f_.blocks[blockmap[b]];
+    for (int id : f_.blocks[b].instrs) {
+      Instr instr = f_.instrs[id];
+      instr.block = blockmap[b];
+      valuemap[id] = f_.instrs.size();
+      copy.instrs.push_back(f_.instrs.size());
+      f_.instrs.push_back(std::move(instr));
+    }
+    for (int pred : f_.blocks[b].preds)
+      copy.preds.push_back(mapblock(pred));
+    for (int succ : f_.blocks[b].succs)
+      copy.succs.push_back(mapblock(succ));
+  }
+  for (auto &value : valuemap)
+    for (int &operand : f_.instrs[value.second].operands)
+      if (valuemap.count(operand))
+        operand = valuemap[operand];
+
+  // preheader branches on invariant condition to one of the loops, both exit to old exit block
+  int thenblk = newblock();
+  int elseblk = newblock();
+  int thenexit = newblock();
+  int elseexit = newblock();
+  int copy = blockmap[header];
+  Instr &branch = f_.instrs[f_.blocks[preheader].instrs.back()];
+  branch.op = Op::CBR;
+  branch.operands = {cond};
+  Instr jump;
+  jump.op = Op::BR;
+  for (int b : {thenblk, elseblk, thenexit, elseexit})
+    f_.insert(b, jump);
+  f_.blocks[preheader].succs = {thenblk, elseblk};
+  f_.blocks[thenblk].preds = {preheader};
+  f_.blocks[thenblk].succs = {header};
+  f_.blocks[elseblk].preds = {preheader};
+  f_.blocks[elseblk].succs = {copy};
+  f_.blocks[header].preds[0] = thenblk;
+  f_.blocks[copy].preds[0] = elseblk;
+  std::replace(f_.blocks[header].succs.begin(), f_.blocks[header].succs.end(), exit, thenexit);
+  std::replace(f_.blocks[copy].succs.begin(), f_.blocks[copy].succs.end(), exit, elseexit);
+  f_.blocks[thenexit].preds = {header};
+  f_.blocks[thenexit].succs = {exit};
+  f_.blocks[elseexit].preds = {copy};
+  f_.blocks[elseexit].succs = {exit};
+  f_.blocks[exit].preds = {thenexit, elseexit};
+
+  // values of header which are used after loop are merged by phis in exit block
+  f_.compute_uses();
+  std::vector<int> phis;
+  for (int id : f_.blocks[header].instrs) {
+    std::vector<int> outside;
+    for (int user : f_.users[id]) {
+      int block = f_.instrs[user].block;
+      if (block >= 0 && block < first && !inside.count(block))
+        outside.push_back(user);
+    }
+    if (outside.empty())
+      continue;
+    Instr phi;
+    phi.op = Op::PHI;
+    phi.operands = {id, valuemap[id]};
+    phi.block = exit;
+    phi.slot = f_.instrs[id].slot;
+    int merged = f_.instrs.size();
+    f_.instrs.push_back(std::move(phi));
+    phis.push_back(merged);
+    for (int user : outside)
+      std::replace(f_.instrs[user].operands.begin(), f_.instrs[user].operands.end(), id, merged);
+  }
+  std::vector<int> &exitinstrs = f_.blocks[exit].instrs;
+  exitinstrs.insert(exitinstrs.begin(), phis.begin(), phis.end());
+
+  // inner if keeps then arm in the first loop and else arm in the copy
+  Instr constant;
+  constant.op = Op::CONST;
+  constant.imm = 1;
+  int one = f_.insert(0, constant);
+  constant.imm = 0;
+  int zero = f_.insert(0, constant);
+  f_.instrs[f_.blocks[ifblock].instrs.back()].operands[0] = one;
+  f_.instrs[f_.blocks[blockmap[ifblock]].instrs.back()].operands[0] = zero;
+
+  Region clone = clone_region(loop, blockmap);
+  clone.merge = elseexit;
+  loop.merge = thenexit;
+  Region split{Region::Kind::If, preheader, exit, std::vector<std::vector<Region>>(2)};
+  split.arms[0].push_back(Region{Region::Kind::Code, thenblk});
+  split.arms[0].push_back(std::move(loop));
+  split.arms[0].push_back(Region{Region::Kind::Code, thenexit});
+  split.arms[1].push_back(Region{Region::Kind::Code, elseblk});
+  split.arms[1].push_back(std::move(clone));
+  split.arms[1].push_back(Region{Region::Kind::Code, elseexit});
+  seq[index] = std::move(split);
+
+  f_.compute_dominators();
+  f_.compute_uses();
+  ++unswitched_;
+  return true;
+}
+
+//inner loops are handled first, so invariants move out through several loops
+void LoopInvariantMotion::optimize(std::vector<Region> &seq) {
+  for (size_t i = 0; i < seq.size(); ++i) {
+    if (seq[i].kind == Region::Kind::Code)
+      continue;
+    for (auto &arm : seq[i].arms)
+      optimize(arm);
+    if (seq[i].kind == Region::Kind::While) {
+      hoist(seq[i]);
+      unswitch(seq, i);
+    }
+  }
+}
+
+void LoopInvariantMotion::run() {
+  f_.compute_uses();
+  optimize(f_.body);
+}
+
+int LoopInvariantMotion::gethoisted() const { return hoisted_; }
+
+int LoopInvariantMotion::getunswitched() const { return unswitched_; }
+
+}
+
+}
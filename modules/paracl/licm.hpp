@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <vector>
+
+namespace ptree {
+
+namespace ssa {
+
+//loop invariant code motion and unswitching of while loops: pure operations with operands
+//defined out of loop are moved to the block before loop header (they get new stack slots
+//when tree is rebuilt), then loop with if on invariant condition is copied into both
+//arms of that if and each copy keeps one arm of the inner if
+class LoopInvariantMotion {
+  Function &f_;
+  int hoisted_ = 0;
+  int unswitched_ = 0;
+
+  int newblock();
+  void hoist(const Region &loop);
+  bool unswitch(std::vector<Region> &seq, size_t index);
+  void optimize(std::vector<Region> &seq);
+
+  public:
+  //loops with more instructions are not unswitched
+  static const size_t unswitch_limit = 256;
+
+  LoopInvariantMotion(Function &function);
+  void run();
+  //count of moved instructions
+  int gethoisted() const;
+  //count of unswitched loops
+  int getunswitched() const;
+};
+
+}
+
+}
@@ -0,0 +1,420 @@
+#include "llvm_jit.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#ifdef PCL_HAVE_LLVM
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Mem2Reg.h>
+#endif
+
+namespace ptree {
+
+struct LlvmCode::Impl {
+#ifdef PCL_HAVE_LLVM
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+#endif
+  void (*entry)(char *) = nullptr;
+};
+
+LlvmCode::LlvmCode(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+LlvmCode::~LlvmCode() = default;
+
+void LlvmCode::run(Stack *stack) const { impl_->entry(stack->getmemory()); }
+
+LlvmCompiler::LlvmCompiler(int optlevel) : optlevel_(optlevel < 0 ? 0 : optlevel > 3 ? 3 : optlevel) {}
+
+std::string LlvmCompiler::getir() const { return ir_; }
+
+std::string LlvmCompiler::geterror() const { return error_; }
+
+#ifdef PCL_HAVE_LLVM
+
+//runtime helpers called from native code
+static void llvm_print(int value) { std::cout << value << std::endl; }
+
+static int llvm_input() { return readint(); }
+
+//called instead of division by zero or INT_MIN / -1, which are undefined in IR
+[[noreturn]] static void llvm_divtrap() {
+  std::raise(SIGFPE);
+  std::abort();
+}
+
+namespace {
+
+//builds pcl_main(i8 *memory) function: every used stack slot gets alloca which is loaded
+//from memory in entry block and stored back before return, so mem2reg can promote it
+class Lowering {
+  llvm::LLVMContext &context_;
+  llvm::Function *function_;
+  llvm::IRBuilder<> builder_;
+  llvm::BasicBlock *entry_ = nullptr;
+  llvm::Value *memory_;
+  std::map<int, llvm::AllocaInst *> slots_;
+  llvm::FunctionCallee print_;
+  llvm::FunctionCallee input_;
+  llvm::FunctionCallee divtrap_;
+
+  llvm::Type *i32() { return builder_.getInt32Ty(); }
+
+  llvm::Value *address(llvm::IRBuilder<> &builder, int offset) {
+    llvm::Value *byte = builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), memory_, offset);
+    return builder.CreateBitCast(byte, i32()->getPointerTo());
+  }
+
+  llvm::AllocaInst *slot(const NameInt *var) {
+    if (var->getoffset() < 0)
+      throw std::logic_error{"usage of undeclared variable " + var->getvarname()};
+    auto it = slots_.find(var->getoffset());
+    if (it != slots_.end())
+      return it->second;
+    llvm::IRBuilder<> init(entry_->getTerminator());
+    llvm::AllocaInst *alloca = init.CreateAlloca(i32(), nullptr, var->getvarname());
+    init.CreateStore(init.CreateAlignedLoad(i32(), address(init, var->getoffset()), llvm::MaybeAlign(1)), alloca);
+    slots_[var->getoffset()] = alloca;
+    return alloca;
+  }
+
+  llvm::Value *truth(llvm::Value *value) { return builder_.CreateICmpNE(value, builder_.getInt32(0)); }
+
+  llvm::Value *widen(llvm::Value *flag) { return builder_.CreateZExt(flag, i32()); }
+
+  // division traps like idiv of the other engines, result is computed only for valid operands
+  void guard_division(llvm::Value *lhs, llvm::Value *rhs) {
+    llvm::Value *zero = builder_.CreateICmpEQ(rhs, builder_.getInt32(0));
+    llvm::Value *overflow = builder_.CreateAnd(builder_.CreateICmpEQ(lhs, builder_.getInt32(std::numeric_limits<int>::min())),
+                                               builder_.CreateICmpEQ(rhs, builder_.getInt32(-1)));
+    auto trap = llvm::BasicBlock::Create(context_, "div.trap", function_);
+    auto valid = llvm::BasicBlock::Create(context_, "div.valid", function_);
+    builder_.CreateCondBr(builder_.CreateOr(zero, overflow), trap, valid);
+    builder_.SetInsertPoint(trap);
+    builder_.CreateCall(divtrap_);
+    builder_.CreateUnreachable();
+    builder_.SetInsertPoint(valid);
+  }
+
+  llvm::Value *lower_binop(const BinOp *binop) {
+    // operands are evaluated from left to right as in tree interpreter
+    llvm::Value *lhs = lower_expr(binop->getleft());
+    llvm::Value *rhs = lower_expr(binop->getright());
+    switch (binop->operation_) {
+    case BinOpType::ADDITION:
+      return builder_.CreateAdd(lhs, rhs);
+    case BinOpType::SUBTRACTION:
+      return builder_.CreateSub(lhs, rhs);
+    case BinOpType::MULTIPLICATION:
+      return builder_.CreateMul(lhs, rhs);
+    // division proven safe by range analysis needs no trap check
+    case BinOpType::DIVISION:
+      if (!binop->safe_)
+        guard_division(lhs, rhs);
+      return builder_.CreateSDiv(lhs, rhs);
+    case BinOpType::REMAINDER:
+      if (!binop->safe_)
+        guard_division(lhs, rhs);
+      return builder_.CreateSRem(lhs, rhs);
+    case BinOpType::EQUAL:
+      return widen(builder_.CreateICmpEQ(lhs, rhs));
+    case BinOpType::MORE_EQUAL:
+      return widen(builder_.CreateICmpSGE(lhs, rhs));
+    case BinOpType::LESS_EQUAL:
+      return widen(builder_.CreateICmpSLE(lhs, rhs));
+    case BinOpType::NON_EQUAL:
+      return widen(builder_.CreateICmpNE(lhs, rhs));
+    case BinOpType::MORE:
+      return widen(builder_.CreateICmpSGT(lhs, rhs));
+    case BinOpType::LESS:
+      return widen(builder_.CreateICmpSLT(lhs, rhs));
+    // both operands are always evaluated
+    case BinOpType::LOG_AND:
+      return widen(builder_.CreateAnd(truth(lhs), truth(rhs)));
+    case BinOpType::LOG_OR:
+      return widen(builder_.CreateOr(truth(lhs), truth(rhs)));
+    case BinOpType::SHIFT_LEFT:
+      return builder_.CreateShl(lhs, rhs);
+    case BinOpType::SHIFT_RIGHT:
+      return builder_.CreateAShr(lhs, rhs);
+    case BinOpType::BIT_AND:
+      return builder_.CreateAnd(lhs, rhs);
+    case BinOpType::MUL_HIGH: {
+      llvm::Type *i64 = builder_.getInt64Ty();
+      llvm::Value *product = builder_.CreateMul(builder_.CreateSExt(lhs, i64), builder_.CreateSExt(rhs, i64));
+      return builder_.CreateTrunc(builder_.CreateAShr(product, 32), i32());
+    }
+    default:
+      throw std::logic_error{"undefined binary operation in LLVM backend"};
+    }
+  }
+
+  llvm::Value *lower_expr(const PTree *unit) {
+    if (unit == nullptr)
+      throw std::logic_error{"missing operand in LLVM backend"};
+    if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit))
+      return builder_.getInt32(imidiate->getvalue());
+    if (auto nameint = dynamic_cast<const NameInt *>(unit))
+      return builder_.CreateLoad(i32(), slot(nameint));
+    if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+      if (reserved->gettype() != Reserved::Types::Input)
+        throw std::logic_error{"reserved word has no value"};
+      return builder_.CreateCall(input_);
+    }
+    if (auto binop = dynamic_cast<const BinOp *>(unit))
+      return lower_binop(binop);
+    if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+      switch (unop->operation_) {
+      case UnOpType::POST_ADDITION:
+      case UnOpType::POST_SUBTRACTION: {
+        auto nameint = dynamic_cast<const NameInt *>(unop->getleft());
+        if (nameint == nullptr)
+          throw std::logic_error{"increment of not a variable"};
+        llvm::AllocaInst *var = slot(nameint);
+        int step = unop->operation_ == UnOpType::POST_ADDITION ? 1 : -1;
+        llvm::Value *value = builder_.CreateAdd(builder_.CreateLoad(i32(), var), builder_.getInt32(step));
+        builder_.CreateStore(value, var);
+        return value;
+      }
+      case UnOpType::MINUS:
+        return builder_.CreateSub(builder_.getInt32(0), lower_expr(unop->getleft()));
+      case UnOpType::NOT:
+        return widen(builder_.CreateICmpEQ(lower_expr(unop->getleft()), builder_.getInt32(0)));
+      default:
+        throw std::logic_error{"undefined unary operation in LLVM backend"};
+      }
+    }
+    if (auto assign = dynamic_cast<const Assign *>(unit)) {
+      llvm::Value *value = lower_expr(assign->getright());
+      builder_.CreateStore(value, slot(assign->lval));
+      return value;
+    }
+    if (auto output = dynamic_cast<const Output *>(unit)) {
+      llvm::Value *value = lower_expr(output->getright());
+      builder_.CreateCall(print_, {value});
+      return value;
+    }
+    if (auto condition = dynamic_cast<const Condition *>(unit))
+      return lower_expr(condition->getleft());
+    if (auto expression = dynamic_cast<const Expression *>(unit))
+      return lower_expr(expression->getright());
+    throw std::logic_error{"node can not be lowered to LLVM IR"};
+  }
+
+  void lower_stmt(const PTree *unit) {
+    if (unit == nullptr)
+      return;
+    if (auto block = dynamic_cast<const Block *>(unit)) {
+      for (auto expr : block->operations)
+        lower_stmt(expr);
+      return;
+    }
+    if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+      if (ifblock->condition_ == nullptr)
+        throw std::logic_error{"missing condition in if block"};
+      llvm::Value *condition = truth(lower_expr(ifblock->condition_));
+      auto on_true = llvm::BasicBlock::Create(context_, "if.true", function_);
+      auto on_false = llvm::BasicBlock::Create(context_, "if.false", function_);
+      auto end = llvm::BasicBlock::Create(context_, "if.end", function_);
+      builder_.CreateCondBr(condition, on_true, on_false);
+      builder_.SetInsertPoint(on_true);
+      lower_stmt(ifblock->getright());
+      builder_.CreateBr(end);
+      builder_.SetInsertPoint(on_false);
+      lower_stmt(ifblock->getleft());
+      builder_.CreateBr(end);
+      builder_.SetInsertPoint(end);
+      return;
+    }
+    if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+      if (whileblock->condition_ == nullptr)
+        throw std::logic_error{"missing condition in while cycle"};
+      auto header = llvm::BasicBlock::Create(context_, "while.cond", function_);
+      auto body = llvm::BasicBlock::Create(context_, "while.body", function_);
+      auto end = llvm::BasicBlock::Create(context_, "while.end", function_);
+      builder_.CreateBr(header);
+      builder_.SetInsertPoint(header);
+      builder_.CreateCondBr(truth(lower_expr(whileblock->condition_)), body, end);
+      builder_.SetInsertPoint(body);
+      lower_stmt(whileblock->getleft());
+      builder_.CreateBr(header);
+      builder_.SetInsertPoint(end);
+      return;
+    }
+    if (auto expression = dynamic_cast<const Expression *>(unit)) {
+      lower_stmt(expression->getright());
+      return;
+    }
+    lower_expr(unit);
+  }
+
+public:
+  Lowering(llvm::LLVMContext &context, llvm::Module &module) : context_(context), builder_(context) {
+    auto type = llvm::FunctionType::get(builder_.getVoidTy(), {builder_.getInt8PtrTy()}, false);
+    function_ = llvm::Function::Create(type, llvm::Function::ExternalLinkage, "pcl_main", module);
+    memory_ = function_->getArg(0);
+    print_ = module.getOrInsertFunction("pcl_print", builder_.getVoidTy(), i32());
+    input_ = module.getOrInsertFunction("pcl_input", i32());
+    divtrap_ = module.getOrInsertFunction("pcl_divtrap", builder_.getVoidTy());
+    llvm::cast<llvm::Function>(divtrap_.getCallee())->setDoesNotReturn();
+  }
+
+  void lower(const PTree *root) {
+    entry_ = llvm::BasicBlock::Create(context_, "entry", function_);
+    auto body = llvm::BasicBlock::Create(context_, "body", function_);
+    builder_.SetInsertPoint(entry_);
+    builder_.CreateBr(body);
+    builder_.SetInsertPoint(body);
+    lower_stmt(root);
+    for (auto &it : slots_)
+      builder_.CreateAlignedStore(builder_.CreateLoad(i32(), it.second), address(builder_, it.first),
+                                  llvm::MaybeAlign(1));
+    builder_.CreateRetVoid();
+  }
+};
+
+llvm::OptimizationLevel pass_level(int optlevel) {
+  switch (optlevel) {
+  case 1:
+    return llvm::OptimizationLevel::O1;
+  case 2:
+    return llvm::OptimizationLevel::O2;
+  default:
+    return llvm::OptimizationLevel::O3;
+  }
+}
+
+llvm::CodeGenOpt::Level codegen_level(int optlevel) {
+  switch (optlevel) {
+  case 0:
+    return llvm::CodeGenOpt::None;
+  case 1:
+    return llvm::CodeGenOpt::Less;
+  case 2:
+    return llvm::CodeGenOpt::Default;
+  default:
+    return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
+void optimize(llvm::Module &module, int optlevel) {
+  llvm::LoopAnalysisManager lam;
+  llvm::FunctionAnalysisManager fam;
+  llvm::CGSCCAnalysisManager cgam;
+  llvm::ModuleAnalysisManager mam;
+  llvm::PassBuilder builder;
+  builder.registerModuleAnalyses(mam);
+  builder.registerCGSCCAnalyses(cgam);
+  builder.registerFunctionAnalyses(fam);
+  builder.registerLoopAnalyses(lam);
+  builder.crossRegisterProxies(lam, fam, cgam, mam);
+  llvm::ModulePassManager passes;
+  if (optlevel == 0) {
+    // slots are promoted to SSA registers even without optimization
+    llvm::FunctionPassManager promote;
+    promote.addPass(llvm::PromotePass());
+    passes.addPass(llvm::createModuleToFunctionPassAdaptor(std::move(promote)));
+  } else {
+    passes = builder.buildPerModuleDefaultPipeline(pass_level(optlevel));
+  }
+  passes.run(module, mam);
+}
+
+} // namespace
+
+bool LlvmCompiler::available() { return true; }
+
+std::unique_ptr<LlvmCode> LlvmCompiler::compile(const PTree *root) {
+  static bool initialized = [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    return true;
+  }();
+  (void)initialized;
+  error_.clear();
+  ir_.clear();
+
+  auto machine = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!machine) {
+    error_ = llvm::toString(machine.takeError());
+    return std::unique_ptr<LlvmCode>{};
+  }
+  machine->setCodeGenOptLevel(codegen_level(optlevel_));
+  auto jit = llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(*machine)).create();
+  if (!jit) {
+    error_ = llvm::toString(jit.takeError());
+    return std::unique_ptr<LlvmCode>{};
+  }
+
+  auto context = std::make_unique<llvm::LLVMContext>();
+  auto module = std::make_unique<llvm::Module>("paracl", *context);
+  module->setDataLayout((*jit)->getDataLayout());
+  module->setTargetTriple((*jit)->getTargetTriple().str());
+  try {
+    Lowering lowering(*context, *module);
+    lowering.lower(root);
+  } catch (std::exception &e) {
+    error_ = e.what();
+    return std::unique_ptr<LlvmCode>{};
+  }
+  std::string verifier;
+  llvm::raw_string_ostream verifier_out(verifier);
+  if (llvm::verifyModule(*module, &verifier_out)) {
+    error_ = "invalid LLVM IR: " + verifier_out.str();
+    return std::unique_ptr<LlvmCode>{};
+  }
+  optimize(*module, optlevel_);
+  llvm::raw_string_ostream ir_out(ir_);
+  module->print(ir_out, nullptr);
+  ir_out.flush();
+
+  llvm::orc::SymbolMap helpers;
+  helpers[(*jit)->mangleAndIntern("pcl_print")] = llvm::JITEvaluatedSymbol(
+      llvm::pointerToJITTargetAddress(&llvm_print), llvm::JITSymbolFlags::Exported);
+  helpers[(*jit)->mangleAndIntern("pcl_input")] = llvm::JITEvaluatedSymbol(
+      llvm::pointerToJITTargetAddress(&llvm_input), llvm::JITSymbolFlags::Exported);
+  helpers[(*jit)->mangleAndIntern("pcl_divtrap")] = llvm::JITEvaluatedSymbol(
+      llvm::pointerToJITTargetAddress(&llvm_divtrap), llvm::JITSymbolFlags::Exported);
+  if (auto err = (*jit)->getMainJITDylib().define(llvm::orc::absoluteSymbols(helpers))) {
+    error_ = llvm::toString(std::move(err));
+    return std::unique_ptr<LlvmCode>{};
+  }
+  if (auto err = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+    error_ = llvm::toString(std::move(err));
+    return std::unique_ptr<LlvmCode>{};
+  }
+  auto entry = (*jit)->lookup("pcl_main");
+  if (!entry) {
+    error_ = llvm::toString(entry.takeError());
+    return std::unique_ptr<LlvmCode>{};
+  }
+
+  auto impl = std::make_unique<LlvmCode::Impl>();
+  impl->entry = reinterpret_cast<void (*)(char *)>(entry->getAddress());
+  impl->jit = std::move(*jit);
+  return std::make_unique<LlvmCode>(std::move(impl));
+}
+
+#else
+
+bool LlvmCompiler::available() { return false; }
+
+std::unique_ptr<LlvmCode> LlvmCompiler::compile(const PTree *) {
+  error_ = "pcli is built without LLVM";
+  return std::unique_ptr<LlvmCode>{};
+}
+
+#endif
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+#include <memory>
+
+//LLVM backend is built only when CMake finds LLVM (PCL_HAVE_LLVM is defined for llvm_jit.cpp),
+//otherwise LlvmCompiler always reports fail and program is executed by selected engine
+
+namespace ptree {
+
+//native code made by LlvmCompiler, owns ORC JIT instance
+class LlvmCode {
+public:
+  struct Impl;
+  LlvmCode(std::unique_ptr<Impl> impl);
+  ~LlvmCode();
+  LlvmCode(const LlvmCode &other) = delete;
+  LlvmCode &operator=(const LlvmCode &other) = delete;
+  //run code, variables are kept in stack memory on their offsets
+  void run(Stack *stack) const;
+private:
+  std::unique_ptr<Impl> impl_;
+};
+
+//lowers tree (after manage_tree_mem) to LLVM IR, variable slots are allocas
+//promoted to SSA registers, module is optimized and compiled with ORC LLJIT
+class LlvmCompiler {
+  int optlevel_;
+  std::string ir_;
+  std::string error_;
+public:
+  //optlevel is -O level from 0 to 3
+  LlvmCompiler(int optlevel = 2);
+  //return true if backend is built with LLVM
+  static bool available();
+  //compile tree to native code, return nullptr if it can not be compiled
+  std::unique_ptr<LlvmCode> compile(const PTree *root);
+  //return textual IR of the last compiled module (after optimization)
+  std::string getir() const;
+  //return reason of the last compilation fail
+  std::string geterror() const;
+};
+
+}
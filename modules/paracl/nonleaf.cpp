@@ -1,5 +1,7 @@
 #include "nonleaf.hpp"
 #include "leaf.hpp"
+#include "quicken.hpp"
+#include "fold.hpp"
 
 #include <stdexcept>
 #include <exception>
@@ -47,10 +49,15 @@ std::string Expression::dump() const {
 }
 
 std::unique_ptr<PTree> Expression::execute(Stack *stack) const {
+  eval(stack);
+  return std::unique_ptr<PTree>{};
+}
+
+int Expression::eval(Stack *stack) const {
 #ifdef DBG_CALL
   std::cout << "Expression execute" << std::endl;
 #endif
-  return getright()->execute(stack);
+  return getright()->eval(stack);
 }
 
 template <typename T> T operate(T lhs, T rhs, BinOpType operation) {
@@ -81,6 +88,14 @@ template <typename T> T operate(T lhs, T rhs, BinOpType operation) {
     return lhs && rhs;
   case BinOpType::LOG_OR:
     return lhs || rhs;
+  case BinOpType::SHIFT_LEFT:
+    return shift_left(lhs, rhs);
+  case BinOpType::SHIFT_RIGHT:
+    return lhs >> rhs;
+  case BinOpType::BIT_AND:
+    return lhs & rhs;
+  case BinOpType::MUL_HIGH:
+    return mul_high(lhs, rhs);
   default:
     assert(!"Fault");
     return 0;
@@ -115,6 +130,14 @@ std::string BinOp::get_op() const {
     return "&&";
   case BinOpType::LOG_OR:
     return "||";
+  case BinOpType::SHIFT_LEFT:
+    return "\\<\\<";
+  case BinOpType::SHIFT_RIGHT:
+    return "\\>\\>";
+  case BinOpType::BIT_AND:
+    return "&";
+  case BinOpType::MUL_HIGH:
+    return "mulhi";
   default:
     return "?";
   }
@@ -131,22 +154,47 @@ std::string BinOp::dump() const {
 }
 
 std::unique_ptr<PTree> BinOp::execute(Stack *stack) const {
+  return std::unique_ptr<PTree>{new Imidiate<int>(eval(stack))};
+}
+
+int BinOp::eval(Stack *stack) const {
 #ifdef DBG_CALL
   std::cout << "BinOp execute" << std::endl;
 #endif
-  auto left_op = getleft()->execute(stack);
-  auto right_op = getright()->execute(stack);
+  if (quick_ != nullptr)
+    return quick_->eval(stack);
+  if (!quickened_) {
+    quickened_ = true;
+    quick_ = quicken(*this, quickbuf_, sizeof(quickbuf_));
+    if (quick_ != nullptr)
+      return quick_->eval(stack);
+  }
+  int lhs = getleft()->eval(stack);
+  int rhs = getright()->eval(stack);
+  return operate<int>(lhs, rhs, operation_);
+}
 
-  Imidiate<int> *l_exec = dynamic_cast<Imidiate<int> *>(left_op.get());
-  Imidiate<int> *r_exec = dynamic_cast<Imidiate<int> *>(right_op.get());
+bool BinOp::test(Stack *stack) const {
+  if (operation_ != BinOpType::LOG_AND && operation_ != BinOpType::LOG_OR)
+    return BinOp::eval(stack) != 0;
+  if (shortcut_ < 0)
+    shortcut_ = is_pure(getright());
+  bool lhs = getleft()->test(stack);
+  bool decided = lhs == (operation_ == BinOpType::LOG_OR);
+  if (shortcut_ && decided)
+    return lhs;
+  bool rhs = getright()->test(stack);
+  return decided ? lhs : rhs;
+}
 
-  // TODO: add operations implementation
-  assert((l_exec != nullptr) && (r_exec != nullptr));
-  int result = operate<int>(l_exec->getvalue(stack), r_exec->getvalue(stack),
-                            operation_);
-  return std::unique_ptr<PTree>{new Imidiate<int>(result)};
+void BinOp::dequicken() {
+  quick_ = nullptr;
+  quickened_ = false;
+  shortcut_ = -1;
 }
 
+bool BinOp::isquickened() const { return quick_ != nullptr; }
+
 std::string UnOp::get_op() const {
   switch (operation_) {
   case UnOpType::POST_ADDITION:
@@ -163,39 +211,39 @@ std::string UnOp::get_op() const {
 }
 
 std::unique_ptr<PTree> UnOp::execute(Stack *stack) const {
+  return std::unique_ptr<PTree>{new Imidiate<int>(eval(stack))};
+}
+
+int UnOp::eval(Stack *stack) const {
 #ifdef DBG_CALL
   std::cout << "UnOp execute" << std::endl;
 #endif
-
-  NameInt *var = dynamic_cast<NameInt *>(getleft());
-  assert(var != nullptr);
-  // here execute method not used because of speed, to not provide more imidiate
   switch (operation_) {
-  case UnOpType::POST_ADDITION: {
-    int value = var->getvalue(stack);
-    var->setvalue(++value, stack);
-    return std::unique_ptr<PTree>{new Imidiate<int>(value)};
-  }
+  case UnOpType::POST_ADDITION:
   case UnOpType::POST_SUBTRACTION: {
+    NameInt *var = dynamic_cast<NameInt *>(getleft());
+    assert(var != nullptr);
     int value = var->getvalue(stack);
-    var->setvalue(--value, stack);
-    return std::unique_ptr<PTree>{new Imidiate<int>(value)};
-  }
-  case UnOpType::MINUS: {
-    int value = var->getvalue(stack);
-    return std::unique_ptr<PTree>{new Imidiate<int>(-value)};
-  }
-  case UnOpType::NOT: {
-    int value = var->getvalue(stack);
-    return std::unique_ptr<PTree>{new Imidiate<int>(!value)};
+    value += operation_ == UnOpType::POST_ADDITION ? 1 : -1;
+    var->setvalue(value, stack);
+    return value;
   }
-  default: {
+  case UnOpType::MINUS:
+    return -getleft()->eval(stack);
+  case UnOpType::NOT:
+    return !getleft()->eval(stack);
+  default:
     assert(!"Fault");
-    return std::unique_ptr<PTree>{};
-  }
+    return 0;
   }
 }
 
+bool UnOp::test(Stack *stack) const {
+  if (operation_ == UnOpType::NOT)
+    return !getleft()->test(stack);
+  return eval(stack) != 0;
+}
+
 std::string UnOp::dump() const {
   std::string res;
   res += get_chld_dump();
@@ -272,14 +320,16 @@ std::string Assign::dump() const {
 }
 
 std::unique_ptr<PTree> Assign::execute(Stack *stack) const {
+  return std::unique_ptr<PTree>{new Imidiate<int>(eval(stack))};
+}
+
+int Assign::eval(Stack *stack) const {
 #ifdef DBG_CALL
   std::cout << "Assign execute" << std::endl;
 #endif
-  std::unique_ptr<PTree> executed = getright()->execute(stack);
-  const Imidiate<int> *to_assign =
-      dynamic_cast<Imidiate<int> *>(executed.get());
-  lval->setvalue(to_assign->getvalue(), stack);
-  return executed;
+  int value = getright()->eval(stack);
+  lval->setvalue(value, stack);
+  return value;
 }
 
 std::string Condition::dump() const {
@@ -296,19 +346,22 @@ std::string Condition::dump() const {
 }
 
 std::unique_ptr<PTree> Condition::execute(Stack *stack) const {
+  return std::unique_ptr<PTree>{new Imidiate<int>(eval(stack))};
+}
+
+int Condition::eval(Stack *stack) const {
 #ifdef DBG_CALL
   std::cout << "Condition execute" << std::endl;
 #endif
-  return getleft()->execute(stack);
+  return getleft()->eval(stack);
 }
 
-bool Condition::is_true(Stack *stack) const {
-  std::unique_ptr<PTree> executed = execute(stack);
-  // I`m so sorry for using dynamic cast here, maybe should use typeid + static_cast
-  Imidiate<int> *result = dynamic_cast<Imidiate<int> *>(executed.get());
-  assert(result != nullptr);
+bool Condition::test(Stack *stack) const {
+  return getleft()->test(stack);
+}
 
-  return result->getvalue();
+bool Condition::is_true(Stack *stack) const {
+  return getleft()->test(stack);
 }
 
 std::string IfBlk::dump() const {
@@ -397,14 +450,15 @@ std::string Output::dump() const {
 }
 
 std::unique_ptr<PTree> Output::execute(Stack *stack) const {
+  return std::unique_ptr<PTree>{new Imidiate<int>(eval(stack))};
+}
+
+int Output::eval(Stack *stack) const {
 #ifdef DBG_CALL
   std::cout << "Print execute" << std::endl;
 #endif
-  std::unique_ptr<PTree> executed = getright()->execute(stack);
-  // I`m so sorry for using dynamic cast here, maybe should use typeid + static_cast
-  Imidiate<int> *value = dynamic_cast<Imidiate<int> *>(executed.get());
-  assert(value != nullptr);
-  std::cout << value->getvalue() << std::endl;
-  return executed;
+  int value = getright()->eval(stack);
+  std::cout << value << std::endl;
+  return value;
 }
 } // namespace ptree
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <memory>
 #include <iostream>
 #include <cassert>
 
@@ -55,7 +56,10 @@ class Expression : public NonLeaf {
   
   std::string dump() const override ;
 
+  //evaluates expression and drops its value
   std::unique_ptr<PTree> execute(Stack *stack) const override ;
+
+  int eval(Stack *stack) const override ;
 };
 
 class Operation : public NonLeaf {
@@ -79,21 +83,59 @@ enum class BinOpType {
   UNDEF,
   LOG_AND,
   LOG_OR,
+  //operations without syntax, strength reduction produces them
+  SHIFT_LEFT,
+  SHIFT_RIGHT, //arithmetic shift
+  BIT_AND,
+  MUL_HIGH,    //high 32 bits of 64 bit product
 };
 //TODO: Split for log binop and simple binop
 template <typename T>
 T operate(T lhs, T rhs, BinOpType operation) ;
+//shift which wraps around as multiplication by power of two
+inline int shift_left(int lhs, int rhs) { return static_cast<int>(static_cast<unsigned>(lhs) << rhs); }
+//high half of product, division by constant becomes multiplication by magic number
+inline int mul_high(int lhs, int rhs) { return static_cast<int>(static_cast<long long>(lhs) * rhs >> 32); }
+
+//specialised evaluator of BinOp with known operator and operand kinds, see quicken.hpp
+//HACK: destructor is not virtual, derived classes should be trivially destructible to live in BinOp buffer
+class QuickBinOp {
+  public:
+  virtual int eval(Stack *stack) const = 0;
+  protected:
+  ~QuickBinOp() = default;
+};
 
 class BinOp: public Operation {
+  //BinOp rewrites itself to specialised node after the first evaluation
+  mutable const QuickBinOp *quick_ = nullptr;
+  mutable bool quickened_ = false;
+  //1 if right operand of && or || is pure and can be skipped in test, -1 if not checked yet
+  mutable signed char shortcut_ = -1;
+  alignas(void*) mutable unsigned char quickbuf_[2 * sizeof(void*)];
   public:
   BinOpType operation_;
+  //division which can not trap at its place, see range.hpp
+  bool safe_ = false;
   BinOp(BinOpType operation = BinOpType::UNDEF, PTree* parent = nullptr, PTree* l_operand = nullptr, PTree* r_operand = nullptr): 
         Operation(parent, l_operand, r_operand), operation_(operation) {};
+  //quick_ points into own quickbuf_, copy would use buffer of the source node
+  BinOp(const BinOp &other) = delete;
+  BinOp &operator=(const BinOp &other) = delete;
   
   std::string get_op() const ;
   std::string dump() const override ;
 
   std::unique_ptr<PTree> execute(Stack *stack) const override ; 
+
+  int eval(Stack *stack) const override ;
+
+  bool test(Stack *stack) const override ;
+
+  //drop specialised node, should be called if operands were changed after execution
+  void dequicken();
+  //true if node is evaluated by specialised node
+  bool isquickened() const;
 };
 
 enum class UnOpType {
@@ -117,6 +159,10 @@ class UnOp: public Operation {
   std::string get_op() const ;
 
   std::unique_ptr<PTree> execute(Stack* stack) const override;
+
+  int eval(Stack* stack) const override;
+
+  bool test(Stack* stack) const override;
   
   std::string dump() const override; 
 };
@@ -169,6 +215,8 @@ class Assign : public Operation {
 
 
   std::unique_ptr<PTree> execute(Stack* stack) const override;
+
+  int eval(Stack* stack) const override;
 };
 
 class Condition: public NonLeaf {
@@ -179,6 +227,10 @@ class Condition: public NonLeaf {
 
   std::unique_ptr<PTree> execute(Stack* stack) const override;
 
+  int eval(Stack* stack) const override;
+
+  bool test(Stack* stack) const override;
+
   bool is_true(Stack* stack) const;
 };
 
@@ -224,6 +276,8 @@ class Output: public Operation {
   std::string dump() const override;
 
   std::unique_ptr<PTree> execute(Stack* stack) const override;
+
+  int eval(Stack* stack) const override;
 };
 
 
@@ -0,0 +1,250 @@
+#include "passes.hpp"
+#include "ssa.hpp"
+#include "fold.hpp"
+#include "sccp.hpp"
+#include "dce.hpp"
+#include "licm.hpp"
+#include "strength.hpp"
+#include "scev.hpp"
+#include "gvn.hpp"
+#include "ifconv.hpp"
+#include "range.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <sstream>
+#include <iomanip>
+#include <set>
+
+namespace ptree {
+
+using namespace std::chrono;
+
+static PTree *ssa_pass(PTree *root, int &stacksize, std::string &) {
+  return ssa::rebuild_tree(ssa::compile_tree(root), stacksize);
+}
+
+static PTree *fold_pass(PTree *root, int &, std::string &note) {
+  Folder folder;
+  PTree *res = folder.rewrite(root);
+  note = std::to_string(folder.getapplied().size()) + " rules applied";
+  return res;
+}
+
+static PTree *sccp_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::ConstantPropagation propagation(function);
+  propagation.run();
+  note = std::to_string(propagation.getconstants()) + " constants, " + std::to_string(propagation.getbranches()) +
+         " branches folded";
+  return ssa::rebuild_tree(function, stacksize);
+}
+
+static PTree *dce_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::DeadCodeElimination elimination(function);
+  elimination.run();
+  int before = stacksize;
+  PTree *res = ssa::rebuild_tree(function, stacksize);
+  note = std::to_string(elimination.getremoved()) + " dead values, " + std::to_string(elimination.getunreachable()) +
+         " unreachable blocks, stack " + std::to_string(before) + " -> " + std::to_string(stacksize) + " bytes";
+  return res;
+}
+
+static PTree *licm_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::LoopInvariantMotion motion(function);
+  motion.run();
+  note = std::to_string(motion.gethoisted()) + " hoisted, " + std::to_string(motion.getunswitched()) +
+         " loops unswitched";
+  return ssa::rebuild_tree(function, stacksize);
+}
+
+static PTree *gvn_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::ValueNumbering numbering(function);
+  numbering.run();
+  note = std::to_string(numbering.getremoved()) + " redundant operations removed";
+  return ssa::rebuild_tree(function, stacksize);
+}
+
+static PTree *ifconv_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::IfConversion conversion(function);
+  conversion.run();
+  note = std::to_string(conversion.getconverted()) + " ifs converted, " + std::to_string(conversion.getselects()) +
+         " selects";
+  return ssa::rebuild_tree(function, stacksize);
+}
+
+static PTree *scev_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::ScalarEvolution evolution(function);
+  evolution.run();
+  note = std::to_string(evolution.getcollapsed().size()) + " of " + std::to_string(evolution.getloops()) +
+         " loops collapsed";
+  for (size_t i = 0; i < evolution.getcollapsed().size(); ++i)
+    note += (i == 0 ? ": (" : ", (") + evolution.getcollapsed()[i] + ")";
+  return ssa::rebuild_tree(function, stacksize);
+}
+
+static PTree *strength_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::StrengthReduction reduction(function);
+  reduction.run();
+  note = std::to_string(reduction.getrewritten()) + " operations, " + std::to_string(reduction.getinductions()) +
+         " loop multiplications reduced";
+  return ssa::rebuild_tree(function, stacksize);
+}
+
+static PTree *range_pass(PTree *root, int &stacksize, std::string &note) {
+  ssa::Function function = ssa::compile_tree(root);
+  ssa::RangeAnalysis analysis(function);
+  analysis.run();
+  note = std::to_string(analysis.getsafe()) + " of " + std::to_string(analysis.getdivisions()) +
+         " divisions can not trap, " + std::to_string(analysis.getnowrap()) + " of " +
+         std::to_string(analysis.getarithmetic()) + " operations can not wrap";
+  return ssa::rebuild_tree(function, stacksize);
+}
+
+const std::vector<PassInfo> &pass_table() {
+  static const std::vector<PassInfo> table = {
+      {"fold", "fold constant subtrees, algebraic identities and reassociation", fold_pass},
+      {"ssa", "translate to SSA form and back", ssa_pass},
+      {"sccp", "sparse conditional constant propagation, branches on constants are pruned", sccp_pass},
+      {"dce", "remove dead stores, unreachable code and unused variables", dce_pass},
+      {"licm", "move loop invariant expressions out of loops and unswitch loops", licm_pass},
+      {"gvn", "global value numbering, repeated expressions reuse earlier results", gvn_pass},
+      {"ifconv", "small ifs which only compute values become branchless selects", ifconv_pass},
+      {"scev", "replace loops without side effects by closed forms of their counters and sums", scev_pass},
+      {"strength", "multiplication, division and remainder by constants become shifts and masks", strength_pass},
+      {"range", "interval analysis, divisions which can not trap are marked safe for other passes", range_pass},
+  };
+  return table;
+}
+
+//passes of -O1 and -O2, -O0 runs nothing
+static const std::vector<std::vector<std::string>> levels = {
+    {},
+    {"fold"},
+    {"fold", "sccp", "range", "gvn", "licm", "scev", "dce"},
+};
+
+std::string pass_names() {
+  std::string res;
+  for (auto &pass : pass_table())
+    res += (res.empty() ? "" : ", ") + pass.name;
+  return res;
+}
+
+int count_nodes(const PTree *root) {
+  if (root == nullptr)
+    return 0;
+  if (auto block = dynamic_cast<const Block *>(root)) {
+    int count = 1;
+    for (auto expr : block->operations)
+      count += count_nodes(expr);
+    return count;
+  }
+  int count = 1 + count_nodes(root->getleft()) + count_nodes(root->getright());
+  if (auto branch = dynamic_cast<const Branch *>(root))
+    count += count_nodes(branch->condition_);
+  if (auto assign = dynamic_cast<const Assign *>(root))
+    count += count_nodes(assign->lval);
+  return count;
+}
+
+//nodes do not own their children, so tree is walked in the same way as in count_nodes
+static void collect_nodes(const PTree *root, std::set<const PTree *> &nodes) {
+  if (root == nullptr || !nodes.insert(root).second)
+    return;
+  if (auto block = dynamic_cast<const Block *>(root)) {
+    for (auto expr : block->operations)
+      collect_nodes(expr, nodes);
+    return;
+  }
+  collect_nodes(root->getleft(), nodes);
+  collect_nodes(root->getright(), nodes);
+  if (auto branch = dynamic_cast<const Branch *>(root))
+    collect_nodes(branch->condition_, nodes);
+  if (auto assign = dynamic_cast<const Assign *>(root))
+    collect_nodes(assign->lval, nodes);
+}
+
+void delete_tree(PTree *root, const PTree *keep) {
+  std::set<const PTree *> nodes, kept;
+  collect_nodes(root, nodes);
+  collect_nodes(keep, kept);
+  for (auto node : nodes)
+    if (kept.count(node) == 0)
+      delete node;
+}
+
+void PassManager::add(const std::string &name) {
+  for (auto &pass : pass_table())
+    if (pass.name == name) {
+      pipeline_.push_back(&pass);
+      return;
+    }
+  throw std::invalid_argument("unknown pass: " + name);
+}
+
+void PassManager::parse(const std::string &list) {
+  std::stringstream names(list);
+  std::string name;
+  while (std::getline(names, name, ','))
+    if (!name.empty())
+      add(name);
+}
+
+void PassManager::add_level(int level) {
+  if (level < 0 || level >= static_cast<int>(levels.size()))
+    throw std::invalid_argument("unknown optimization level: " + std::to_string(level));
+  for (auto &name : levels[level])
+    add(name);
+}
+
+PTree *PassManager::run(PTree *root, int &stacksize) {
+  for (auto pass : pipeline_) {
+    Timing timing{pass->name, 0, count_nodes(root), 0, "", ""};
+    auto start = steady_clock::now();
+    try {
+      PTree *res = pass->run(root, stacksize, timing.note);
+      // passes on SSA form build new tree, fold reuses nodes of the old one
+      if (res != root)
+        delete_tree(root, res);
+      root = res;
+    } catch (std::logic_error &e) {
+      timing.error = e.what();
+    }
+    timing.ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    timing.after = count_nodes(root);
+    timings_.push_back(timing);
+  }
+  return root;
+}
+
+const std::vector<PassManager::Timing> &PassManager::gettimings() const { return timings_; }
+
+static std::string format_ms(long ns) {
+  std::ostringstream res;
+  res << std::fixed << std::setprecision(3) << ns / 1e6;
+  return res.str();
+}
+
+void PassManager::report(std::ostream &out) const {
+  long total = 0;
+  for (auto &timing : timings_) {
+    total += timing.ns;
+    out << "Pass " << timing.name << ": " << format_ms(timing.ns) << " ms, nodes " << timing.before << " -> "
+        << timing.after;
+    if (!timing.error.empty())
+      out << ", skipped: " << timing.error;
+    else
+      out << " (removed " << timing.before - timing.after << ")" << (timing.note.empty() ? "" : ", ") << timing.note;
+    out << std::endl;
+  }
+  out << "Passes finished, elapsed time: " << format_ms(total) << " ms" << std::endl;
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+/*
+pass manager structure:
+1) PassFunction - transformation of tree (after manage_tree_mem), it returns new root or the same one,
+   enlarges stacksize when it uses new variable slots and may leave a short note for report
+2) pass_table - known passes by name, new pass is added to table in passes.cpp
+3) PassManager - pipeline from -O level preset or from list of names, it measures every pass
+*/
+
+namespace ptree {
+
+using PassFunction = PTree *(*)(PTree *root, int &stacksize, std::string &note);
+
+struct PassInfo {
+  std::string name;
+  std::string description;
+  PassFunction run;
+};
+
+//return table of known passes
+const std::vector<PassInfo> &pass_table();
+//return comma separated names of known passes
+std::string pass_names();
+//return count of nodes in tree
+int count_nodes(const PTree *root);
+//delete nodes of heap allocated tree, nodes which are also in keep tree stay alive
+void delete_tree(PTree *root, const PTree *keep = nullptr);
+
+class PassManager {
+  public:
+  struct Timing {
+    std::string name;
+    long ns;
+    int before;
+    int after;
+    //reason why pass was skipped, empty if pass was applied
+    std::string error;
+    //what pass has done, for example count of folded branches
+    std::string note;
+  };
+
+  private:
+  std::vector<const PassInfo *> pipeline_;
+  std::vector<Timing> timings_;
+
+  public:
+  //append pass by name, throws std::invalid_argument for unknown pass
+  void add(const std::string &name);
+  //append comma separated list of passes
+  void parse(const std::string &list);
+  //append preset pipeline of optimization level from 0 to 2
+  void add_level(int level);
+  //run pipeline on heap allocated tree, pass which can not handle the tree is skipped and tree is left
+  //as it was, tree replaced by a pass is deleted, so only the returned root stays valid
+  PTree *run(PTree *root, int &stacksize);
+  const std::vector<Timing> &gettimings() const;
+  //print wall time and node counts of every pass
+  void report(std::ostream &out) const;
+};
+
+}
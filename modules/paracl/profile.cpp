@@ -0,0 +1,458 @@
+#include "profile.hpp"
+#include "fold.hpp"
+#include "passes.hpp"
+#include "stack.hpp"
+
+#include <stdexcept>
+#include <sstream>
+#include <iostream>
+#include <csignal>
+#include <cstdlib>
+
+namespace ptree {
+
+static void number(const PTree *unit, std::map<const PTree *, int> &ids) {
+  if (unit == nullptr)
+    return;
+  ids.emplace(unit, ids.size());
+  if (auto block = dynamic_cast<const Block *>(unit))
+    for (auto expr : block->operations)
+      number(expr, ids);
+  if (auto branch = dynamic_cast<const Branch *>(unit))
+    number(branch->condition_, ids);
+  if (auto assign = dynamic_cast<const Assign *>(unit))
+    number(assign->lval, ids);
+  number(unit->getleft(), ids);
+  number(unit->getright(), ids);
+}
+
+std::map<const PTree *, int> number_nodes(const PTree *root) {
+  std::map<const PTree *, int> ids;
+  number(root, ids);
+  return ids;
+}
+
+void Profile::ValueCount::record(int value) {
+  ++total;
+  auto it = counts.find(value);
+  if (it != counts.end())
+    ++it->second;
+  else if (counts.size() < limit)
+    counts.emplace(value, 1);
+}
+
+void Profile::load(std::istream &in) {
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string kind;
+    int id;
+    if (!(fields >> kind >> id))
+      continue;
+    if (kind == "if") {
+      long taken = 0, not_taken = 0;
+      fields >> taken >> not_taken;
+      branches[id].taken += taken;
+      branches[id].not_taken += not_taken;
+    } else if (kind == "while") {
+      long entries = 0, iterations = 0;
+      fields >> entries >> iterations;
+      loops[id].entries += entries;
+      loops[id].iterations += iterations;
+    } else if (kind == "value") {
+      long total = 0, count;
+      int value;
+      fields >> total;
+      ValueCount &counts = values[id];
+      counts.total += total;
+      while (fields >> value >> count)
+        if (counts.counts.count(value) || counts.counts.size() < ValueCount::limit)
+          counts.counts[value] += count;
+    }
+  }
+}
+
+void Profile::save(std::ostream &out) const {
+  for (auto &it : branches)
+    out << "if " << it.first << " " << it.second.taken << " " << it.second.not_taken << std::endl;
+  for (auto &it : loops)
+    out << "while " << it.first << " " << it.second.entries << " " << it.second.iterations << std::endl;
+  for (auto &it : values) {
+    out << "value " << it.first << " " << it.second.total;
+    for (auto &count : it.second.counts)
+      out << " " << count.first << " " << count.second;
+    out << std::endl;
+  }
+}
+
+bool Profile::dominant(int id, int &value, double share) const {
+  auto it = values.find(id);
+  if (it == values.end() || it->second.total == 0)
+    return false;
+  long best = 0;
+  for (auto &count : it->second.counts)
+    if (count.second > best) {
+      best = count.second;
+      value = count.first;
+    }
+  return best >= share * it->second.total;
+}
+
+Profiler::Profiler(Profile &profile, const std::map<const PTree *, int> &ids)
+    : profile_(profile), ids_(ids) {}
+
+void Profiler::run(const PTree *root, Stack *stack) {
+  stack_ = stack;
+  eval(root);
+}
+
+int Profiler::eval(const PTree *unit) {
+  if (unit == nullptr)
+    throw std::logic_error{"Missing operand in profiler"};
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      eval(expr);
+    return 0;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    Profile::BranchCount &count = profile_.branches[ids_.at(unit)];
+    if (eval(ifblock->condition_)) {
+      ++count.taken;
+      if (ifblock->getright() != nullptr)
+        eval(ifblock->getright());
+    } else {
+      ++count.not_taken;
+      if (ifblock->getleft() != nullptr)
+        eval(ifblock->getleft());
+    }
+    return 0;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw std::logic_error{"No condition in while cycle"};
+    Profile::LoopCount &count = profile_.loops[ids_.at(unit)];
+    ++count.entries;
+    while (eval(whileblock->condition_)) {
+      ++count.iterations;
+      if (whileblock->getleft() != nullptr)
+        eval(whileblock->getleft());
+    }
+    return 0;
+  }
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit))
+    return imidiate->getvalue();
+  if (auto nameint = dynamic_cast<const NameInt *>(unit))
+    return nameint->getvalue(stack_);
+  if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw std::logic_error{"Reserved word has no value"};
+    return readint();
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    int lhs = eval(binop->getleft());
+    int rhs = eval(binop->getright());
+    // constant operands need no profile
+    if ((binop->operation_ == BinOpType::MULTIPLICATION || binop->operation_ == BinOpType::DIVISION ||
+         binop->operation_ == BinOpType::REMAINDER) &&
+        dynamic_cast<const Imidiate<int> *>(binop->getright()) == nullptr)
+      profile_.values[ids_.at(unit)].record(rhs);
+    int result;
+    // division by zero and INT_MIN / -1 raise SIGFPE like idiv of engines
+    if (!fold_binop(binop->operation_, lhs, rhs, result)) {
+      std::raise(SIGFPE);
+      std::abort();
+    }
+    return result;
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    switch (unop->operation_) {
+    // negation wraps around as in engines, -INT_MIN is INT_MIN
+    case UnOpType::MINUS:
+      return static_cast<int>(0u - static_cast<unsigned>(eval(unop->getleft())));
+    case UnOpType::NOT:
+      return !eval(unop->getleft());
+    default:
+      return unop->eval(stack_);
+    }
+  }
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    int value = eval(assign->getright());
+    assign->lval->setvalue(value, stack_);
+    return value;
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    int value = eval(output->getright());
+    std::cout << value << std::endl;
+    return value;
+  }
+  if (auto condition = dynamic_cast<const Condition *>(unit))
+    return eval(condition->getleft());
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    eval(expression->getright());
+    return 0;
+  }
+  throw std::logic_error{"Node can not be profiled"};
+}
+
+static PTree *clone_node(const PTree *unit, int offset, int value, std::map<const PTree *, int> *ids) {
+  auto copy = [offset, value, ids](const PTree *child) { return clone_tree(child, offset, value, ids); };
+  //written variables keep their names
+  auto target = [ids](const PTree *var) { return static_cast<NameInt *>(clone_tree(var, -1, 0, ids)); };
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit))
+    return new Imidiate<int>(imidiate->getvalue());
+  if (auto nameint = dynamic_cast<const NameInt *>(unit)) {
+    if (nameint->getoffset() == offset)
+      return new Imidiate<int>(value);
+    return new NameInt(nullptr, 0, nameint->getnameid(), nameint->getoffset(), nameint->getvarname());
+  }
+  if (auto reserved = dynamic_cast<const Reserved *>(unit))
+    return new Reserved(nullptr, reserved->gettype());
+  if (auto binop = dynamic_cast<const BinOp *>(unit))
+    return new BinOp(binop->operation_, nullptr, copy(binop->getleft()), copy(binop->getright()));
+  if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    if (unop->operation_ == UnOpType::POST_ADDITION || unop->operation_ == UnOpType::POST_SUBTRACTION)
+      return new UnOp(unop->operation_, nullptr, target(unop->getleft()));
+    return new UnOp(unop->operation_, nullptr, copy(unop->getleft()));
+  }
+  if (auto assign = dynamic_cast<const Assign *>(unit))
+    return new Assign(nullptr, target(assign->lval), copy(assign->getright()));
+  if (auto output = dynamic_cast<const Output *>(unit))
+    return new Output(nullptr, copy(output->getright()));
+  if (auto condition = dynamic_cast<const Condition *>(unit))
+    return new Condition(nullptr, copy(condition->getleft()));
+  if (auto expression = dynamic_cast<const Expression *>(unit))
+    return new Expression(nullptr, copy(expression->getright()));
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    Block *res = new Block(block->offset_, block->id_);
+    for (auto expr : block->operations)
+      res->push_expression(copy(expr));
+    return res;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit))
+    return new IfBlk(static_cast<Condition *>(copy(ifblock->condition_)), nullptr,
+                     copy(ifblock->getleft()), copy(ifblock->getright()));
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit))
+    return new WhileBlk(static_cast<Condition *>(copy(whileblock->condition_)), nullptr,
+                        copy(whileblock->getleft()));
+  throw std::logic_error{"Node can not be copied"};
+}
+
+PTree *clone_tree(const PTree *unit, int offset, int value, std::map<const PTree *, int> *ids) {
+  if (unit == nullptr)
+    return nullptr;
+  PTree *res = clone_node(unit, offset, value, ids);
+  if (ids != nullptr && ids->count(unit))
+    ids->emplace(res, ids->at(unit));
+  return res;
+}
+
+//return true if subtree can change variable with given offset
+static bool writes_slot(const PTree *unit, int offset) {
+  if (unit == nullptr)
+    return false;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      if (writes_slot(expr, offset))
+        return true;
+    return false;
+  }
+  if (auto branch = dynamic_cast<const Branch *>(unit))
+    if (writes_slot(branch->condition_, offset))
+      return true;
+  if (auto assign = dynamic_cast<const Assign *>(unit))
+    if (assign->lval->getoffset() == offset)
+      return true;
+  if (auto unop = dynamic_cast<const UnOp *>(unit))
+    if (unop->operation_ == UnOpType::POST_ADDITION || unop->operation_ == UnOpType::POST_SUBTRACTION)
+      if (auto var = dynamic_cast<const NameInt *>(unop->getleft()))
+        return var->getoffset() == offset;
+  return writes_slot(unit->getleft(), offset) || writes_slot(unit->getright(), offset);
+}
+
+//return true if loop body has no branches, loops, input or output, scev collapses such loops
+static bool is_straight(const PTree *unit) {
+  if (unit == nullptr)
+    return true;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      if (!is_straight(expr))
+        return false;
+    return true;
+  }
+  if (dynamic_cast<const Branch *>(unit) || dynamic_cast<const Output *>(unit) ||
+      dynamic_cast<const Reserved *>(unit))
+    return false;
+  return is_straight(unit->getleft()) && is_straight(unit->getright());
+}
+
+double ProfileGuide::dominance = 0.9;
+long ProfileGuide::minimum = 64;
+
+ProfileGuide::ProfileGuide(const Profile &profile, const std::map<const PTree *, int> &ids)
+    : profile_(profile), ids_(ids) {}
+
+int ProfileGuide::id(const PTree *unit) const {
+  auto it = ids_.find(unit);
+  return it != ids_.end() ? it->second : -1;
+}
+
+PTree *ProfileGuide::copy(const PTree *unit, int offset, int value) {
+  return clone_tree(unit, offset, value, &ids_);
+}
+
+void ProfileGuide::reorder(IfBlk *ifblock) {
+  auto it = profile_.branches.find(id(ifblock));
+  if (it == profile_.branches.end() || ifblock->getleft() == nullptr || ifblock->getright() == nullptr)
+    return;
+  const Profile::BranchCount &count = it->second;
+  if (count.taken + count.not_taken < minimum || count.not_taken <= 2 * count.taken)
+    return;
+  // else arm is hot, it goes first under inverted condition
+  PTree *on_true = ifblock->getright();
+  ifblock->setright(ifblock->getleft());
+  ifblock->setleft(on_true);
+  static const std::map<BinOpType, BinOpType> inverse = {
+    {BinOpType::EQUAL, BinOpType::NON_EQUAL}, {BinOpType::NON_EQUAL, BinOpType::EQUAL},
+    {BinOpType::LESS, BinOpType::MORE_EQUAL}, {BinOpType::MORE_EQUAL, BinOpType::LESS},
+    {BinOpType::MORE, BinOpType::LESS_EQUAL}, {BinOpType::LESS_EQUAL, BinOpType::MORE},
+  };
+  auto compare = dynamic_cast<BinOp *>(ifblock->condition_->getleft());
+  if (compare != nullptr && inverse.count(compare->operation_))
+    compare->operation_ = inverse.at(compare->operation_);
+  else
+    ifblock->condition_->setleft(new UnOp(UnOpType::NOT, nullptr, ifblock->condition_->getleft()));
+  ++reordered_;
+}
+
+PTree *ProfileGuide::version(WhileBlk *loop) {
+  if (versioned_.count(loop) || count_nodes(loop) > 256)
+    return loop;
+  const NameInt *best = nullptr;
+  int bestvalue = 0;
+  long bestcount = 0;
+  std::vector<const PTree *> queue{loop};
+  while (!queue.empty()) {
+    const PTree *unit = queue.back();
+    queue.pop_back();
+    if (unit == nullptr)
+      continue;
+    if (auto block = dynamic_cast<const Block *>(unit))
+      queue.insert(queue.end(), block->operations.begin(), block->operations.end());
+    if (auto branch = dynamic_cast<const Branch *>(unit))
+      queue.push_back(branch->condition_);
+    queue.push_back(unit->getleft());
+    queue.push_back(unit->getright());
+    auto binop = dynamic_cast<const BinOp *>(unit);
+    int dominant;
+    if (binop == nullptr || !profile_.dominant(id(binop), dominant, dominance))
+      continue;
+    auto var = dynamic_cast<const NameInt *>(binop->getright());
+    long total = profile_.values.at(id(binop)).total;
+    if (var == nullptr || total < minimum || total <= bestcount || writes_slot(loop, var->getoffset()))
+      continue;
+    best = var;
+    bestvalue = dominant;
+    bestcount = total;
+  }
+  if (best == nullptr)
+    return loop;
+  versioned_.insert(loop);
+  Block *on_true = new Block;
+  on_true->push_expression(copy(loop, best->getoffset(), bestvalue));
+  Block *on_false = new Block;
+  on_false->push_expression(loop);
+  Condition *condition = new Condition(nullptr, new BinOp(BinOpType::EQUAL, nullptr, copy(best),
+                                                          new Imidiate<int>(bestvalue)));
+  ++versioned_count_;
+  return new IfBlk(condition, nullptr, on_false, on_true);
+}
+
+WhileBlk *ProfileGuide::unroll(WhileBlk *loop) {
+  auto it = profile_.loops.find(id(loop));
+  if (it == profile_.loops.end() || it->second.entries == 0 || it->second.iterations < minimum)
+    return nullptr;
+  long trips = it->second.iterations / it->second.entries;
+  int factor = trips >= 32 ? 4 : trips >= 8 ? 2 : 1;
+  auto body = dynamic_cast<const Block *>(loop->getleft());
+  if (factor == 1 || body == nullptr || body->operations.empty() || is_straight(body) ||
+      count_nodes(body) * factor > 256)
+    return nullptr;
+
+  // counting loop: while (i < n) { ...; i = i + 1; }, only the last statement changes i and nobody changes n
+  auto compare = dynamic_cast<const BinOp *>(loop->condition_->getleft());
+  if (compare == nullptr || compare->operation_ != BinOpType::LESS)
+    return nullptr;
+  auto counter = dynamic_cast<const NameInt *>(compare->getleft());
+  auto bound = compare->getright();
+  auto boundvar = dynamic_cast<const NameInt *>(bound);
+  if (counter == nullptr || (boundvar == nullptr && dynamic_cast<const Imidiate<int> *>(bound) == nullptr))
+    return nullptr;
+  auto last = dynamic_cast<const Expression *>(body->operations.back());
+  auto step = last != nullptr ? dynamic_cast<const Assign *>(last->getright()) : nullptr;
+  auto add = step != nullptr ? dynamic_cast<const BinOp *>(step->getright()) : nullptr;
+  if (add == nullptr || step->lval->getoffset() != counter->getoffset() ||
+      add->operation_ != BinOpType::ADDITION)
+    return nullptr;
+  auto self = dynamic_cast<const NameInt *>(add->getleft());
+  auto one = dynamic_cast<const Imidiate<int> *>(add->getright());
+  if (self == nullptr || self->getoffset() != counter->getoffset() || one == nullptr || one->getvalue() != 1)
+    return nullptr;
+  for (size_t i = 0; i + 1 < body->operations.size(); ++i)
+    if (writes_slot(body->operations[i], counter->getoffset()))
+      return nullptr;
+  if (boundvar != nullptr && (boundvar->getoffset() == counter->getoffset() || writes_slot(body, boundvar->getoffset())))
+    return nullptr;
+
+  // while (i < n && n - i > factor - 1) runs factor iterations at once, wrapped n - i only stops it earlier,
+  // original loop runs the rest
+  Condition *condition = new Condition(nullptr, new BinOp(BinOpType::LOG_AND, nullptr,
+      copy(compare),
+      new BinOp(BinOpType::MORE, nullptr,
+                new BinOp(BinOpType::SUBTRACTION, nullptr, copy(bound), copy(counter)),
+                new Imidiate<int>(factor - 1))));
+  Block *copies = new Block(body->offset_, body->id_);
+  for (int k = 0; k < factor; ++k)
+    for (auto expr : body->operations)
+      copies->push_expression(copy(expr));
+  ++unrolled_;
+  return new WhileBlk(condition, nullptr, copies);
+}
+
+void ProfileGuide::visit(PTree *unit) {
+  auto block = dynamic_cast<Block *>(unit);
+  if (block == nullptr)
+    return;
+  std::vector<PTree *> operations;
+  for (auto expr : block->operations) {
+    if (auto whileblock = dynamic_cast<WhileBlk *>(expr)) {
+      // both copies of versioned loop are visited as arms of new if
+      expr = version(whileblock);
+      if (expr == whileblock) {
+        visit(whileblock->getleft());
+        if (WhileBlk *unrolled = unroll(whileblock))
+          operations.push_back(unrolled);
+      }
+    }
+    if (auto ifblock = dynamic_cast<IfBlk *>(expr)) {
+      visit(ifblock->getleft());
+      visit(ifblock->getright());
+      reorder(ifblock);
+    }
+    operations.push_back(expr);
+  }
+  block->operations = operations;
+}
+
+void ProfileGuide::run(PTree *root) {
+  reordered_ = versioned_count_ = unrolled_ = 0;
+  visit(root);
+}
+
+std::string ProfileGuide::report() const {
+  return "Profile: " + std::to_string(reordered_) + " if reordered, " + std::to_string(versioned_count_) +
+         " loops versioned, " + std::to_string(unrolled_) + " loops unrolled";
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <istream>
+#include <ostream>
+
+/*
+profile structure:
+1) number_nodes - stable node ids: preorder numbers in parsed tree, so the same source
+   gets the same ids after every parse
+2) Profile - if arm counts, while trip counts and frequent right operands of *, / and %
+   by node id, it is saved to text file and counts of several runs are added
+3) Profiler - tree interpreter which runs program and fills Profile
+4) ProfileGuide - transformations of tree (after manage_tree_mem) driven by Profile: hot arm
+   of if goes first, loop gets a copy for dominant operand value, counting loops are unrolled
+*/
+
+namespace ptree {
+
+//return preorder numbers of all nodes of tree
+std::map<const PTree *, int> number_nodes(const PTree *root);
+
+class Profile {
+  public:
+  struct BranchCount {
+    long taken = 0;
+    long not_taken = 0;
+  };
+  struct LoopCount {
+    long entries = 0;
+    long iterations = 0;
+  };
+  //at most limit distinct values are counted, the rest only add to total
+  struct ValueCount {
+    static const size_t limit = 8;
+    long total = 0;
+    std::map<int, long> counts;
+    void record(int value);
+  };
+
+  std::map<int, BranchCount> branches;
+  std::map<int, LoopCount> loops;
+  std::map<int, ValueCount> values;
+
+  //add counts saved by previous runs
+  void load(std::istream &in);
+  //write one "if id taken not_taken", "while id entries iterations"
+  //or "value id total value count..." line per node
+  void save(std::ostream &out) const;
+  //return true if one value of operand has at least share of all counts
+  bool dominant(int id, int &value, double share) const;
+};
+
+//runs tree like tree engine and records profile, division which traps raises SIGFPE
+class Profiler {
+  Profile &profile_;
+  const std::map<const PTree *, int> &ids_;
+  Stack *stack_ = nullptr;
+
+  int eval(const PTree *unit);
+  public:
+  Profiler(Profile &profile, const std::map<const PTree *, int> &ids);
+  //run program, stack should be created with MemManager::getmaxstacksize() size
+  void run(const PTree *root, Stack *stack);
+};
+
+class ProfileGuide {
+  const Profile &profile_;
+  //copies of nodes get ids of originals
+  std::map<const PTree *, int> ids_;
+  std::set<const PTree *> versioned_;
+  int reordered_ = 0;
+  int versioned_count_ = 0;
+  int unrolled_ = 0;
+
+  int id(const PTree *unit) const;
+  PTree *copy(const PTree *unit, int offset = -1, int value = 0);
+  void visit(PTree *unit);
+  void reorder(IfBlk *ifblock);
+  //if (b == value) { loop with value instead of b } else { loop }
+  PTree *version(WhileBlk *loop);
+  //loop with factor copies of body which runs before given loop
+  WhileBlk *unroll(WhileBlk *loop);
+  public:
+  //share of dominant operand value for specialisation
+  static double dominance;
+  //minimal count of executions to trust profile
+  static long minimum;
+
+  ProfileGuide(const Profile &profile, const std::map<const PTree *, int> &ids);
+  void run(PTree *root);
+  //return counts of applied transformations
+  std::string report() const;
+};
+
+//return deep copy of tree, reads of variable with given offset become value,
+//ids of copies are added to ids if it is given
+PTree *clone_tree(const PTree *unit, int offset = -1, int value = 0, std::map<const PTree *, int> *ids = nullptr);
+
+}
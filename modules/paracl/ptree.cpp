@@ -7,6 +7,9 @@ std::string get_addr(const void *addr) {
   return address.str();
 }
 std::unique_ptr<PTree> PTree::execute(Stack *stack) const { return std::unique_ptr<PTree>{}; }
+int PTree::eval(Stack *) const { throw std::logic_error{"Node has no value"}; }
+
+bool PTree::test(Stack *stack) const { return eval(stack) != 0; }
 bool PTree::isLeaf() const { return 0; }
 
 void PTree::setparent(PTree *parent) { parent_ = parent; }
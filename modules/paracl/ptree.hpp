@@ -3,6 +3,7 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <stdexcept>
 
 #include "stack.hpp"
 
@@ -23,6 +24,10 @@ public:
   virtual ~PTree() = default;
   //method for tree execution
   virtual std::unique_ptr<PTree> execute(Stack *stack) const;
+  //method for expression evaluation, returns value without any allocation
+  virtual int eval(Stack *stack) const;
+  //method for condition evaluation, returns truth of value, && and || may skip right operand
+  virtual bool test(Stack *stack) const;
   //return true if class leaf
   virtual bool isLeaf() const;
   //change parent pointer
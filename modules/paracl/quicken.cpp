@@ -0,0 +1,41 @@
+#include "quicken.hpp"
+
+namespace ptree {
+
+namespace {
+
+template <BinOpType Op>
+const QuickBinOp *specialise(const BinOp &binop, void *buffer, size_t size) {
+  auto lvar = dynamic_cast<const NameInt *>(binop.getleft());
+  auto rvar = dynamic_cast<const NameInt *>(binop.getright());
+  auto limm = dynamic_cast<const Imidiate<int> *>(binop.getleft());
+  auto rimm = dynamic_cast<const Imidiate<int> *>(binop.getright());
+  if (lvar && lvar->getoffset() < 0)
+    lvar = nullptr;
+  if (rvar && rvar->getoffset() < 0)
+    rvar = nullptr;
+
+  if (lvar && rimm)
+    return make_quick<BinOpVarConst<Op>>(buffer, size, lvar->getoffset(), rimm->getvalue());
+  if (lvar && rvar)
+    return make_quick<BinOpVarVar<Op>>(buffer, size, lvar->getoffset(), rvar->getoffset());
+  if (limm && rvar)
+    return make_quick<BinOpConstVar<Op>>(buffer, size, limm->getvalue(), rvar->getoffset());
+  return nullptr;
+}
+
+} // namespace
+
+const QuickBinOp *quicken(const BinOp &binop, void *buffer, size_t size) {
+  switch (binop.operation_) {
+#define PCL_QUICK_CASE(name, expr) \
+  case BinOpType::name:            \
+    return specialise<BinOpType::name>(binop, buffer, size);
+    PCL_QUICK_OPERATIONS(PCL_QUICK_CASE)
+#undef PCL_QUICK_CASE
+  default:
+    return nullptr;
+  }
+}
+
+}
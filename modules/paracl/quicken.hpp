@@ -0,0 +1,96 @@
+#pragma once
+
+#include "nonleaf.hpp"
+#include "leaf.hpp"
+
+#include <type_traits>
+#include <cstddef>
+#include <new>
+
+//operations with specialised nodes: BinOpType name and C++ expression of lhs and rhs,
+//adding new operation costs one line here
+#define PCL_QUICK_OPERATIONS(OP)               \
+  OP(ADDITION, lhs + rhs)                      \
+  OP(SUBTRACTION, lhs - rhs)                   \
+  OP(MULTIPLICATION, lhs * rhs)                \
+  OP(DIVISION, lhs / rhs)                      \
+  OP(REMAINDER, lhs % rhs)                     \
+  OP(EQUAL, lhs == rhs)                        \
+  OP(MORE_EQUAL, lhs >= rhs)                   \
+  OP(LESS_EQUAL, lhs <= rhs)                   \
+  OP(NON_EQUAL, lhs != rhs)                    \
+  OP(MORE, lhs > rhs)                          \
+  OP(LESS, lhs < rhs)                          \
+  OP(LOG_AND, lhs && rhs)                      \
+  OP(LOG_OR, lhs || rhs)                       \
+  OP(SHIFT_LEFT, shift_left(lhs, rhs))         \
+  OP(SHIFT_RIGHT, lhs >> rhs)                  \
+  OP(BIT_AND, lhs & rhs)                       \
+  OP(MUL_HIGH, mul_high(lhs, rhs))
+
+namespace ptree {
+
+//result of binary operation known at compile time
+template <BinOpType Op> inline int binop_apply(int lhs, int rhs);
+
+#define PCL_QUICK_APPLY(name, expr)                                   \
+  template <> inline int binop_apply<BinOpType::name>(int lhs, int rhs) { \
+    return expr;                                                      \
+  }
+PCL_QUICK_OPERATIONS(PCL_QUICK_APPLY)
+#undef PCL_QUICK_APPLY
+
+//variable op constant, e.g. y % 2
+template <BinOpType Op> class BinOpVarConst final : public QuickBinOp {
+  int offset_;
+  int value_;
+public:
+  BinOpVarConst(int offset, int value) : offset_(offset), value_(value) {}
+  int eval(Stack *stack) const override {
+    int lhs;
+    stack->read(offset_, lhs);
+    return binop_apply<Op>(lhs, value_);
+  }
+};
+
+//variable op variable, e.g. x < n
+template <BinOpType Op> class BinOpVarVar final : public QuickBinOp {
+  int loffset_;
+  int roffset_;
+public:
+  BinOpVarVar(int loffset, int roffset) : loffset_(loffset), roffset_(roffset) {}
+  int eval(Stack *stack) const override {
+    int lhs, rhs;
+    stack->read(loffset_, lhs);
+    stack->read(roffset_, rhs);
+    return binop_apply<Op>(lhs, rhs);
+  }
+};
+
+//constant op variable, e.g. 3 * y
+template <BinOpType Op> class BinOpConstVar final : public QuickBinOp {
+  int value_;
+  int offset_;
+public:
+  BinOpConstVar(int value, int offset) : value_(value), offset_(offset) {}
+  int eval(Stack *stack) const override {
+    int rhs;
+    stack->read(offset_, rhs);
+    return binop_apply<Op>(value_, rhs);
+  }
+};
+
+//construct specialised node in buffer
+template <typename Quick, typename... Args>
+const QuickBinOp *make_quick(void *buffer, size_t size, Args... args) {
+  static_assert(std::is_trivially_destructible<Quick>::value, "Specialised node is never destroyed");
+  if (sizeof(Quick) > size)
+    return nullptr;
+  return new (buffer) Quick(args...);
+}
+
+//build specialised node for binop in buffer,
+//return nullptr if operands kinds have no specialisation
+const QuickBinOp *quicken(const BinOp &binop, void *buffer, size_t size);
+
+}
@@ -0,0 +1,346 @@
+#include "range.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <initializer_list>
+
+namespace ptree {
+
+namespace ssa {
+
+using Range = RangeAnalysis::Range;
+
+static const Range full{INT_MIN, INT_MAX};
+static const Range none{1, 0};
+static const Range boolean{0, 1};
+
+static Range hull(std::initializer_list<long long> values) {
+  return Range{std::min(values), std::max(values)};
+}
+
+static Range join(const Range &a, const Range &b) {
+  if (a.empty())
+    return b;
+  if (b.empty())
+    return a;
+  return Range{std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+}
+
+//result of operation which leaves int bounds wraps around and can be any value
+static Range fit(const Range &range) {
+  return range.empty() || (range.lo >= INT_MIN && range.hi <= INT_MAX) ? range : full;
+}
+
+static std::string text(const Range &range) {
+  return "[" + std::to_string(range.lo) + ", " + std::to_string(range.hi) + "]";
+}
+
+//truncated division is monotonic in dividend and in divisor of one sign, so bounds are
+//reached at corners of intervals, divisor 0 traps and gives no value
+static Range divide(BinOpType operation, const Range &a, const Range &b) {
+  Range negative{b.lo, std::min(b.hi, -1LL)};
+  Range positive{std::max(b.lo, 1LL), b.hi};
+  if (operation == BinOpType::DIVISION) {
+    Range res = none;
+    for (const Range &part : {negative, positive})
+      if (!part.empty())
+        res = join(res, hull({a.lo / part.lo, a.lo / part.hi, a.hi / part.lo, a.hi / part.hi}));
+    return res;
+  }
+  // remainder takes sign of dividend and is less than divisor by absolute value
+  if (negative.empty() && positive.empty())
+    return none;
+  long long limit = std::max(negative.empty() ? 0 : -negative.lo, positive.empty() ? 0 : positive.hi) - 1;
+  if (a.lo >= 0)
+    return Range{0, std::min(a.hi, limit)};
+  if (a.hi <= 0)
+    return Range{std::max(a.lo, -limit), 0};
+  return Range{-limit, limit};
+}
+
+//exact result of operation, it can leave int bounds
+static Range exact(BinOpType operation, const Range &a, const Range &b) {
+  switch (operation) {
+  case BinOpType::ADDITION:
+    return Range{a.lo + b.lo, a.hi + b.hi};
+  case BinOpType::SUBTRACTION:
+    return Range{a.lo - b.hi, a.hi - b.lo};
+  case BinOpType::MULTIPLICATION:
+    return hull({a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi});
+  case BinOpType::DIVISION:
+  case BinOpType::REMAINDER:
+    return divide(operation, a, b);
+  case BinOpType::SHIFT_LEFT:
+    if (b.lo < 0 || b.hi > 31)
+      return full;
+    return exact(BinOpType::MULTIPLICATION, a, Range{1LL << b.lo, 1LL << b.hi});
+  case BinOpType::SHIFT_RIGHT:
+    if (b.lo < 0 || b.hi > 31)
+      return full;
+    return hull({a.lo >> b.lo, a.lo >> b.hi, a.hi >> b.lo, a.hi >> b.hi});
+  case BinOpType::BIT_AND:
+    if (a.lo >= 0 || b.lo >= 0)
+      return Range{0, a.lo >= 0 && b.lo >= 0 ? std::min(a.hi, b.hi) : a.lo >= 0 ? a.hi : b.hi};
+    return full;
+  case BinOpType::MUL_HIGH:
+    return hull({a.lo * b.lo >> 32, a.lo * b.hi >> 32, a.hi * b.lo >> 32, a.hi * b.hi >> 32});
+  default:
+    // comparisons, && and ||
+    return boolean;
+  }
+}
+
+static bool is_arithmetic(const Instr &instr) {
+  if (instr.op == Op::NEG)
+    return true;
+  return instr.op == Op::BINARY &&
+         (instr.binop == BinOpType::ADDITION || instr.binop == BinOpType::SUBTRACTION ||
+          instr.binop == BinOpType::MULTIPLICATION || instr.binop == BinOpType::SHIFT_LEFT);
+}
+
+RangeAnalysis::RangeAnalysis(Function &function) : f_(function) {}
+
+//value is operand of condition which is known to be true (taken) or false
+void RangeAnalysis::narrow(Range &range, int value, int cond, bool taken) const {
+  if (range.empty())
+    return;
+  if (cond == value) {
+    if (!taken)
+      range = Range{std::max(range.lo, 0LL), std::min(range.hi, 0LL)};
+    else if (range.lo == 0)
+      ++range.lo;
+    else if (range.hi == 0)
+      --range.hi;
+    return;
+  }
+  const Instr &instr = f_.instrs[cond];
+  if (instr.op == Op::NOT) {
+    narrow(range, value, instr.operands[0], !taken);
+    return;
+  }
+  if (instr.op != Op::BINARY)
+    return;
+  // a && b is true and a || b is false only when both operands are
+  if ((instr.binop == BinOpType::LOG_AND && taken) || (instr.binop == BinOpType::LOG_OR && !taken)) {
+    narrow(range, value, instr.operands[0], taken);
+    narrow(range, value, instr.operands[1], taken);
+    return;
+  }
+  int lhs = instr.operands[0];
+  int rhs = instr.operands[1];
+  if ((lhs == value) == (rhs == value))
+    return;
+  // value relation other
+  BinOpType relation = instr.binop;
+  static const std::vector<std::pair<BinOpType, BinOpType>> mirror = {
+    {BinOpType::LESS, BinOpType::MORE}, {BinOpType::LESS_EQUAL, BinOpType::MORE_EQUAL},
+    {BinOpType::MORE, BinOpType::LESS}, {BinOpType::MORE_EQUAL, BinOpType::LESS_EQUAL},
+    {BinOpType::EQUAL, BinOpType::EQUAL}, {BinOpType::NON_EQUAL, BinOpType::NON_EQUAL},
+  };
+  static const std::vector<std::pair<BinOpType, BinOpType>> inverse = {
+    {BinOpType::LESS, BinOpType::MORE_EQUAL}, {BinOpType::LESS_EQUAL, BinOpType::MORE},
+    {BinOpType::MORE, BinOpType::LESS_EQUAL}, {BinOpType::MORE_EQUAL, BinOpType::LESS},
+    {BinOpType::EQUAL, BinOpType::NON_EQUAL}, {BinOpType::NON_EQUAL, BinOpType::EQUAL},
+  };
+  auto apply = [&relation](const std::vector<std::pair<BinOpType, BinOpType>> &table) {
+    for (auto &pair : table)
+      if (pair.first == relation) {
+        relation = pair.second;
+        return true;
+      }
+    return false;
+  };
+  if ((rhs == value && !apply(mirror)) || (!taken && !apply(inverse)))
+    return;
+  const Range &other = values_[lhs == value ? rhs : lhs];
+  if (other.empty())
+    return;
+  switch (relation) {
+  case BinOpType::LESS:
+    range.hi = std::min(range.hi, other.hi - 1);
+    break;
+  case BinOpType::LESS_EQUAL:
+    range.hi = std::min(range.hi, other.hi);
+    break;
+  case BinOpType::MORE:
+    range.lo = std::max(range.lo, other.lo + 1);
+    break;
+  case BinOpType::MORE_EQUAL:
+    range.lo = std::max(range.lo, other.lo);
+    break;
+  case BinOpType::EQUAL:
+    range = Range{std::max(range.lo, other.lo), std::min(range.hi, other.hi)};
+    break;
+  case BinOpType::NON_EQUAL:
+    if (other.lo == other.hi && range.lo == other.lo)
+      ++range.lo;
+    else if (other.lo == other.hi && range.hi == other.lo)
+      --range.hi;
+    break;
+  default:
+    break;
+  }
+}
+
+//block with the only predecessor is entered when condition of its branch has known value,
+//it holds in all blocks which the block dominates
+Range RangeAnalysis::restrict(Range range, int value, int block) const {
+  for (int b = block; b > 0 && !range.empty(); b = f_.blocks[b].idom) {
+    const BasicBlock &current = f_.blocks[b];
+    if (current.preds.size() != 1)
+      continue;
+    const BasicBlock &pred = f_.blocks[current.preds[0]];
+    const Instr &branch = f_.terminator(current.preds[0]);
+    if (branch.op == Op::CBR && pred.succs[0] != pred.succs[1])
+      narrow(range, value, branch.operands[0], pred.succs[0] == b);
+  }
+  return range;
+}
+
+Range RangeAnalysis::getrange(int value, int block) const { return restrict(values_[value], value, block); }
+
+Range RangeAnalysis::evaluate(const Instr &instr) const {
+  auto operand = [this, &instr](int i) { return getrange(instr.operands[i], instr.block); };
+  switch (instr.op) {
+  case Op::CONST:
+    return Range{instr.imm, instr.imm};
+  case Op::PHI: {
+    // value comes at the end of predecessor, through its edge to the phi
+    Range res = none;
+    const std::vector<int> &preds = f_.blocks[instr.block].preds;
+    for (size_t i = 0; i < preds.size(); ++i) {
+      Range in = getrange(instr.operands[i], preds[i]);
+      const BasicBlock &pred = f_.blocks[preds[i]];
+      const Instr &branch = f_.terminator(preds[i]);
+      if (branch.op == Op::CBR && pred.succs[0] != pred.succs[1])
+        narrow(in, instr.operands[i], branch.operands[0], pred.succs[0] == instr.block);
+      res = join(res, in);
+    }
+    return res;
+  }
+  case Op::NEG: {
+    Range a = operand(0);
+    return a.empty() ? a : fit(Range{-a.hi, -a.lo});
+  }
+  case Op::NOT: {
+    Range a = operand(0);
+    if (a.empty())
+      return a;
+    if (!a.contains(0))
+      return Range{0, 0};
+    return a.lo == 0 && a.hi == 0 ? Range{1, 1} : boolean;
+  }
+  case Op::BINARY: {
+    Range a = operand(0);
+    Range b = operand(1);
+    if (a.empty() || b.empty())
+      return none;
+    return fit(exact(instr.binop, a, b));
+  }
+  case Op::ENTRY:
+  case Op::INPUT:
+    return full;
+  default:
+    return none;
+  }
+}
+
+//one pass over values in reverse postorder, phi which keeps changing is widened to int bounds
+bool RangeAnalysis::update(bool widen) {
+  bool changed = false;
+  for (int b : f_.reverse_postorder())
+    for (int id : f_.blocks[b].instrs) {
+      const Instr &instr = f_.instrs[id];
+      if (instr.op == Op::PRINT || instr.op == Op::BR || instr.op == Op::CBR || instr.op == Op::RET)
+        continue;
+      Range range = evaluate(instr);
+      Range &old = values_[id];
+      if (range.lo == old.lo && range.hi == old.hi)
+        continue;
+      // phis only grow until the fixed point, so widening ends in a few steps
+      if (widen && instr.op == Op::PHI) {
+        range = join(old, range);
+        if (++changes_[id] > 2 && !old.empty()) {
+          if (range.lo < old.lo)
+            range.lo = INT_MIN;
+          if (range.hi > old.hi)
+            range.hi = INT_MAX;
+        }
+        if (range.lo == old.lo && range.hi == old.hi)
+          continue;
+      }
+      old = range;
+      changed = true;
+    }
+  return changed;
+}
+
+void RangeAnalysis::run() {
+  values_.assign(f_.instrs.size(), none);
+  changes_.assign(f_.instrs.size(), 0);
+  unsafe_.clear();
+  divisions_ = safe_ = arithmetic_ = nowrap_ = 0;
+  while (update(true))
+    ;
+  // widened bounds are narrowed by loop conditions
+  for (int i = 0; i < 8 && update(false); ++i)
+    ;
+
+  for (int b : f_.reverse_postorder())
+    for (int id : f_.blocks[b].instrs) {
+      Instr &instr = f_.instrs[id];
+      Range a = instr.operands.empty() ? none : getrange(instr.operands[0], b);
+      Range c = instr.operands.size() < 2 ? none : getrange(instr.operands[1], b);
+      bool unreachable = a.empty() || (instr.op == Op::BINARY && c.empty());
+      if (instr.op == Op::BINARY && (instr.binop == BinOpType::DIVISION || instr.binop == BinOpType::REMAINDER)) {
+        ++divisions_;
+        // interval can not exclude 0 from its middle, so conditions are checked for it separately
+        int divisor = instr.operands[1];
+        if (!unreachable && c.contains(0) && !restrict(Range{0, 0}, divisor, b).empty())
+          unsafe_.push_back({id, "divisor " + text(c) + " can be 0"});
+        else if (!unreachable && a.contains(INT_MIN) && c.contains(-1) && !restrict(Range{-1, -1}, divisor, b).empty())
+          unsafe_.push_back({id, "dividend " + text(a) + " can be INT_MIN and divisor " + text(c) + " can be -1"});
+        else {
+          instr.safe = true;
+          ++safe_;
+        }
+      } else if (is_arithmetic(instr)) {
+        ++arithmetic_;
+        Range res = unreachable ? none : instr.op == Op::NEG ? Range{-a.hi, -a.lo} : exact(instr.binop, a, c);
+        if (!res.empty() && (res.lo < INT_MIN || res.hi > INT_MAX))
+          unsafe_.push_back({id, "result " + text(res) + " can wrap around"});
+        else
+          ++nowrap_;
+      }
+    }
+}
+
+int RangeAnalysis::getdivisions() const { return divisions_; }
+
+int RangeAnalysis::getsafe() const { return safe_; }
+
+int RangeAnalysis::getarithmetic() const { return arithmetic_; }
+
+int RangeAnalysis::getnowrap() const { return nowrap_; }
+
+std::string RangeAnalysis::report() const {
+  std::string res;
+  for (auto &site : unsafe_) {
+    const Instr &instr = f_.instrs[site.first];
+    res += "b" + std::to_string(instr.block) + ": %" + std::to_string(site.first) + " = ";
+    if (instr.op == Op::NEG)
+      res += "neg %" + std::to_string(instr.operands[0]);
+    else
+      res += binop_name(instr.binop) + " %" + std::to_string(instr.operands[0]) + ", %" +
+             std::to_string(instr.operands[1]);
+    auto name = f_.names.find(instr.slot);
+    if (name != f_.names.end())
+      res += " ; " + name->second;
+    res += ": " + site.second + "\n";
+  }
+  return res;
+}
+
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ptree {
+
+namespace ssa {
+
+//range analysis: every value gets interval of values it can take, intervals flow through
+//operations and phis, conditions of branches narrow operands in blocks which they dominate,
+//loop phis are widened to int bounds and then narrowed, so loop counters get bounds of loop
+//conditions; division by interval without zero (and INT_MIN by -1) can not trap and
+//operation whose exact result fits in int can not wrap
+class RangeAnalysis {
+  public:
+  //empty if lo > hi, bounds are exact values without wrap around
+  struct Range {
+    long long lo;
+    long long hi;
+    bool empty() const { return lo > hi; }
+    bool contains(long long value) const { return lo <= value && value <= hi; }
+  };
+
+  private:
+  Function &f_;
+  std::vector<Range> values_;
+  std::vector<int> changes_;
+  //operations which can trap or wrap around with reason
+  std::vector<std::pair<int, std::string>> unsafe_;
+  int divisions_ = 0;
+  int safe_ = 0;
+  int arithmetic_ = 0;
+  int nowrap_ = 0;
+
+  void narrow(Range &range, int value, int cond, bool taken) const;
+  //apply conditions of branches to the block to range of value
+  Range restrict(Range range, int value, int block) const;
+  Range evaluate(const Instr &instr) const;
+  bool update(bool widen);
+
+  public:
+  RangeAnalysis(Function &function);
+  //compute ranges and mark divisions which can not trap as safe
+  void run();
+  //return range of value in block, conditions of branches to the block are applied
+  Range getrange(int value, int block) const;
+  //count of divisions and remainders, and of them which can not trap
+  int getdivisions() const;
+  int getsafe() const;
+  //count of +, -, *, shifts and negations, and of them which can not wrap around
+  int getarithmetic() const;
+  int getnowrap() const;
+  //return list of operations which can trap or wrap around with ranges of their operands
+  std::string report() const;
+};
+
+}
+
+}
@@ -0,0 +1,421 @@
+#include "regcode.hpp"
+#include "fold.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace ptree {
+
+namespace regcode {
+
+std::string opcode_name(Opcode op) {
+  switch (op) {
+  case Opcode::MOV:
+    return "MOV";
+  case Opcode::ADD:
+    return "ADD";
+  case Opcode::SUB:
+    return "SUB";
+  case Opcode::MUL:
+    return "MUL";
+  case Opcode::DIV:
+    return "DIV";
+  case Opcode::REM:
+    return "REM";
+  case Opcode::EQ:
+    return "EQ";
+  case Opcode::GE:
+    return "GE";
+  case Opcode::LE:
+    return "LE";
+  case Opcode::NE:
+    return "NE";
+  case Opcode::GT:
+    return "GT";
+  case Opcode::LT:
+    return "LT";
+  case Opcode::AND:
+    return "AND";
+  case Opcode::OR:
+    return "OR";
+  case Opcode::SHL:
+    return "SHL";
+  case Opcode::SHR:
+    return "SHR";
+  case Opcode::BAND:
+    return "BAND";
+  case Opcode::MULHI:
+    return "MULHI";
+  case Opcode::NEG:
+    return "NEG";
+  case Opcode::NOT:
+    return "NOT";
+  case Opcode::INC:
+    return "INC";
+  case Opcode::DEC:
+    return "DEC";
+  case Opcode::INPUT:
+    return "INPUT";
+  case Opcode::PRINT:
+    return "PRINT";
+  case Opcode::JMP:
+    return "JMP";
+  case Opcode::JZ:
+    return "JZ";
+  case Opcode::JNZ:
+    return "JNZ";
+  case Opcode::JEQ:
+    return "JEQ";
+  case Opcode::JNE:
+    return "JNE";
+  case Opcode::JLT:
+    return "JLT";
+  case Opcode::JGE:
+    return "JGE";
+  case Opcode::JLE:
+    return "JLE";
+  case Opcode::JGT:
+    return "JGT";
+  case Opcode::HALT:
+    return "HALT";
+  }
+  return "?";
+}
+
+Opcode binop_opcode(BinOpType operation) {
+  switch (operation) {
+  case BinOpType::ADDITION:
+    return Opcode::ADD;
+  case BinOpType::SUBTRACTION:
+    return Opcode::SUB;
+  case BinOpType::MULTIPLICATION:
+    return Opcode::MUL;
+  case BinOpType::DIVISION:
+    return Opcode::DIV;
+  case BinOpType::REMAINDER:
+    return Opcode::REM;
+  case BinOpType::EQUAL:
+    return Opcode::EQ;
+  case BinOpType::MORE_EQUAL:
+    return Opcode::GE;
+  case BinOpType::LESS_EQUAL:
+    return Opcode::LE;
+  case BinOpType::NON_EQUAL:
+    return Opcode::NE;
+  case BinOpType::MORE:
+    return Opcode::GT;
+  case BinOpType::LESS:
+    return Opcode::LT;
+  case BinOpType::LOG_AND:
+    return Opcode::AND;
+  case BinOpType::LOG_OR:
+    return Opcode::OR;
+  case BinOpType::SHIFT_LEFT:
+    return Opcode::SHL;
+  case BinOpType::SHIFT_RIGHT:
+    return Opcode::SHR;
+  case BinOpType::BIT_AND:
+    return Opcode::BAND;
+  case BinOpType::MUL_HIGH:
+    return Opcode::MULHI;
+  default:
+    throw std::logic_error{"Undefined binary operation in register compiler"};
+  }
+}
+
+bool branch_opcode(BinOpType operation, bool sense, Opcode &op) {
+  switch (operation) {
+  case BinOpType::EQUAL: op = sense ? Opcode::JEQ : Opcode::JNE; return true;
+  case BinOpType::NON_EQUAL: op = sense ? Opcode::JNE : Opcode::JEQ; return true;
+  case BinOpType::LESS: op = sense ? Opcode::JLT : Opcode::JGE; return true;
+  case BinOpType::MORE_EQUAL: op = sense ? Opcode::JGE : Opcode::JLT; return true;
+  case BinOpType::LESS_EQUAL: op = sense ? Opcode::JLE : Opcode::JGT; return true;
+  case BinOpType::MORE: op = sense ? Opcode::JGT : Opcode::JLE; return true;
+  default: return false;
+  }
+}
+
+std::string Program::dump() const {
+  std::string res;
+  res += "registers: " + std::to_string(regcount) + ", variables: " + std::to_string(varcount) + "\n";
+  for (size_t i = 0; i < constants.size(); ++i)
+    res += "r" + std::to_string(varcount + i) + " = " + std::to_string(constants[i]) + "\n";
+  for (size_t i = 0; i < code.size(); ++i) {
+    const Instruction &instr = code[i];
+    res += std::to_string(i) + ": " + opcode_name(instr.op);
+    switch (instr.op) {
+    case Opcode::MOV:
+    case Opcode::NEG:
+    case Opcode::NOT:
+      res += " r" + std::to_string(instr.dst) + " r" + std::to_string(instr.a);
+      break;
+    case Opcode::INC:
+    case Opcode::DEC:
+    case Opcode::INPUT:
+      res += " r" + std::to_string(instr.dst);
+      break;
+    case Opcode::PRINT:
+      res += " r" + std::to_string(instr.a);
+      break;
+    case Opcode::JMP:
+      res += " " + std::to_string(instr.dst);
+      break;
+    case Opcode::JZ:
+    case Opcode::JNZ:
+      res += " " + std::to_string(instr.dst) + " r" + std::to_string(instr.a);
+      break;
+    case Opcode::JEQ:
+    case Opcode::JNE:
+    case Opcode::JLT:
+    case Opcode::JGE:
+    case Opcode::JLE:
+    case Opcode::JGT:
+      res += " " + std::to_string(instr.dst) + " r" + std::to_string(instr.a) +
+             " r" + std::to_string(instr.b);
+      break;
+    case Opcode::HALT:
+      break;
+    default:
+      res += " r" + std::to_string(instr.dst) + " r" + std::to_string(instr.a) +
+             " r" + std::to_string(instr.b);
+      break;
+    }
+    res += "\n";
+  }
+  return res;
+}
+
+bool writes_vars(const PTree *unit) {
+  if (unit == nullptr)
+    return false;
+  if (dynamic_cast<const Assign *>(unit))
+    return true;
+  if (auto unop = dynamic_cast<const UnOp *>(unit))
+    if (unop->operation_ == UnOpType::POST_ADDITION ||
+        unop->operation_ == UnOpType::POST_SUBTRACTION)
+      return true;
+  return writes_vars(unit->getleft()) || writes_vars(unit->getright());
+}
+
+int Compiler::emit(Opcode op, int dst, int a, int b) {
+  program_.code.push_back(Instruction{op, dst, a, b});
+  return program_.code.size() - 1;
+}
+
+void Compiler::patch(int at) { program_.code[at].dst = program_.code.size(); }
+
+int Compiler::var_reg(const NameInt *var) {
+  if (var->getoffset() < 0)
+    throw std::logic_error{"Usage of undeclared variable " + var->getvarname()};
+  return var->getoffset() / sizeof(int);
+}
+
+int Compiler::const_reg(int value) {
+  return program_.varcount + constregs_.at(value);
+}
+
+int Compiler::temp_reg() {
+  int reg = program_.varcount + program_.constants.size() + temps_++;
+  maxtemps_ = std::max(maxtemps_, temps_);
+  return reg;
+}
+
+void Compiler::scan(const PTree *unit) {
+  if (unit == nullptr)
+    return;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      scan(expr);
+    return;
+  }
+  if (auto branch = dynamic_cast<const Branch *>(unit))
+    scan(branch->condition_);
+  if (auto assign = dynamic_cast<const Assign *>(unit))
+    scan(assign->lval);
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit)) {
+    int value = imidiate->getvalue();
+    if (constregs_.find(value) == constregs_.end()) {
+      constregs_[value] = program_.constants.size();
+      program_.constants.push_back(value);
+    }
+  }
+  if (auto nameint = dynamic_cast<const NameInt *>(unit))
+    program_.varcount = std::max<int>(program_.varcount, nameint->getoffset() / sizeof(int) + 1);
+  scan(unit->getleft());
+  scan(unit->getright());
+}
+
+void Compiler::compile_stmt(const PTree *unit) {
+  if (unit == nullptr)
+    return;
+  temps_ = 0;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      compile_stmt(expr);
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    std::vector<int> to_else;
+    compile_cond(ifblock->condition_, false, to_else);
+    compile_stmt(ifblock->getright());
+    int to_end = -1;
+    if (ifblock->getleft() != nullptr)
+      to_end = emit(Opcode::JMP);
+    for (int at : to_else)
+      patch(at);
+    if (ifblock->getleft() != nullptr) {
+      compile_stmt(ifblock->getleft());
+      patch(to_end);
+    }
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw std::logic_error{"No condition in while cycle"};
+    // condition is placed after the body, so each iteration takes one jump
+    int to_cond = emit(Opcode::JMP);
+    int body = program_.code.size();
+    compile_stmt(whileblock->getleft());
+    patch(to_cond);
+    temps_ = 0;
+    std::vector<int> to_body;
+    compile_cond(whileblock->condition_, true, to_body);
+    for (int at : to_body)
+      program_.code[at].dst = body;
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    compile_stmt(expression->getright());
+    return;
+  }
+  compile_expr(unit);
+}
+
+void Compiler::compile_operands(const BinOp *binop, int &lhs, int &rhs) {
+  lhs = compile_expr(binop->getleft());
+  // variable register should be copied if right operand changes it
+  if (lhs < program_.varcount && writes_vars(binop->getright())) {
+    int copy = temp_reg();
+    emit(Opcode::MOV, copy, lhs);
+    lhs = copy;
+  }
+  rhs = compile_expr(binop->getright());
+}
+
+void Compiler::compile_cond(const PTree *unit, bool sense, std::vector<int> &jumps) {
+  if (auto condition = dynamic_cast<const Condition *>(unit)) {
+    compile_cond(condition->getleft(), sense, jumps);
+    return;
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit); unop != nullptr && unop->operation_ == UnOpType::NOT) {
+    compile_cond(unop->getleft(), !sense, jumps);
+    return;
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    Opcode op;
+    if (branch_opcode(binop->operation_, sense, op)) {
+      int lhs, rhs;
+      compile_operands(binop, lhs, rhs);
+      jumps.push_back(emit(op, 0, lhs, rhs));
+      return;
+    }
+    bool is_and = binop->operation_ == BinOpType::LOG_AND;
+    if ((is_and || binop->operation_ == BinOpType::LOG_OR) && is_pure(binop->getright())) {
+      // false operand of && (true operand of ||) decides the condition
+      if (is_and != sense) {
+        compile_cond(binop->getleft(), sense, jumps);
+        compile_cond(binop->getright(), sense, jumps);
+      } else {
+        std::vector<int> skip;
+        compile_cond(binop->getleft(), !sense, skip);
+        compile_cond(binop->getright(), sense, jumps);
+        for (int at : skip)
+          patch(at);
+      }
+      return;
+    }
+  }
+  jumps.push_back(emit(sense ? Opcode::JNZ : Opcode::JZ, 0, compile_expr(unit)));
+}
+
+int Compiler::compile_expr(const PTree *unit, int target) {
+  if (unit == nullptr)
+    throw std::logic_error{"Missing operand in register compiler"};
+  int result = -1;
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit)) {
+    result = const_reg(imidiate->getvalue());
+  } else if (auto nameint = dynamic_cast<const NameInt *>(unit)) {
+    result = var_reg(nameint);
+  } else if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw std::logic_error{"Reserved word has no value"};
+    result = target >= 0 ? target : temp_reg();
+    emit(Opcode::INPUT, result);
+  } else if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    int lhs, rhs;
+    compile_operands(binop, lhs, rhs);
+    result = target >= 0 ? target : temp_reg();
+    emit(binop_opcode(binop->operation_), result, lhs, rhs);
+  } else if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    switch (unop->operation_) {
+    case UnOpType::POST_ADDITION:
+    case UnOpType::POST_SUBTRACTION: {
+      auto var = dynamic_cast<const NameInt *>(unop->getleft());
+      if (var == nullptr)
+        throw std::logic_error{"Increment of not a variable"};
+      result = var_reg(var);
+      emit(unop->operation_ == UnOpType::POST_ADDITION ? Opcode::INC : Opcode::DEC, result);
+      break;
+    }
+    case UnOpType::MINUS:
+    case UnOpType::NOT: {
+      int operand = compile_expr(unop->getleft());
+      result = target >= 0 ? target : temp_reg();
+      emit(unop->operation_ == UnOpType::MINUS ? Opcode::NEG : Opcode::NOT, result, operand);
+      break;
+    }
+    default:
+      throw std::logic_error{"Undefined unary operation in register compiler"};
+    }
+  } else if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    result = var_reg(assign->lval);
+    compile_expr(assign->getright(), result);
+  } else if (auto output = dynamic_cast<const Output *>(unit)) {
+    result = compile_expr(output->getright());
+    emit(Opcode::PRINT, 0, result);
+  } else if (auto condition = dynamic_cast<const Condition *>(unit)) {
+    result = compile_expr(condition->getleft());
+  } else if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    result = compile_expr(expression->getright());
+  } else {
+    throw std::logic_error{"Node can not be compiled to register code"};
+  }
+
+  if (target >= 0 && result != target) {
+    emit(Opcode::MOV, target, result);
+    result = target;
+  }
+  return result;
+}
+
+Program Compiler::compile(const PTree *root) {
+  program_ = Program{};
+  constregs_.clear();
+  temps_ = maxtemps_ = 0;
+  scan(root);
+  compile_stmt(root);
+  emit(Opcode::HALT);
+  program_.regcount = program_.varcount + program_.constants.size() + maxtemps_;
+  return program_;
+}
+
+Program compile_tree(const PTree *root) {
+  Compiler compiler;
+  return compiler.compile(root);
+}
+
+} // namespace regcode
+
+} // namespace ptree
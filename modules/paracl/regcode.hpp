@@ -0,0 +1,122 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/*
+regcode structure:
+1) Opcode - three address instructions of register machine
+2) Instruction - opcode with destination and two source registers, jumps keep target in dst
+3) Program - flat array of instructions and register file layout:
+   [0, varcount) - variables, register number equals NameInt offset / sizeof(int)
+   [varcount, varcount + constants.size()) - registers preloaded with constants
+   [varcount + constants.size(), regcount) - temporary registers
+4) Compiler - lowers tree (after manage_tree_mem) into Program
+*/
+
+namespace ptree {
+
+namespace regcode {
+
+enum class Opcode : unsigned char {
+  MOV,    //dst = a
+  ADD,    //dst = a + b, same form for all binary operations
+  SUB,
+  MUL,
+  DIV,
+  REM,
+  EQ,
+  GE,
+  LE,
+  NE,
+  GT,
+  LT,
+  AND,
+  OR,
+  SHL,    //operations produced by strength reduction
+  SHR,
+  BAND,
+  MULHI,
+  NEG,    //dst = -a
+  NOT,    //dst = !a
+  INC,    //++dst
+  DEC,    //--dst
+  INPUT,  //read integer from stdin into dst
+  PRINT,  //print a
+  JMP,    //jump to instruction number dst
+  JZ,     //jump to instruction number dst if a equals zero
+  JNZ,    //jump to instruction number dst if a not equals zero
+  JEQ,    //compare and branch: jump to instruction number dst if a == b
+  JNE,
+  JLT,
+  JGE,
+  JLE,
+  JGT,
+  HALT
+};
+
+//return text name of opcode
+std::string opcode_name(Opcode op);
+//return opcode which provides given binary operation
+Opcode binop_opcode(BinOpType operation);
+//return compare and branch opcode for relation (sense true) or its negation,
+//false if operation is not a relation
+bool branch_opcode(BinOpType operation, bool sense, Opcode &op);
+
+struct Instruction {
+  Opcode op;
+  int dst;
+  int a;
+  int b;
+};
+
+class Program {
+  public:
+  std::vector<Instruction> code;
+  std::vector<int> constants;
+  int varcount = 0;
+  int regcount = 0;
+
+  //return std::string with program listing
+  std::string dump() const;
+};
+
+class Compiler {
+  Program program_;
+  std::unordered_map<int, int> constregs_;
+  int temps_ = 0;
+  int maxtemps_ = 0;
+
+  int emit(Opcode op, int dst = 0, int a = 0, int b = 0);
+  //set jump target of instruction number at to the next emitted instruction
+  void patch(int at);
+  int var_reg(const NameInt *var);
+  int const_reg(int value);
+  int temp_reg();
+  //collect variables and constants to fix register file layout
+  void scan(const PTree *unit);
+  void compile_stmt(const PTree *unit);
+  //compile expression and return register with its value,
+  //if target >= 0 value is placed exactly to target register
+  int compile_expr(const PTree *unit, int target = -1);
+  //compile operands of binary operation to registers lhs and rhs
+  void compile_operands(const BinOp *binop, int &lhs, int &rhs);
+  //compile condition, jumps taken when its truth equals sense are added to jumps,
+  //relations become compare and branch, && and || skip pure right operand
+  void compile_cond(const PTree *unit, bool sense, std::vector<int> &jumps);
+  public:
+  Program compile(const PTree *root);
+};
+
+//return true if evaluation of subtree can change any variable
+bool writes_vars(const PTree *unit);
+
+//lower tree with assigned offsets into register program
+Program compile_tree(const PTree *root);
+
+} // namespace regcode
+
+}
@@ -0,0 +1,91 @@
+#include "regvm.hpp"
+
+#include <iostream>
+
+namespace ptree {
+
+void RegisterVM::run(const regcode::Program &program, Stack *stack) {
+  using regcode::Opcode;
+  regs_.assign(program.regcount, 0);
+  int *r = regs_.data();
+  for (int i = 0; i < program.varcount; ++i)
+    stack->read(i * sizeof(int), r[i]);
+  for (size_t i = 0; i < program.constants.size(); ++i)
+    r[program.varcount + i] = program.constants[i];
+
+#ifdef PCL_THREADED_DISPATCH
+  // order of labels follows regcode::Opcode
+  static const void *const handlers[] = {
+      &&op_MOV, &&op_ADD, &&op_SUB,  &&op_MUL, &&op_DIV,   &&op_REM,
+      &&op_EQ,  &&op_GE,  &&op_LE,   &&op_NE,  &&op_GT,    &&op_LT,
+      &&op_AND, &&op_OR,  &&op_SHL,  &&op_SHR, &&op_BAND,  &&op_MULHI,
+      &&op_NEG, &&op_NOT, &&op_INC,  &&op_DEC,
+      &&op_INPUT, &&op_PRINT, &&op_JMP, &&op_JZ, &&op_JNZ,
+      &&op_JEQ, &&op_JNE, &&op_JLT, &&op_JGE, &&op_JLE, &&op_JGT, &&op_HALT};
+  threaded_.resize(program.code.size());
+  for (size_t i = 0; i < program.code.size(); ++i) {
+    const regcode::Instruction &instr = program.code[i];
+    threaded_[i] = Threaded{handlers[static_cast<int>(instr.op)], instr.dst, instr.a, instr.b};
+  }
+  const Threaded *base = threaded_.data();
+  const Threaded *ip = base;
+#define HANDLER(name) op_##name:
+#define NEXT() do { ++ip; goto *ip->handler; } while (0)
+#define JUMP(to) do { ip = base + (to); goto *ip->handler; } while (0)
+  goto *ip->handler;
+#else
+  const regcode::Instruction *base = program.code.data();
+  const regcode::Instruction *ip = base;
+#define HANDLER(name) case Opcode::name:
+#define NEXT() do { ++ip; goto dispatch; } while (0)
+#define JUMP(to) do { ip = base + (to); goto dispatch; } while (0)
+dispatch:
+  switch (ip->op) {
+#endif
+  HANDLER(MOV) r[ip->dst] = r[ip->a]; NEXT();
+  HANDLER(ADD) r[ip->dst] = r[ip->a] + r[ip->b]; NEXT();
+  HANDLER(SUB) r[ip->dst] = r[ip->a] - r[ip->b]; NEXT();
+  HANDLER(MUL) r[ip->dst] = r[ip->a] * r[ip->b]; NEXT();
+  HANDLER(DIV) r[ip->dst] = r[ip->a] / r[ip->b]; NEXT();
+  HANDLER(REM) r[ip->dst] = r[ip->a] % r[ip->b]; NEXT();
+  HANDLER(EQ) r[ip->dst] = r[ip->a] == r[ip->b]; NEXT();
+  HANDLER(GE) r[ip->dst] = r[ip->a] >= r[ip->b]; NEXT();
+  HANDLER(LE) r[ip->dst] = r[ip->a] <= r[ip->b]; NEXT();
+  HANDLER(NE) r[ip->dst] = r[ip->a] != r[ip->b]; NEXT();
+  HANDLER(GT) r[ip->dst] = r[ip->a] > r[ip->b]; NEXT();
+  HANDLER(LT) r[ip->dst] = r[ip->a] < r[ip->b]; NEXT();
+  HANDLER(AND) r[ip->dst] = r[ip->a] && r[ip->b]; NEXT();
+  HANDLER(OR) r[ip->dst] = r[ip->a] || r[ip->b]; NEXT();
+  HANDLER(SHL) r[ip->dst] = shift_left(r[ip->a], r[ip->b]); NEXT();
+  HANDLER(SHR) r[ip->dst] = r[ip->a] >> r[ip->b]; NEXT();
+  HANDLER(BAND) r[ip->dst] = r[ip->a] & r[ip->b]; NEXT();
+  HANDLER(MULHI) r[ip->dst] = mul_high(r[ip->a], r[ip->b]); NEXT();
+  HANDLER(NEG) r[ip->dst] = -r[ip->a]; NEXT();
+  HANDLER(NOT) r[ip->dst] = !r[ip->a]; NEXT();
+  HANDLER(INC) ++r[ip->dst]; NEXT();
+  HANDLER(DEC) --r[ip->dst]; NEXT();
+  HANDLER(INPUT) r[ip->dst] = readint(); NEXT();
+  HANDLER(PRINT) std::cout << r[ip->a] << std::endl; NEXT();
+  HANDLER(JMP) JUMP(ip->dst);
+  HANDLER(JZ) if (r[ip->a] == 0) JUMP(ip->dst); NEXT();
+  HANDLER(JNZ) if (r[ip->a] != 0) JUMP(ip->dst); NEXT();
+  HANDLER(JEQ) if (r[ip->a] == r[ip->b]) JUMP(ip->dst); NEXT();
+  HANDLER(JNE) if (r[ip->a] != r[ip->b]) JUMP(ip->dst); NEXT();
+  HANDLER(JLT) if (r[ip->a] < r[ip->b]) JUMP(ip->dst); NEXT();
+  HANDLER(JGE) if (r[ip->a] >= r[ip->b]) JUMP(ip->dst); NEXT();
+  HANDLER(JLE) if (r[ip->a] <= r[ip->b]) JUMP(ip->dst); NEXT();
+  HANDLER(JGT) if (r[ip->a] > r[ip->b]) JUMP(ip->dst); NEXT();
+  HANDLER(HALT) goto halt;
+#ifndef PCL_THREADED_DISPATCH
+  }
+#endif
+#undef HANDLER
+#undef NEXT
+#undef JUMP
+
+halt:
+  for (int i = 0; i < program.varcount; ++i)
+    stack->write(i * sizeof(int), r[i]);
+}
+
+}
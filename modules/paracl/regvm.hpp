@@ -0,0 +1,33 @@
+#pragma once
+
+#include "regcode.hpp"
+#include "stack.hpp"
+
+#include <vector>
+
+//handlers are chained with computed goto when compiler supports labels as values,
+//define PCL_SWITCH_DISPATCH to use portable switch dispatch instead
+#if defined(__GNUC__) && !defined(PCL_SWITCH_DISPATCH)
+#define PCL_THREADED_DISPATCH
+#endif
+
+namespace ptree {
+
+//register machine which runs register program, variable registers are loaded
+//from Stack before run and stored back after it
+class RegisterVM {
+  //instruction with resolved handler address for direct threading
+  struct Threaded {
+    const void *handler;
+    int dst;
+    int a;
+    int b;
+  };
+  std::vector<int> regs_;
+  std::vector<Threaded> threaded_;
+public:
+  //run program, stack should be created with MemManager::getmaxstacksize() size
+  void run(const regcode::Program &program, Stack *stack);
+};
+
+}
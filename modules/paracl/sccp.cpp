@@ -0,0 +1,175 @@
+#include "sccp.hpp"
+#include "fold.hpp"
+
+namespace ptree {
+
+namespace ssa {
+
+ConstantPropagation::ConstantPropagation(Function &function) : f_(function) {}
+
+void ConstantPropagation::lower(int value, Lattice lattice) {
+  Lattice &old = values_[value];
+  if (old.level == lattice.level && (lattice.level != Level::CONST || old.value == lattice.value))
+    return;
+  old = lattice;
+  ssalist_.push_back(value);
+}
+
+ConstantPropagation::Lattice ConstantPropagation::evaluate(const Instr &instr) const {
+  const Lattice bottom{Level::BOTTOM, 0};
+  auto constant = [](int value) { return Lattice{Level::CONST, value}; };
+  auto is_const = [](const Lattice &lattice, bool nonzero) {
+    return lattice.level == Level::CONST && (lattice.value != 0) == nonzero;
+  };
+  switch (instr.op) {
+  case Op::CONST:
+    return constant(instr.imm);
+  case Op::ENTRY:
+  case Op::INPUT:
+    return bottom;
+  case Op::PHI: {
+    // only edges which can be taken bring values
+    Lattice result;
+    const std::vector<int> &preds = f_.blocks[instr.block].preds;
+    for (size_t i = 0; i < preds.size(); ++i) {
+      if (!edges_.count({preds[i], instr.block}))
+        continue;
+      const Lattice &in = values_[instr.operands[i]];
+      if (in.level == Level::TOP)
+        continue;
+      if (in.level == Level::BOTTOM || (result.level == Level::CONST && result.value != in.value))
+        return bottom;
+      result = in;
+    }
+    return result;
+  }
+  case Op::NEG:
+  case Op::NOT: {
+    const Lattice &operand = values_[instr.operands[0]];
+    if (operand.level != Level::CONST)
+      return operand;
+    if (instr.op == Op::NOT)
+      return constant(!operand.value);
+    return constant(static_cast<int>(0u - static_cast<unsigned>(operand.value)));
+  }
+  case Op::BINARY: {
+    const Lattice &lhs = values_[instr.operands[0]];
+    const Lattice &rhs = values_[instr.operands[1]];
+    // one operand decides result, the other one can be unknown
+    if ((instr.binop == BinOpType::MULTIPLICATION || instr.binop == BinOpType::LOG_AND) &&
+        (is_const(lhs, false) || is_const(rhs, false)))
+      return constant(0);
+    if (instr.binop == BinOpType::LOG_OR && (is_const(lhs, true) || is_const(rhs, true)))
+      return constant(1);
+    if (lhs.level == Level::TOP || rhs.level == Level::TOP)
+      return Lattice{};
+    if (lhs.level == Level::BOTTOM || rhs.level == Level::BOTTOM)
+      return bottom;
+    int result;
+    // division by zero is left to run time
+    if (fold_binop(instr.binop, lhs.value, rhs.value, result))
+      return constant(result);
+    return bottom;
+  }
+  default:
+    return Lattice{};
+  }
+}
+
+void ConstantPropagation::mark_edge(int from, int to) {
+  if (edges_.insert({from, to}).second)
+    flowlist_.push_back({from, to});
+}
+
+void ConstantPropagation::visit(int id) {
+  const Instr &instr = f_.instrs[id];
+  const BasicBlock &block = f_.blocks[instr.block];
+  switch (instr.op) {
+  case Op::BR:
+    mark_edge(instr.block, block.succs[0]);
+    return;
+  case Op::CBR: {
+    const Lattice &cond = values_[instr.operands[0]];
+    if (cond.level == Level::TOP)
+      return;
+    if (cond.level == Level::BOTTOM || cond.value != 0)
+      mark_edge(instr.block, block.succs[0]);
+    if (cond.level == Level::BOTTOM || cond.value == 0)
+      mark_edge(instr.block, block.succs[1]);
+    return;
+  }
+  case Op::PRINT:
+  case Op::RET:
+    return;
+  default:
+    lower(id, evaluate(instr));
+  }
+}
+
+void ConstantPropagation::run() {
+  values_.assign(f_.instrs.size(), Lattice{});
+  executable_.assign(f_.blocks.size(), 0);
+  f_.compute_uses();
+  executable_[0] = 1;
+  for (int id : f_.blocks[0].instrs)
+    visit(id);
+  while (!flowlist_.empty() || !ssalist_.empty()) {
+    while (!flowlist_.empty()) {
+      int to = flowlist_.back().second;
+      flowlist_.pop_back();
+      if (!executable_[to]) {
+        executable_[to] = 1;
+        for (int id : f_.blocks[to].instrs)
+          visit(id);
+        continue;
+      }
+      for (int id : f_.blocks[to].instrs) {
+        if (f_.instrs[id].op != Op::PHI)
+          break;
+        visit(id);
+      }
+    }
+    while (!ssalist_.empty()) {
+      int value = ssalist_.back();
+      ssalist_.pop_back();
+      for (int user : f_.users[value])
+        if (f_.instrs[user].block >= 0 && executable_[f_.instrs[user].block])
+          visit(user);
+    }
+  }
+
+  // constants are placed to entry block, it dominates all uses
+  std::vector<int> targets;
+  for (size_t b = 0; b < f_.blocks.size(); ++b) {
+    if (!executable_[b])
+      continue;
+    for (int id : f_.blocks[b].instrs) {
+      Op op = f_.instrs[id].op;
+      if (values_[id].level == Level::CONST && op != Op::CONST && op != Op::PRINT && op != Op::CBR)
+        targets.push_back(id);
+    }
+  }
+  for (int id : targets) {
+    Instr constant;
+    constant.op = Op::CONST;
+    constant.imm = values_[id].value;
+    int replacement = f_.insert(0, constant);
+    f_.replace_uses(id, replacement);
+    f_.erase(id);
+    ++constants_;
+  }
+  for (size_t b = 0; b < f_.blocks.size(); ++b)
+    if (executable_[b] && f_.terminator(b).op == Op::CBR &&
+        f_.instrs[f_.terminator(b).operands[0]].op == Op::CONST)
+      ++branches_;
+}
+
+bool ConstantPropagation::executable(int block) const { return executable_[block]; }
+
+int ConstantPropagation::getconstants() const { return constants_; }
+
+int ConstantPropagation::getbranches() const { return branches_; }
+
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <vector>
+#include <set>
+#include <utility>
+
+namespace ptree {
+
+namespace ssa {
+
+//sparse conditional constant propagation (Wegman and Zadeck): values are assumed constant
+//until proven otherwise and only edges which can be taken are followed, so constants flow
+//through assignments and phis and branches on constants are folded
+class ConstantPropagation {
+  enum class Level { TOP, CONST, BOTTOM };
+  struct Lattice {
+    Level level = Level::TOP;
+    int value = 0;
+  };
+
+  Function &f_;
+  std::vector<Lattice> values_;
+  std::vector<char> executable_;
+  std::set<std::pair<int, int>> edges_;
+  std::vector<std::pair<int, int>> flowlist_;
+  std::vector<int> ssalist_;
+  int constants_ = 0;
+  int branches_ = 0;
+
+  void lower(int value, Lattice lattice);
+  Lattice evaluate(const Instr &instr) const;
+  void visit(int id);
+  void mark_edge(int from, int to);
+
+  public:
+  ConstantPropagation(Function &function);
+  //propagate constants and rewrite function, uses of constant values become CONST instructions
+  void run();
+  //return true if block can be executed
+  bool executable(int block) const;
+  //count of values replaced by constants
+  int getconstants() const;
+  //count of conditional branches with constant condition
+  int getbranches() const;
+};
+
+}
+
+}
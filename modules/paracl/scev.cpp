@@ -0,0 +1,492 @@
+#include "scev.hpp"
+
+#include <climits>
+#include <algorithm>
+
+namespace ptree {
+
+namespace ssa {
+
+static bool is_comparison(BinOpType op) {
+  return op == BinOpType::LESS || op == BinOpType::LESS_EQUAL || op == BinOpType::MORE ||
+         op == BinOpType::MORE_EQUAL || op == BinOpType::NON_EQUAL;
+}
+
+//comparison with swapped operands
+static BinOpType mirror(BinOpType op) {
+  switch (op) {
+  case BinOpType::LESS:
+    return BinOpType::MORE;
+  case BinOpType::LESS_EQUAL:
+    return BinOpType::MORE_EQUAL;
+  case BinOpType::MORE:
+    return BinOpType::LESS;
+  case BinOpType::MORE_EQUAL:
+    return BinOpType::LESS_EQUAL;
+  default:
+    return op;
+  }
+}
+
+ScalarEvolution::ScalarEvolution(Function &function) : f_(function) {}
+
+//lhs + rhs * factor
+ScalarEvolution::Linear ScalarEvolution::add(const Linear &lhs, const Linear &rhs, unsigned factor) {
+  Linear result = lhs;
+  result.constant += rhs.constant * factor;
+  for (auto &term : rhs.terms)
+    result.terms[term.first] += term.second * factor;
+  for (auto it = result.terms.begin(); it != result.terms.end();)
+    it = it->second == 0 ? result.terms.erase(it) : std::next(it);
+  return result;
+}
+
+//product is linear only if one of operands is constant
+bool ScalarEvolution::multiply(const Linear &lhs, const Linear &rhs, Linear &result) {
+  if (is_constant(lhs))
+    result = add(Linear{}, rhs, lhs.constant);
+  else if (is_constant(rhs))
+    result = add(Linear{}, lhs, rhs.constant);
+  else
+    return false;
+  return true;
+}
+
+bool ScalarEvolution::is_constant(const Linear &linear) { return linear.terms.empty(); }
+
+bool ScalarEvolution::is_zero(const Linear &linear) { return linear.terms.empty() && linear.constant == 0; }
+
+ScalarEvolution::Linear ScalarEvolution::invariant(int value) const {
+  Linear result;
+  if (f_.instrs[value].op == Op::CONST)
+    result.constant = f_.instrs[value].imm;
+  else
+    result.terms[value] = 1;
+  return result;
+}
+
+//evolution of value in terms of iteration number, phi is counted in self
+bool ScalarEvolution::form(int value, int phi, Form &result, std::map<int, Form> &memo) {
+  auto found = memo.find(value);
+  if (found != memo.end()) {
+    result = found->second;
+    return true;
+  }
+  const Instr &instr = f_.instrs[value];
+  result = Form{};
+  if (instr.op == Op::CONST || !inside_[instr.block]) {
+    result.coefs[0] = invariant(value);
+  } else if (value == phi) {
+    result.self = 1;
+  } else if (instr.op == Op::PHI) {
+    auto phiform = known_.find(value);
+    if (phiform == known_.end())
+      return false;
+    result = phiform->second;
+  } else if (instr.op == Op::NEG) {
+    Form operand;
+    if (!form(instr.operands[0], phi, operand, memo))
+      return false;
+    result.self = 0u - operand.self;
+    for (int i = 0; i < 3; ++i)
+      result.coefs[i] = add(Linear{}, operand.coefs[i], 0u - 1u);
+  } else if (instr.op == Op::BINARY) {
+    Form lhs, rhs;
+    if (!form(instr.operands[0], phi, lhs, memo) || !form(instr.operands[1], phi, rhs, memo))
+      return false;
+    switch (instr.binop) {
+    case BinOpType::ADDITION:
+    case BinOpType::SUBTRACTION: {
+      unsigned sign = instr.binop == BinOpType::ADDITION ? 1u : 0u - 1u;
+      result.self = lhs.self + rhs.self * sign;
+      for (int i = 0; i < 3; ++i)
+        result.coefs[i] = add(lhs.coefs[i], rhs.coefs[i], sign);
+      break;
+    }
+    case BinOpType::MULTIPLICATION: {
+      // one operand is the same in all iterations
+      auto scalar = [](const Form &f) { return f.self == 0 && is_zero(f.coefs[1]) && is_zero(f.coefs[2]); };
+      if (!scalar(lhs))
+        std::swap(lhs, rhs);
+      if (!scalar(lhs))
+        return false;
+      if (rhs.self != 0 && !is_constant(lhs.coefs[0]))
+        return false;
+      result.self = rhs.self * lhs.coefs[0].constant;
+      for (int i = 0; i < 3; ++i)
+        if (!multiply(lhs.coefs[0], rhs.coefs[i], result.coefs[i]))
+          return false;
+      break;
+    }
+    default:
+      return false;
+    }
+  } else {
+    return false;
+  }
+  memo[value] = result;
+  return true;
+}
+
+//loop runs while counter compared with invariant bound holds, counter must not wrap around
+bool ScalarEvolution::trip_count(const Region &loop, Trip &trip) {
+  const Instr &branch = f_.terminator(loop.block);
+  if (branch.op != Op::CBR || f_.blocks[loop.block].succs[1] != loop.merge)
+    return false;
+  int cond = branch.operands[0];
+  const Instr &instr = f_.instrs[cond];
+  std::map<int, Form> memo;
+  Form lhs, rhs;
+  if (instr.op == Op::BINARY && is_comparison(instr.binop) && inside_[instr.block]) {
+    trip.op = instr.binop;
+    if (!form(instr.operands[0], -1, lhs, memo) || !form(instr.operands[1], -1, rhs, memo))
+      return false;
+  } else if (!form(cond, -1, lhs, memo)) {
+    return false;
+  }
+  auto invariant = [](const Form &f) { return is_zero(f.coefs[1]) && is_zero(f.coefs[2]); };
+  if (invariant(lhs)) {
+    std::swap(lhs, rhs);
+    trip.op = mirror(trip.op);
+  }
+  if (!invariant(rhs) || !is_zero(lhs.coefs[2]) || !is_constant(lhs.coefs[1]))
+    return false;
+  trip.start = lhs.coefs[0];
+  trip.bound = rhs.coefs[0];
+  int step = lhs.coefs[1].constant;
+  if (step == 0)
+    return false;
+
+  if (is_constant(trip.start) && is_constant(trip.bound)) {
+    long long start = static_cast<int>(trip.start.constant), bound = static_cast<int>(trip.bound.constant);
+    long long count = 0;
+    trip.constant = true;
+    if (!operate(static_cast<int>(start), static_cast<int>(bound), trip.op)) {
+      trip.count = 0;
+      return true;
+    }
+    switch (trip.op) {
+    case BinOpType::LESS:
+      count = step > 0 ? (bound - start + step - 1) / step : -1;
+      break;
+    case BinOpType::LESS_EQUAL:
+      count = step > 0 ? (bound - start) / step + 1 : -1;
+      break;
+    case BinOpType::MORE:
+      count = step < 0 ? (start - bound - step - 1) / -step : -1;
+      break;
+    case BinOpType::MORE_EQUAL:
+      count = step < 0 ? (start - bound) / -step + 1 : -1;
+      break;
+    default:
+      // counter with step 1 reaches any bound, possibly after wrap around
+      if (step == 1 || step == -1) {
+        trip.count = (trip.bound.constant - trip.start.constant) * static_cast<unsigned>(step);
+        return true;
+      }
+      count = (bound - start) % step == 0 ? (bound - start) / step : -1;
+    }
+    long long last = start + step * count;
+    if (count <= 0 || last > INT_MAX || last < INT_MIN)
+      return false;
+    trip.count = count;
+    return true;
+  }
+
+  if (step == 1 && (trip.op == BinOpType::LESS || trip.op == BinOpType::LESS_EQUAL || trip.op == BinOpType::NON_EQUAL)) {
+    trip.sign = 1;
+    trip.endless = INT_MAX;
+  } else if (step == -1 && (trip.op == BinOpType::MORE || trip.op == BinOpType::MORE_EQUAL || trip.op == BinOpType::NON_EQUAL)) {
+    trip.sign = -1;
+    trip.endless = INT_MIN;
+  } else {
+    return false;
+  }
+  // counter <= INT_MAX is always true
+  if (trip.op == BinOpType::LESS_EQUAL || trip.op == BinOpType::MORE_EQUAL) {
+    trip.extra = 1;
+    trip.guard = !is_constant(trip.bound);
+    if (!trip.guard && static_cast<int>(trip.bound.constant) == trip.endless)
+      return false;
+  }
+  return true;
+}
+
+int ScalarEvolution::constant(int value) {
+  Instr instr;
+  instr.op = Op::CONST;
+  instr.imm = value;
+  return f_.insert(0, instr);
+}
+
+int ScalarEvolution::emit(int block, BinOpType operation, int lhs, int rhs) {
+  Instr instr;
+  instr.op = Op::BINARY;
+  instr.binop = operation;
+  instr.operands = {lhs, rhs};
+  return f_.insert(block, instr);
+}
+
+int ScalarEvolution::materialize(const Linear &linear, int block) {
+  int result = -1;
+  for (auto &term : linear.terms) {
+    if (term.second == 1) {
+      result = result < 0 ? term.first : emit(block, BinOpType::ADDITION, result, term.first);
+    } else if (term.second == 0u - 1u && result >= 0) {
+      result = emit(block, BinOpType::SUBTRACTION, result, term.first);
+    } else {
+      int product = emit(block, BinOpType::MULTIPLICATION, term.first, constant(term.second));
+      result = result < 0 ? product : emit(block, BinOpType::ADDITION, result, product);
+    }
+  }
+  if (result < 0)
+    return constant(linear.constant);
+  if (linear.constant != 0)
+    result = emit(block, BinOpType::ADDITION, result, constant(linear.constant));
+  return result;
+}
+
+int ScalarEvolution::newblock() {
+  f_.blocks.emplace_back();
+  return f_.blocks.size() - 1;
+}
+
+//first predecessor of header is the block before loop, the other one is the end of body
+bool ScalarEvolution::collapse(std::vector<Region> &seq, size_t index) {
+  const Region &loop = seq[index];
+  int header = loop.block;
+  int exit = loop.merge;
+  if (index == 0 || seq[index - 1].kind != Region::Kind::Code || f_.blocks[header].preds.size() != 2 ||
+      f_.blocks[exit].preds.size() != 1)
+    return false;
+  int preheader = f_.blocks[header].preds[0];
+  if (seq[index - 1].block != preheader)
+    return false;
+  std::vector<int> blocks{header};
+  for (auto &region : loop.arms[0]) {
+    if (region.kind != Region::Kind::Code)
+      return false;
+    blocks.push_back(region.block);
+  }
+  inside_.assign(f_.blocks.size(), 0);
+  for (int b : blocks)
+    inside_[b] = 1;
+
+  // loop computes values without side effects, only phis of header are used after it
+  std::vector<int> phis;
+  for (int b : blocks) {
+    for (int id : f_.blocks[b].instrs) {
+      const Instr &instr = f_.instrs[id];
+      switch (instr.op) {
+      case Op::PHI:
+        if (b != header)
+          return false;
+        phis.push_back(id);
+        continue;
+      case Op::CONST:
+      case Op::NEG:
+      case Op::NOT:
+      case Op::BR:
+      case Op::CBR:
+        break;
+      case Op::BINARY:
+        if (f_.may_trap(id))
+          return false;
+        break;
+      default:
+        return false;
+      }
+      for (int user : f_.users[id])
+        if (f_.instrs[user].block >= 0 && !inside_[f_.instrs[user].block])
+          return false;
+    }
+  }
+
+  known_.clear();
+  for (bool progress = true; progress;) {
+    progress = false;
+    for (int phi : phis) {
+      if (known_.count(phi))
+        continue;
+      std::map<int, Form> memo;
+      Form next;
+      if (!form(f_.instrs[phi].operands[1], phi, next, memo) || next.self != 1 || !is_zero(next.coefs[2]))
+        continue;
+      Form evolution;
+      evolution.coefs[0] = invariant(f_.instrs[phi].operands[0]);
+      evolution.coefs[1] = next.coefs[0];
+      evolution.coefs[2] = next.coefs[1];
+      known_[phi] = evolution;
+      progress = true;
+    }
+  }
+  std::vector<int> results;
+  bool quadratic = false;
+  for (int phi : phis) {
+    bool used = false;
+    for (int user : f_.users[phi])
+      used |= f_.instrs[user].block >= 0 && !inside_[f_.instrs[user].block];
+    if (!used)
+      continue;
+    if (!known_.count(phi))
+      return false;
+    results.push_back(phi);
+    quadratic |= !is_zero(known_[phi].coefs[2]);
+  }
+  Trip trip;
+  if (!trip_count(loop, trip))
+    return false;
+
+  std::string names;
+  for (int phi : phis) {
+    auto name = f_.names.find(f_.instrs[phi].slot);
+    if (name == f_.names.end())
+      continue;
+    names += (names.empty() ? "" : ", ") + name->second;
+  }
+
+  // preheader checks condition for the first iteration, then arm gets closed forms
+  int thenblk = newblock();
+  int elseblk = newblock();
+  int cond;
+  int bound = -1;
+  if (trip.constant) {
+    cond = constant(trip.count != 0);
+  } else {
+    bound = materialize(trip.bound, preheader);
+    cond = emit(preheader, trip.op, materialize(trip.start, preheader), bound);
+  }
+  Instr &branch = f_.instrs[f_.blocks[preheader].instrs.back()];
+  branch.op = Op::CBR;
+  branch.operands = {cond};
+  Instr jump;
+  jump.op = Op::BR;
+  Region split{Region::Kind::If, preheader, exit, std::vector<std::vector<Region>>(2)};
+  int closed = thenblk;
+  if (trip.guard) {
+    // counter never passes the largest bound, such loop runs forever
+    int guard = newblock();
+    int body = newblock();
+    closed = newblock();
+    Instr test;
+    test.op = Op::CBR;
+    test.operands = {emit(guard, BinOpType::EQUAL, bound, constant(trip.endless))};
+    f_.insert(guard, test);
+    for (int b : {thenblk, body, closed})
+      f_.insert(b, jump);
+    f_.blocks[thenblk].preds = {preheader};
+    f_.blocks[thenblk].succs = {guard};
+    f_.blocks[guard].preds = {thenblk, body};
+    f_.blocks[guard].succs = {body, closed};
+    f_.blocks[body].preds = {guard};
+    f_.blocks[body].succs = {guard};
+    f_.blocks[closed].preds = {guard};
+    Region endless{Region::Kind::While, guard, closed, std::vector<std::vector<Region>>(1)};
+    endless.arms[0].push_back(Region{Region::Kind::Code, body});
+    split.arms[0].push_back(Region{Region::Kind::Code, thenblk});
+    split.arms[0].push_back(std::move(endless));
+  } else {
+    f_.insert(thenblk, jump);
+    f_.blocks[thenblk].preds = {preheader};
+  }
+  split.arms[0].push_back(Region{Region::Kind::Code, closed});
+  split.arms[1].push_back(Region{Region::Kind::Code, elseblk});
+  f_.insert(elseblk, jump);
+  f_.blocks[closed].succs = {exit};
+  f_.blocks[elseblk].preds = {preheader};
+  f_.blocks[elseblk].succs = {exit};
+  f_.blocks[preheader].succs = {thenblk, elseblk};
+  f_.blocks[exit].preds = {closed, elseblk};
+
+  // value after n iterations is a + b * n + c * n * (n - 1) / 2
+  Linear count;
+  Linear triangle;
+  if (trip.constant) {
+    count.constant = trip.count;
+  } else {
+    count = trip.sign > 0 ? add(trip.bound, trip.start, 0u - 1u) : add(trip.start, trip.bound, 0u - 1u);
+    count.constant += trip.extra;
+  }
+  unsigned long long n = trip.count;
+  if (trip.constant) {
+    triangle.constant = n * (n - 1) / 2;
+  } else if (quadratic) {
+    // count can be above INT_MAX, so half of it is logical shift
+    int value = materialize(count, closed);
+    int half = emit(closed, BinOpType::BIT_AND, emit(closed, BinOpType::SHIFT_RIGHT, value, constant(1)),
+                    constant(INT_MAX));
+    int odd = emit(closed, BinOpType::BIT_AND, value, constant(1));
+    int even = emit(closed, BinOpType::ADDITION, emit(closed, BinOpType::SUBTRACTION, value, constant(1)), odd);
+    triangle.terms[emit(closed, BinOpType::MULTIPLICATION, half, even)] = 1;
+  }
+  const Linear *scales[] = {&count, &triangle};
+  std::vector<int> merged;
+  for (int phi : results) {
+    const Form &evolution = known_[phi];
+    Linear value = evolution.coefs[0];
+    for (int i = 1; i < 3; ++i) {
+      Linear linear;
+      if (is_zero(evolution.coefs[i]))
+        continue;
+      if (multiply(evolution.coefs[i], *scales[i - 1], linear))
+        value = add(value, linear, 1);
+      else
+        value.terms[emit(closed, BinOpType::MULTIPLICATION, materialize(evolution.coefs[i], closed),
+                         materialize(*scales[i - 1], closed))] += 1;
+    }
+    Instr instr;
+    instr.op = Op::PHI;
+    instr.operands = {materialize(value, closed), f_.instrs[phi].operands[0]};
+    instr.block = exit;
+    instr.slot = f_.instrs[phi].slot;
+    merged.push_back(f_.instrs.size());
+    f_.instrs.push_back(std::move(instr));
+  }
+  for (size_t i = 0; i < results.size(); ++i)
+    for (int user : f_.users[results[i]])
+      if (f_.instrs[user].block >= 0 && !inside_[f_.instrs[user].block])
+        std::replace(f_.instrs[user].operands.begin(), f_.instrs[user].operands.end(), results[i], merged[i]);
+  std::vector<int> &exitinstrs = f_.blocks[exit].instrs;
+  exitinstrs.insert(exitinstrs.begin(), merged.begin(), merged.end());
+
+  for (int b : blocks) {
+    for (int id : f_.blocks[b].instrs)
+      f_.instrs[id].block = -1;
+    f_.blocks[b].instrs.clear();
+    f_.blocks[b].preds.clear();
+    f_.blocks[b].succs.clear();
+  }
+  seq[index] = std::move(split);
+
+  f_.compute_dominators();
+  f_.compute_uses();
+  collapsed_.push_back(names);
+  return true;
+}
+
+//inner loops are handled first, loop with inner if or loop is not collapsed
+void ScalarEvolution::optimize(std::vector<Region> &seq) {
+  for (size_t i = 0; i < seq.size(); ++i) {
+    if (seq[i].kind == Region::Kind::Code)
+      continue;
+    for (auto &arm : seq[i].arms)
+      optimize(arm);
+    if (seq[i].kind == Region::Kind::While) {
+      ++loops_;
+      collapse(seq, i);
+    }
+  }
+}
+
+void ScalarEvolution::run() {
+  f_.compute_uses();
+  optimize(f_.body);
+}
+
+int ScalarEvolution::getloops() const { return loops_; }
+
+const std::vector<std::string> &ScalarEvolution::getcollapsed() const { return collapsed_; }
+
+}
+
+}
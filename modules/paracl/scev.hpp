@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ptree {
+
+namespace ssa {
+
+//scalar evolution of while loops: value in iteration k is a + b * k + c * k * (k - 1) / 2,
+//so counters are affine and sums of counters are quadratic; loop without side effects with
+//trip count known from condition on a counter becomes if with closed forms of its variables
+class ScalarEvolution {
+  //sum of loop invariant values with factors and constant, arithmetic wraps around
+  struct Linear {
+    unsigned constant = 0;
+    std::map<int, unsigned> terms;
+  };
+  //self - factor of the phi which is being analyzed, coefs - a, b, c
+  struct Form {
+    unsigned self = 0;
+    Linear coefs[3];
+  };
+  //trip count: constant or (bound - start) * sign + extra, loop is endless if bound == endless
+  struct Trip {
+    BinOpType op = BinOpType::NON_EQUAL;
+    Linear start;
+    Linear bound;
+    bool constant = false;
+    unsigned count = 0;
+    int sign = 1;
+    unsigned extra = 0;
+    bool guard = false;
+    int endless = 0;
+  };
+
+  Function &f_;
+  std::vector<char> inside_;
+  std::map<int, Form> known_;
+  int loops_ = 0;
+  std::vector<std::string> collapsed_;
+
+  static Linear add(const Linear &lhs, const Linear &rhs, unsigned factor);
+  static bool multiply(const Linear &lhs, const Linear &rhs, Linear &result);
+  static bool is_constant(const Linear &linear);
+  static bool is_zero(const Linear &linear);
+  Linear invariant(int value) const;
+  bool form(int value, int phi, Form &result, std::map<int, Form> &memo);
+  bool trip_count(const Region &loop, Trip &trip);
+  int constant(int value);
+  int emit(int block, BinOpType operation, int lhs, int rhs);
+  int materialize(const Linear &linear, int block);
+  int newblock();
+  bool collapse(std::vector<Region> &seq, size_t index);
+  void optimize(std::vector<Region> &seq);
+
+  public:
+  ScalarEvolution(Function &function);
+  void run();
+  //count of analyzed loops
+  int getloops() const;
+  //variables of collapsed loops, one string per loop
+  const std::vector<std::string> &getcollapsed() const;
+};
+
+}
+
+}
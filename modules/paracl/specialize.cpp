@@ -0,0 +1,432 @@
+#include "specialize.hpp"
+#include "fold.hpp"
+#include "stack.hpp"
+
+#include <stdexcept>
+#include <limits>
+#include <iostream>
+#include <sstream>
+
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace ptree {
+
+unsigned Specializer::limit = 10;
+
+static std::string literal(int value) {
+  // 2147483648 is not a valid literal
+  if (value == std::numeric_limits<int>::min())
+    return "(-2147483647 - 1)";
+  return value < 0 ? "(" + std::to_string(value) + ")" : std::to_string(value);
+}
+
+//drop parentheses around whole expression
+static std::string bare(const std::string &expr) {
+  if (expr.size() < 2 || expr.front() != '(' || expr.back() != ')')
+    return expr;
+  int depth = 0;
+  for (size_t i = 0; i + 1 < expr.size(); ++i) {
+    depth += expr[i] == '(' ? 1 : expr[i] == ')' ? -1 : 0;
+    if (depth == 0)
+      return expr;
+  }
+  return expr.substr(1, expr.size() - 2);
+}
+
+Specializer::Specializer(std::vector<int> inputs) : inputs_(std::move(inputs)) {}
+
+PTree *Specializer::bind_expr(PTree *unit) {
+  if (unit == nullptr)
+    return nullptr;
+  if (auto reserved = dynamic_cast<Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input || bound_ == inputs_.size())
+      return unit;
+    PTree *value = new Imidiate<int>(reserved->getparent(), inputs_[bound_++]);
+    delete reserved;
+    return value;
+  }
+  if (auto assign = dynamic_cast<Assign *>(unit)) {
+    assign->setright(bind_expr(assign->getright()));
+    return unit;
+  }
+  // operands are evaluated from left to right
+  unit->setleft(bind_expr(unit->getleft()));
+  unit->setright(bind_expr(unit->getright()));
+  return unit;
+}
+
+bool Specializer::bind_stmt(PTree *unit) {
+  if (unit == nullptr)
+    return true;
+  if (auto block = dynamic_cast<Block *>(unit)) {
+    for (auto expr : block->operations)
+      if (!bind_stmt(expr))
+        return false;
+    return true;
+  }
+  // condition of if is read once, loop condition and arms may read any count of inputs
+  if (auto ifblock = dynamic_cast<IfBlk *>(unit)) {
+    bind_expr(ifblock->condition_);
+    return !reads_input(ifblock->getleft()) && !reads_input(ifblock->getright());
+  }
+  if (auto whileblock = dynamic_cast<WhileBlk *>(unit))
+    return !reads_input(whileblock->condition_) && !reads_input(whileblock->getleft());
+  bind_expr(unit);
+  return true;
+}
+
+void Specializer::bind(PTree *root) { bind_stmt(root); }
+
+size_t Specializer::getbound() const { return bound_; }
+
+std::string Specializer::residual(const PTree *root, int stacksize) const {
+  std::string res = "// specialized on " + std::to_string(bound_) + " of " +
+                    std::to_string(inputs_.size()) + " inputs";
+  std::string output;
+  if (!reads_input(root) && precompute(root, stacksize, limit, output)) {
+    res += ", output is precomputed\n";
+    std::istringstream lines(output);
+    int value;
+    bool empty = true;
+    while (lines >> value) {
+      res += "print " + bare(literal(value)) + ";\n";
+      empty = false;
+    }
+    return empty ? res + "{}\n" : res;
+  }
+  res += "\n";
+  PclEmitter emitter;
+  return res + emitter.emit(root);
+}
+
+bool reads_input(const PTree *unit) {
+  if (unit == nullptr)
+    return false;
+  if (auto reserved = dynamic_cast<const Reserved *>(unit))
+    return reserved->gettype() == Reserved::Types::Input;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      if (reads_input(expr))
+        return true;
+    return false;
+  }
+  if (auto branch = dynamic_cast<const Branch *>(unit))
+    if (reads_input(branch->condition_))
+      return true;
+  return reads_input(unit->getleft()) || reads_input(unit->getright());
+}
+
+bool precompute(const PTree *root, int stacksize, unsigned seconds, std::string &output) {
+  const size_t maxoutput = 1 << 20;
+  int fds[2];
+  if (pipe(fds) != 0)
+    return false;
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    // child prints to pipe and is killed by SIGALRM, SIGFPE or SIGPIPE on failure
+    close(fds[0]);
+    dup2(fds[1], STDOUT_FILENO);
+    close(fds[1]);
+    alarm(seconds);
+    Stack stack(stacksize);
+    root->execute(&stack);
+    std::cout.flush();
+    _exit(0);
+  }
+  close(fds[1]);
+  output.clear();
+  char buffer[4096];
+  ssize_t count;
+  while ((count = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, count);
+    if (output.size() > maxoutput) {
+      kill(pid, SIGKILL);
+      break;
+    }
+  }
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 && output.size() <= maxoutput;
+}
+
+static std::string pcl_op(BinOpType operation) {
+  switch (operation) {
+  case BinOpType::ADDITION:
+    return "+";
+  case BinOpType::SUBTRACTION:
+    return "-";
+  case BinOpType::MULTIPLICATION:
+    return "*";
+  case BinOpType::DIVISION:
+    return "/";
+  case BinOpType::REMAINDER:
+    return "%";
+  case BinOpType::EQUAL:
+    return "==";
+  case BinOpType::MORE_EQUAL:
+    return ">=";
+  case BinOpType::LESS_EQUAL:
+    return "<=";
+  case BinOpType::NON_EQUAL:
+    return "!=";
+  case BinOpType::MORE:
+    return ">";
+  case BinOpType::LESS:
+    return "<";
+  case BinOpType::LOG_AND:
+    return "&&";
+  case BinOpType::LOG_OR:
+    return "||";
+  default:
+    throw std::logic_error{"Undefined binary operation in ParaCL emitter"};
+  }
+}
+
+void PclEmitter::collect(const PTree *unit, std::map<int, std::set<std::string>> &names) {
+  if (unit == nullptr)
+    return;
+  if (auto block = dynamic_cast<const Block *>(unit))
+    for (auto expr : block->operations)
+      collect(expr, names);
+  if (auto branch = dynamic_cast<const Branch *>(unit))
+    collect(branch->condition_, names);
+  if (auto assign = dynamic_cast<const Assign *>(unit))
+    collect(assign->lval, names);
+  if (auto nameint = dynamic_cast<const NameInt *>(unit)) {
+    if (nameint->getoffset() < 0)
+      throw std::logic_error{"Usage of undeclared variable " + nameint->getvarname()};
+    names[nameint->getoffset()].insert(nameint->getvarname());
+  }
+  collect(unit->getleft(), names);
+  collect(unit->getright(), names);
+}
+
+std::string PclEmitter::var(const NameInt *var, bool assigned) {
+  int offset = var->getoffset();
+  // variable is declared by its first assignment in the scope of program
+  if (declared_.insert(offset).second && (level_ > 0 || !assigned))
+    hoisted_.push_back(offset);
+  return names_.at(offset);
+}
+
+std::string PclEmitter::indent(int level) const { return std::string(2 * level, ' '); }
+
+std::string PclEmitter::emit_special(const BinOp *binop) {
+  const PTree *lhs = binop->getleft();
+  const PTree *rhs = binop->getright();
+  if (binop->operation_ == BinOpType::BIT_AND && dynamic_cast<const Imidiate<int> *>(lhs))
+    std::swap(lhs, rhs);
+  std::string value = emit_expr(lhs);
+  // d & -c with c equal to 0 or 1 is d * c
+  auto negation = dynamic_cast<const UnOp *>(rhs);
+  if (binop->operation_ == BinOpType::BIT_AND && negation != nullptr &&
+      negation->operation_ == UnOpType::MINUS && is_bool(negation->getleft()))
+    return "(" + value + " * " + emit_expr(negation->getleft()) + ")";
+
+  auto constant = dynamic_cast<const Imidiate<int> *>(rhs);
+  if (constant == nullptr || binop->operation_ == BinOpType::MUL_HIGH)
+    throw std::logic_error{"Operation " + binop->get_op() + " has no syntax in ParaCL"};
+  int arg = constant->getvalue();
+  // operand is written several times, so it should not have side effects
+  bool pure = is_pure(lhs);
+  switch (binop->operation_) {
+  case BinOpType::SHIFT_LEFT:
+    if (arg < 0 || arg > 31)
+      break;
+    return "(" + value + " * " + literal(shift_left(1, arg)) + ")";
+  case BinOpType::SHIFT_RIGHT: {
+    if (arg < 0 || arg > 31 || !pure)
+      break;
+    if (arg == 0)
+      return value;
+    if (arg == 31)
+      return "(0 - (" + value + " < 0))";
+    // division rounds to zero and shift rounds down
+    std::string power = literal(1 << arg);
+    return "((" + value + " / " + power + ") - ((" + value + " % " + power + ") < 0))";
+  }
+  case BinOpType::BIT_AND: {
+    if (arg == -1)
+      return value;
+    if (arg == 0)
+      return "(" + value + " * 0)";
+    // mask of low bits, arg + 1 is a power of two (unsigned, INT_MAX + 1 does not overflow)
+    if (!pure || arg < 0 || (static_cast<unsigned>(arg) & (static_cast<unsigned>(arg) + 1u)) != 0)
+      break;
+    if (arg == std::numeric_limits<int>::max())
+      return "(" + value + " - (" + value + " < 0) * " + literal(std::numeric_limits<int>::min()) + ")";
+    std::string power = literal(arg + 1);
+    std::string rem = "(" + value + " % " + power + ")";
+    return "(" + rem + " + (" + rem + " < 0) * " + power + ")";
+  }
+  default:
+    break;
+  }
+  throw std::logic_error{"Operation " + binop->get_op() + " has no syntax in ParaCL"};
+}
+
+std::string PclEmitter::emit_expr(const PTree *unit) {
+  if (unit == nullptr)
+    throw std::logic_error{"Missing operand in ParaCL emitter"};
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit))
+    return literal(imidiate->getvalue());
+  if (auto nameint = dynamic_cast<const NameInt *>(unit))
+    return var(nameint, false);
+  if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw std::logic_error{"Reserved word has no value"};
+    return "?";
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    switch (binop->operation_) {
+    case BinOpType::SHIFT_LEFT:
+    case BinOpType::SHIFT_RIGHT:
+    case BinOpType::BIT_AND:
+    case BinOpType::MUL_HIGH:
+      return emit_special(binop);
+    default:
+      break;
+    }
+    std::string lhs = emit_expr(binop->getleft());
+    std::string rhs = emit_expr(binop->getright());
+    return "(" + lhs + " " + pcl_op(binop->operation_) + " " + rhs + ")";
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    switch (unop->operation_) {
+    case UnOpType::POST_ADDITION:
+    case UnOpType::POST_SUBTRACTION: {
+      auto nameint = dynamic_cast<const NameInt *>(unop->getleft());
+      if (nameint == nullptr)
+        throw std::logic_error{"Increment of not a variable"};
+      return var(nameint, false) + (unop->operation_ == UnOpType::POST_ADDITION ? "++" : "--");
+    }
+    // grammar has unary minus only for variables and numbers
+    case UnOpType::MINUS:
+      if (auto nameint = dynamic_cast<const NameInt *>(unop->getleft()))
+        return "(-" + var(nameint, false) + ")";
+      return "(0 - " + emit_expr(unop->getleft()) + ")";
+    case UnOpType::NOT:
+      return "!" + emit_expr(unop->getleft());
+    default:
+      throw std::logic_error{"Undefined unary operation in ParaCL emitter"};
+    }
+  }
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    std::string lval = var(assign->lval, true);
+    return "(" + lval + " = " + emit_expr(assign->getright()) + ")";
+  }
+  if (auto output = dynamic_cast<const Output *>(unit))
+    return "(print " + emit_expr(output->getright()) + ")";
+  if (auto condition = dynamic_cast<const Condition *>(unit))
+    return emit_expr(condition->getleft());
+  if (auto expression = dynamic_cast<const Expression *>(unit))
+    return emit_expr(expression->getright());
+  throw std::logic_error{"Node can not be translated to ParaCL"};
+}
+
+void PclEmitter::emit_body(const PTree *unit, int level) {
+  body_ += "{\n";
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      emit_stmt(expr, level + 1);
+  } else {
+    emit_stmt(unit, level + 1);
+  }
+  body_ += indent(level) + "}";
+}
+
+void PclEmitter::emit_stmt(const PTree *unit, int level) {
+  if (unit == nullptr)
+    return;
+  level_ = level;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    body_ += indent(level);
+    emit_body(block, level);
+    body_ += "\n";
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    body_ += indent(level) + "if (" + bare(emit_expr(ifblock->condition_)) + ") ";
+    emit_body(ifblock->getright(), level);
+    if (ifblock->getleft() != nullptr) {
+      body_ += " else ";
+      emit_body(ifblock->getleft(), level);
+    }
+    body_ += "\n";
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw std::logic_error{"No condition in while cycle"};
+    body_ += indent(level) + "while (" + bare(emit_expr(whileblock->condition_)) + ") ";
+    emit_body(whileblock->getleft(), level);
+    body_ += "\n";
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    emit_stmt(expression->getright(), level);
+    return;
+  }
+  // assignation and print at statement level are written without parentheses
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    std::string lval = var(assign->lval, true);
+    body_ += indent(level) + lval + " = " + bare(emit_expr(assign->getright())) + ";\n";
+    return;
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    body_ += indent(level) + "print " + bare(emit_expr(output->getright())) + ";\n";
+    return;
+  }
+  body_ += indent(level) + bare(emit_expr(unit)) + ";\n";
+}
+
+std::string PclEmitter::emit(const PTree *root) {
+  body_.clear();
+  names_.clear();
+  declared_.clear();
+  hoisted_.clear();
+
+  // variable keeps its name if no other slot has the same one
+  std::map<int, std::set<std::string>> names;
+  collect(root, names);
+  std::map<std::string, int> users;
+  for (auto &slot : names)
+    for (auto &name : slot.second)
+      ++users[name];
+  std::set<std::string> taken;
+  for (auto &slot : names) {
+    std::string name = *slot.second.begin();
+    if (slot.second.size() > 1 || users[name] > 1)
+      name += "_" + std::to_string(slot.first / sizeof(int));
+    while (!taken.insert(name).second)
+      name += "_";
+    names_[slot.first] = name;
+  }
+
+  if (auto block = dynamic_cast<const Block *>(root)) {
+    for (auto expr : block->operations)
+      emit_stmt(expr, 0);
+  } else {
+    emit_stmt(root, 0);
+  }
+  if (body_.empty())
+    body_ = "{}\n";
+
+  std::string res;
+  for (int offset : hoisted_)
+    res += names_.at(offset) + " = 0;\n";
+  return res + body_;
+}
+
+}
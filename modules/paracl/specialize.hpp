@@ -0,0 +1,70 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+specialization structure:
+1) Specializer - replaces leading inputs (?) of program by known values, then passes propagate
+   them as constants, and returns residual program
+2) precompute - runs program without inputs at build time in child process and collects its output
+3) PclEmitter - translates tree (after manage_tree_mem) back to ParaCL source
+*/
+
+namespace ptree {
+
+class Specializer {
+  std::vector<int> inputs_;
+  size_t bound_ = 0;
+
+  //replace inputs of expression in order of evaluation, return new node
+  PTree *bind_expr(PTree *unit);
+  //return false when order of following inputs depends on run (loop or arm of if)
+  bool bind_stmt(PTree *unit);
+  public:
+  //time limit of build time run in seconds
+  static unsigned limit;
+
+  Specializer(std::vector<int> inputs);
+  //replace inputs which are read before the first loop or arm of if by known values,
+  //so values are bound exactly in the order program reads them
+  void bind(PTree *root);
+  //count of replaced inputs
+  size_t getbound() const;
+  //return residual program for tree after passes, program without inputs is run
+  //at build time and residual program only prints its output
+  std::string residual(const PTree *root, int stacksize) const;
+};
+
+//return true if program reads input
+bool reads_input(const PTree *unit);
+//run program on tree engine in child process, return false if it traps, reads input,
+//runs longer than seconds or prints more than 1 MB
+bool precompute(const PTree *root, int stacksize, unsigned seconds, std::string &output);
+
+class PclEmitter {
+  std::string body_;
+  std::map<int, std::string> names_;
+  std::set<int> declared_;
+  std::vector<int> hoisted_;
+  int level_ = 0;
+
+  void collect(const PTree *unit, std::map<int, std::set<std::string>> &names);
+  std::string var(const NameInt *var, bool assigned);
+  std::string indent(int level) const;
+  std::string emit_expr(const PTree *unit);
+  //operations produced by passes which have no syntax are written with arithmetic
+  std::string emit_special(const BinOp *binop);
+  void emit_body(const PTree *unit, int level);
+  void emit_stmt(const PTree *unit, int level);
+public:
+  //return ParaCL source, variables which are first assigned in inner scope
+  //are declared at the top, so they keep their values after the scope
+  std::string emit(const PTree *root);
+};
+
+}
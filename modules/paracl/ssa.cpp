@@ -0,0 +1,1083 @@
+#include "ssa.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+
+namespace ptree {
+
+namespace ssa {
+
+std::string op_name(Op op) {
+  switch (op) {
+  case Op::CONST:
+    return "const";
+  case Op::ENTRY:
+    return "entry";
+  case Op::PHI:
+    return "phi";
+  case Op::BINARY:
+    return "binary";
+  case Op::NEG:
+    return "neg";
+  case Op::NOT:
+    return "not";
+  case Op::INPUT:
+    return "input";
+  case Op::PRINT:
+    return "print";
+  case Op::LOAD:
+    return "load";
+  case Op::STORE:
+    return "store";
+  case Op::BR:
+    return "br";
+  case Op::CBR:
+    return "cbr";
+  case Op::RET:
+    return "ret";
+  }
+  return "unknown";
+}
+
+std::string binop_name(BinOpType operation) {
+  switch (operation) {
+  case BinOpType::ADDITION:
+    return "add";
+  case BinOpType::SUBTRACTION:
+    return "sub";
+  case BinOpType::MULTIPLICATION:
+    return "mul";
+  case BinOpType::DIVISION:
+    return "div";
+  case BinOpType::REMAINDER:
+    return "rem";
+  case BinOpType::EQUAL:
+    return "eq";
+  case BinOpType::MORE_EQUAL:
+    return "ge";
+  case BinOpType::LESS_EQUAL:
+    return "le";
+  case BinOpType::NON_EQUAL:
+    return "ne";
+  case BinOpType::MORE:
+    return "gt";
+  case BinOpType::LESS:
+    return "lt";
+  case BinOpType::LOG_AND:
+    return "and";
+  case BinOpType::LOG_OR:
+    return "or";
+  case BinOpType::SHIFT_LEFT:
+    return "shl";
+  case BinOpType::SHIFT_RIGHT:
+    return "sar";
+  case BinOpType::BIT_AND:
+    return "band";
+  case BinOpType::MUL_HIGH:
+    return "mulhi";
+  default:
+    return "undef";
+  }
+}
+
+static bool is_terminator(Op op) { return op == Op::BR || op == Op::CBR || op == Op::RET; }
+
+std::vector<int> Function::reverse_postorder() const {
+  std::vector<int> order;
+  std::vector<char> visited(blocks.size(), 0);
+  std::vector<std::pair<int, size_t>> path{{0, 0}};
+  visited[0] = 1;
+  while (!path.empty()) {
+    int block = path.back().first;
+    if (path.back().second < blocks[block].succs.size()) {
+      int next = blocks[block].succs[path.back().second++];
+      if (!visited[next]) {
+        visited[next] = 1;
+        path.push_back({next, 0});
+      }
+      continue;
+    }
+    order.push_back(block);
+    path.pop_back();
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+//iterative algorithm of Cooper, Harvey and Kennedy
+void Function::compute_dominators() {
+  std::vector<int> order = reverse_postorder();
+  std::vector<int> number(blocks.size(), -1);
+  for (size_t i = 0; i < order.size(); ++i)
+    number[order[i]] = i;
+  std::vector<int> idom(blocks.size(), -1);
+  idom[0] = 0;
+  auto intersect = [&](int a, int b) {
+    while (a != b) {
+      while (number[a] > number[b])
+        a = idom[a];
+      while (number[b] > number[a])
+        b = idom[b];
+    }
+    return a;
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < order.size(); ++i) {
+      int block = order[i];
+      int dom = -1;
+      for (int pred : blocks[block].preds) {
+        if (idom[pred] < 0)
+          continue;
+        dom = dom < 0 ? pred : intersect(pred, dom);
+      }
+      if (dom != idom[block]) {
+        idom[block] = dom;
+        changed = true;
+      }
+    }
+  }
+  for (auto &block : blocks) {
+    block.idom = -1;
+    block.children.clear();
+  }
+  for (size_t i = 1; i < order.size(); ++i) {
+    blocks[order[i]].idom = idom[order[i]];
+    blocks[idom[order[i]]].children.push_back(order[i]);
+  }
+}
+
+bool Function::dominates(int a, int b) const {
+  while (b >= 0 && b != a)
+    b = blocks[b].idom;
+  return b == a;
+}
+
+void Function::compute_uses() {
+  users.assign(instrs.size(), std::vector<int>{});
+  for (auto &block : blocks)
+    for (int id : block.instrs)
+      for (int operand : instrs[id].operands)
+        users[operand].push_back(id);
+}
+
+int Function::insert(int block, Instr instr) {
+  instr.block = block;
+  int id = instrs.size();
+  instrs.push_back(std::move(instr));
+  std::vector<int> &list = blocks[block].instrs;
+  if (!list.empty() && is_terminator(instrs[list.back()].op))
+    list.insert(list.end() - 1, id);
+  else
+    list.push_back(id);
+  if (!users.empty()) {
+    users.resize(instrs.size());
+    for (int operand : instrs[id].operands)
+      users[operand].push_back(id);
+  }
+  return id;
+}
+
+int Function::insert_before(int position, Instr instr) {
+  instr.block = instrs[position].block;
+  int id = instrs.size();
+  instrs.push_back(std::move(instr));
+  std::vector<int> &list = blocks[instrs[id].block].instrs;
+  list.insert(std::find(list.begin(), list.end(), position), id);
+  if (!users.empty()) {
+    users.resize(instrs.size());
+    for (int operand : instrs[id].operands)
+      users[operand].push_back(id);
+  }
+  return id;
+}
+
+void Function::move(int value, int block) {
+  std::vector<int> &list = blocks[instrs[value].block].instrs;
+  list.erase(std::find(list.begin(), list.end(), value));
+  std::vector<int> &target = blocks[block].instrs;
+  if (!target.empty() && is_terminator(instrs[target.back()].op))
+    target.insert(target.end() - 1, value);
+  else
+    target.push_back(value);
+  instrs[value].block = block;
+}
+
+void Function::replace_uses(int value, int other) {
+  if (value == other)
+    return;
+  std::vector<int> old = std::move(users[value]);
+  users[value].clear();
+  for (int user : old)
+    for (auto &operand : instrs[user].operands)
+      if (operand == value) {
+        operand = other;
+        users[other].push_back(user);
+      }
+}
+
+void Function::erase(int value) {
+  Instr &instr = instrs[value];
+  if (instr.block < 0)
+    return;
+  std::vector<int> &list = blocks[instr.block].instrs;
+  list.erase(std::find(list.begin(), list.end(), value));
+  instr.block = -1;
+  if (!users.empty())
+    for (int operand : instr.operands) {
+      std::vector<int> &list = users[operand];
+      auto user = std::find(list.begin(), list.end(), value);
+      if (user != list.end())
+        list.erase(user);
+    }
+}
+
+const Instr &Function::terminator(int block) const { return instrs[blocks[block].instrs.back()]; }
+
+bool Function::may_trap(int value, bool moved) const {
+  const Instr &instr = instrs[value];
+  if (instr.op != Op::BINARY || (instr.safe && !moved))
+    return false;
+  if (instr.binop != BinOpType::DIVISION && instr.binop != BinOpType::REMAINDER)
+    return false;
+  const Instr &divisor = instrs[instr.operands[1]];
+  return divisor.op != Op::CONST || divisor.imm == 0 || divisor.imm == -1;
+}
+
+std::string Function::dump() const {
+  auto value = [](int id) { return "%" + std::to_string(id); };
+  auto label = [](int block) { return "b" + std::to_string(block); };
+  auto slotname = [this](int slot) {
+    auto name = names.find(slot);
+    return name != names.end() ? name->second : "@" + std::to_string(slot);
+  };
+  std::string res;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const BasicBlock &block = blocks[b];
+    res += label(b) + ":";
+    if (!block.preds.empty()) {
+      res += " ; preds";
+      for (int pred : block.preds)
+        res += " " + label(pred);
+    }
+    if (block.idom >= 0)
+      res += ", idom " + label(block.idom);
+    res += "\n";
+    for (int id : block.instrs) {
+      const Instr &instr = instrs[id];
+      std::string line = "  ";
+      if (!is_terminator(instr.op) && instr.op != Op::PRINT && instr.op != Op::STORE)
+        line += value(id) + " = ";
+      switch (instr.op) {
+      case Op::CONST:
+        line += "const " + std::to_string(instr.imm);
+        break;
+      case Op::ENTRY:
+      case Op::LOAD:
+      case Op::STORE:
+        line += op_name(instr.op) + " " + slotname(instr.imm);
+        if (instr.op == Op::STORE)
+          line += ", " + value(instr.operands[0]);
+        break;
+      case Op::PHI:
+        line += "phi";
+        for (size_t i = 0; i < instr.operands.size(); ++i)
+          line += std::string(i ? "," : "") + " [" + value(instr.operands[i]) + ", " +
+                  label(block.preds[i]) + "]";
+        break;
+      case Op::BINARY:
+        line += binop_name(instr.binop) + " " + value(instr.operands[0]) + ", " + value(instr.operands[1]);
+        break;
+      case Op::BR:
+        line += "br " + label(block.succs[0]);
+        break;
+      case Op::CBR:
+        line += "cbr " + value(instr.operands[0]) + ", " + label(block.succs[0]) + ", " + label(block.succs[1]);
+        break;
+      default:
+        line += op_name(instr.op);
+        for (size_t i = 0; i < instr.operands.size(); ++i)
+          line += (i ? ", " : " ") + value(instr.operands[i]);
+      }
+      if (instr.slot >= 0 && instr.op != Op::ENTRY)
+        line += " ; " + slotname(instr.slot);
+      res += line + "\n";
+    }
+  }
+  return res;
+}
+
+//lowers statements to blocks with LOAD/STORE of variable slots and promotes slots to SSA values
+class Builder {
+  Function &function_;
+  int current_ = 0;
+
+  int newblock() {
+    function_.blocks.emplace_back();
+    return function_.blocks.size() - 1;
+  }
+  int emit(Op op, std::vector<int> operands = {}, int imm = 0, BinOpType binop = BinOpType::UNDEF) {
+    Instr instr;
+    instr.op = op;
+    instr.binop = binop;
+    instr.imm = imm;
+    instr.operands = std::move(operands);
+    instr.block = current_;
+    function_.instrs.push_back(std::move(instr));
+    int id = function_.instrs.size() - 1;
+    function_.blocks[current_].instrs.push_back(id);
+    return id;
+  }
+  void edge(int from, int to) {
+    function_.blocks[from].succs.push_back(to);
+    function_.blocks[to].preds.push_back(from);
+  }
+  void jump(int target) {
+    emit(Op::BR);
+    edge(current_, target);
+  }
+  int variable(const NameInt *name) {
+    int offset = name->getoffset();
+    if (offset < 0)
+      throw std::logic_error{"Undeclared variable " + name->getvarname() + " in SSA builder"};
+    function_.names.emplace(offset, name->getvarname());
+    function_.varsize = std::max(function_.varsize, offset + static_cast<int>(sizeof(int)));
+    return offset;
+  }
+
+  void lower_stmt(const PTree *unit, std::vector<Region> &seq);
+  int lower_expr(const PTree *unit);
+  void promote();
+  void cleanup();
+
+  public:
+  Builder(Function &function) : function_(function) {}
+  void build(const PTree *root);
+};
+
+void Builder::build(const PTree *root) {
+  current_ = newblock();
+  function_.body.push_back(Region{Region::Kind::Code, current_});
+  lower_stmt(root, function_.body);
+  emit(Op::RET);
+  promote();
+  cleanup();
+}
+
+void Builder::lower_stmt(const PTree *unit, std::vector<Region> &seq) {
+  if (unit == nullptr)
+    return;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      lower_stmt(expr, seq);
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    int cond = lower_expr(ifblock->condition_);
+    int head = current_;
+    int thenblk = newblock();
+    int elseblk = newblock();
+    int merge = newblock();
+    emit(Op::CBR, {cond});
+    edge(head, thenblk);
+    edge(head, elseblk);
+    Region region{Region::Kind::If, head, merge, std::vector<std::vector<Region>>(2)};
+    current_ = thenblk;
+    region.arms[0].push_back(Region{Region::Kind::Code, thenblk});
+    lower_stmt(ifblock->getright(), region.arms[0]);
+    jump(merge);
+    current_ = elseblk;
+    region.arms[1].push_back(Region{Region::Kind::Code, elseblk});
+    lower_stmt(ifblock->getleft(), region.arms[1]);
+    jump(merge);
+    seq.push_back(std::move(region));
+    current_ = merge;
+    seq.push_back(Region{Region::Kind::Code, merge});
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    if (whileblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in while block"};
+    int header = newblock();
+    jump(header);
+    current_ = header;
+    int cond = lower_expr(whileblock->condition_);
+    int bodyblk = newblock();
+    int exit = newblock();
+    emit(Op::CBR, {cond});
+    edge(header, bodyblk);
+    edge(header, exit);
+    Region region{Region::Kind::While, header, exit, std::vector<std::vector<Region>>(1)};
+    current_ = bodyblk;
+    region.arms[0].push_back(Region{Region::Kind::Code, bodyblk});
+    lower_stmt(whileblock->getleft(), region.arms[0]);
+    jump(header);
+    seq.push_back(std::move(region));
+    current_ = exit;
+    seq.push_back(Region{Region::Kind::Code, exit});
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    lower_stmt(expression->getright(), seq);
+    return;
+  }
+  lower_expr(unit);
+}
+
+int Builder::lower_expr(const PTree *unit) {
+  if (unit == nullptr)
+    throw std::logic_error{"Missing operand in SSA builder"};
+  if (auto imidiate = dynamic_cast<const Imidiate<int> *>(unit))
+    return emit(Op::CONST, {}, imidiate->getvalue());
+  if (auto nameint = dynamic_cast<const NameInt *>(unit))
+    return emit(Op::LOAD, {}, variable(nameint));
+  if (auto reserved = dynamic_cast<const Reserved *>(unit)) {
+    if (reserved->gettype() != Reserved::Types::Input)
+      throw std::logic_error{"Unsupported reserved word in SSA builder"};
+    return emit(Op::INPUT);
+  }
+  if (auto binop = dynamic_cast<const BinOp *>(unit)) {
+    int lhs = lower_expr(binop->getleft());
+    int rhs = lower_expr(binop->getright());
+    int result = emit(Op::BINARY, {lhs, rhs}, 0, binop->operation_);
+    function_.instrs[result].safe = binop->safe_;
+    return result;
+  }
+  if (auto unop = dynamic_cast<const UnOp *>(unit)) {
+    switch (unop->operation_) {
+    case UnOpType::POST_ADDITION:
+    case UnOpType::POST_SUBTRACTION: {
+      auto nameint = dynamic_cast<const NameInt *>(unop->getleft());
+      if (nameint == nullptr)
+        throw std::logic_error{"Increment of non variable in SSA builder"};
+      int slot = variable(nameint);
+      int value = emit(Op::LOAD, {}, slot);
+      int one = emit(Op::CONST, {}, 1);
+      BinOpType operation =
+          unop->operation_ == UnOpType::POST_ADDITION ? BinOpType::ADDITION : BinOpType::SUBTRACTION;
+      int result = emit(Op::BINARY, {value, one}, 0, operation);
+      emit(Op::STORE, {result}, slot);
+      return result;
+    }
+    case UnOpType::MINUS:
+      return emit(Op::NEG, {lower_expr(unop->getleft())});
+    case UnOpType::NOT:
+      return emit(Op::NOT, {lower_expr(unop->getleft())});
+    default:
+      throw std::logic_error{"Undefined unary operation in SSA builder"};
+    }
+  }
+  if (auto assign = dynamic_cast<const Assign *>(unit)) {
+    int value = lower_expr(assign->getright());
+    emit(Op::STORE, {value}, variable(assign->lval));
+    return value;
+  }
+  if (auto output = dynamic_cast<const Output *>(unit)) {
+    int value = lower_expr(output->getright());
+    emit(Op::PRINT, {value});
+    return value;
+  }
+  if (auto condition = dynamic_cast<const Condition *>(unit))
+    return lower_expr(condition->getleft());
+  if (auto expression = dynamic_cast<const Expression *>(unit))
+    return lower_expr(expression->getright());
+  throw std::logic_error{"Unsupported node in SSA builder"};
+}
+
+//phis are placed on iterated dominance frontiers of stores, then loads are renamed
+//during preorder walk of dominator tree
+void Builder::promote() {
+  Function &f = function_;
+  f.compute_dominators();
+  size_t nblocks = f.blocks.size();
+
+  std::vector<std::set<int>> frontier(nblocks);
+  for (size_t b = 0; b < nblocks; ++b) {
+    if (f.blocks[b].preds.size() < 2)
+      continue;
+    for (int pred : f.blocks[b].preds)
+      for (int runner = pred; runner != f.blocks[b].idom; runner = f.blocks[runner].idom)
+        frontier[runner].insert(b);
+  }
+
+  std::map<int, std::set<int>> defs;
+  std::set<int> slots;
+  for (size_t b = 0; b < nblocks; ++b)
+    for (int id : f.blocks[b].instrs) {
+      const Instr &instr = f.instrs[id];
+      if (instr.op == Op::LOAD || instr.op == Op::STORE)
+        slots.insert(instr.imm);
+      if (instr.op == Op::STORE)
+        defs[instr.imm].insert(b);
+    }
+
+  // variable read before any store gets value which is in its slot at start
+  std::unordered_map<int, int> entry;
+  std::vector<int> entries;
+  for (int slot : slots) {
+    Instr instr;
+    instr.op = Op::ENTRY;
+    instr.imm = slot;
+    instr.slot = slot;
+    instr.block = 0;
+    f.instrs.push_back(std::move(instr));
+    entry[slot] = f.instrs.size() - 1;
+    entries.push_back(f.instrs.size() - 1);
+  }
+  f.blocks[0].instrs.insert(f.blocks[0].instrs.begin(), entries.begin(), entries.end());
+
+  std::vector<std::vector<int>> phis(nblocks);
+  for (auto &def : defs) {
+    std::vector<int> work(def.second.begin(), def.second.end());
+    std::set<int> placed;
+    while (!work.empty()) {
+      int b = work.back();
+      work.pop_back();
+      for (int df : frontier[b]) {
+        if (!placed.insert(df).second)
+          continue;
+        Instr instr;
+        instr.op = Op::PHI;
+        instr.slot = def.first;
+        instr.block = df;
+        instr.operands.assign(f.blocks[df].preds.size(), -1);
+        f.instrs.push_back(std::move(instr));
+        phis[df].push_back(f.instrs.size() - 1);
+        work.push_back(df);
+      }
+    }
+  }
+  for (size_t b = 0; b < nblocks; ++b)
+    f.blocks[b].instrs.insert(f.blocks[b].instrs.begin(), phis[b].begin(), phis[b].end());
+
+  std::unordered_map<int, std::vector<int>> current;
+  std::vector<int> replace(f.instrs.size(), -1);
+  auto resolve = [&](int value) {
+    while (replace[value] >= 0)
+      value = replace[value];
+    return value;
+  };
+  auto top = [&](int slot) {
+    std::vector<int> &values = current[slot];
+    return values.empty() ? entry[slot] : values.back();
+  };
+  std::function<void(int)> rename = [&](int b) {
+    std::vector<int> pushed;
+    for (int id : f.blocks[b].instrs) {
+      Instr &instr = f.instrs[id];
+      if (instr.op == Op::PHI) {
+        current[instr.slot].push_back(id);
+        pushed.push_back(instr.slot);
+        continue;
+      }
+      for (auto &operand : instr.operands)
+        operand = resolve(operand);
+      if (instr.op == Op::LOAD) {
+        replace[id] = top(instr.imm);
+      } else if (instr.op == Op::STORE) {
+        Instr &value = f.instrs[instr.operands[0]];
+        if (value.slot < 0 && value.op != Op::CONST)
+          value.slot = instr.imm;
+        current[instr.imm].push_back(instr.operands[0]);
+        pushed.push_back(instr.imm);
+      }
+    }
+    for (int succ : f.blocks[b].succs) {
+      const std::vector<int> &preds = f.blocks[succ].preds;
+      size_t index = std::find(preds.begin(), preds.end(), b) - preds.begin();
+      for (int id : f.blocks[succ].instrs) {
+        if (f.instrs[id].op != Op::PHI)
+          break;
+        f.instrs[id].operands[index] = top(f.instrs[id].slot);
+      }
+    }
+    for (int child : f.blocks[b].children)
+      rename(child);
+    for (int slot : pushed)
+      current[slot].pop_back();
+  };
+  rename(0);
+
+  for (auto &block : f.blocks) {
+    std::vector<int> kept;
+    for (int id : block.instrs) {
+      if (f.instrs[id].op == Op::LOAD || f.instrs[id].op == Op::STORE)
+        f.instrs[id].block = -1;
+      else
+        kept.push_back(id);
+    }
+    block.instrs = std::move(kept);
+  }
+}
+
+//removes phis which select one value and phis and entries which are not used
+void Builder::cleanup() {
+  Function &f = function_;
+  f.compute_uses();
+  std::vector<int> work;
+  for (auto &block : f.blocks)
+    for (int id : block.instrs)
+      if (f.instrs[id].op == Op::PHI)
+        work.push_back(id);
+  while (!work.empty()) {
+    int phi = work.back();
+    work.pop_back();
+    if (f.instrs[phi].block < 0)
+      continue;
+    int same = -1;
+    bool trivial = true;
+    for (int operand : f.instrs[phi].operands) {
+      if (operand == phi || operand == same)
+        continue;
+      if (same >= 0) {
+        trivial = false;
+        break;
+      }
+      same = operand;
+    }
+    if (!trivial || same < 0)
+      continue;
+    for (int user : f.users[phi])
+      if (user != phi && f.instrs[user].op == Op::PHI)
+        work.push_back(user);
+    f.replace_uses(phi, same);
+    f.erase(phi);
+  }
+
+  std::vector<char> used(f.instrs.size(), 0);
+  std::vector<int> live;
+  for (auto &block : f.blocks)
+    for (int id : block.instrs)
+      if (f.instrs[id].op != Op::PHI)
+        for (int operand : f.instrs[id].operands)
+          live.push_back(operand);
+  while (!live.empty()) {
+    int value = live.back();
+    live.pop_back();
+    if (used[value])
+      continue;
+    used[value] = 1;
+    if (f.instrs[value].op == Op::PHI)
+      live.insert(live.end(), f.instrs[value].operands.begin(), f.instrs[value].operands.end());
+  }
+  for (size_t id = 0; id < f.instrs.size(); ++id) {
+    Op op = f.instrs[id].op;
+    if (f.instrs[id].block >= 0 && (op == Op::PHI || op == Op::ENTRY) && !used[id])
+      f.erase(id);
+  }
+  f.compute_uses();
+}
+
+Function compile_tree(const PTree *root) {
+  Function function;
+  Builder builder(function);
+  builder.build(root);
+  return function;
+}
+
+//out of SSA translation, values which are used once in the same block are folded
+//back into expression trees, other values get stack slots
+class Rebuilder {
+  const Function &f_;
+  std::vector<std::vector<int>> users_;
+  std::vector<char> inlined_;
+  std::vector<int> slot_;
+  std::vector<std::vector<int>> reads_;
+  std::vector<std::set<int>> interference_;
+  int nextslot_ = 0;
+  int scratch_ = -1;
+  //compact offsets of used slots
+  std::map<int, int> offsets_;
+  int size_ = 0;
+
+  bool needs_slot(int id) const;
+  bool anchored(int id) const;
+  void collect(int operand, std::vector<int> &out) const;
+  void analyze();
+  void assign_slots();
+  void compact_slots();
+
+  NameInt *variable(int slot) const;
+  PTree *expr(int value) const;
+  PTree *compute(int value) const;
+  void emit_code(int block, Block *target) const;
+  void emit_copy(Block *target, int dst, PTree *src) const;
+  void emit_copies(int from, Block *target);
+  void emit_seq(const std::vector<Region> &seq, Block *target);
+
+  public:
+  Rebuilder(const Function &function) : f_(function) {}
+  Block *rebuild();
+  int stacksize() const { return size_; }
+};
+
+bool Rebuilder::needs_slot(int id) const {
+  const Instr &instr = f_.instrs[id];
+  if (instr.block < 0 || inlined_[id] || users_[id].empty())
+    return false;
+  return instr.op != Op::CONST && instr.op != Op::PRINT && !is_terminator(instr.op);
+}
+
+//instruction which is executed in its own place of rebuilt tree
+bool Rebuilder::anchored(int id) const {
+  const Instr &instr = f_.instrs[id];
+  if (inlined_[id] || instr.op == Op::PHI || instr.op == Op::ENTRY || instr.op == Op::CONST)
+    return false;
+  switch (instr.op) {
+  case Op::PRINT:
+  case Op::CBR:
+  case Op::INPUT:
+    return true;
+  case Op::BR:
+  case Op::RET:
+    return false;
+  default:
+    return needs_slot(id) || f_.may_trap(id);
+  }
+}
+
+//slots read by evaluation of operand
+void Rebuilder::collect(int operand, std::vector<int> &out) const {
+  if (f_.instrs[operand].op == Op::CONST)
+    return;
+  if (!inlined_[operand]) {
+    out.push_back(operand);
+    return;
+  }
+  for (int inner : f_.instrs[operand].operands)
+    collect(inner, out);
+}
+
+void Rebuilder::analyze() {
+  size_t count = f_.instrs.size();
+  users_.assign(count, std::vector<int>{});
+  for (auto &block : f_.blocks)
+    for (int id : block.instrs)
+      for (int operand : f_.instrs[id].operands)
+        users_[operand].push_back(id);
+
+  inlined_.assign(count, 0);
+  for (auto &block : f_.blocks)
+    for (int id : block.instrs) {
+      const Instr &instr = f_.instrs[id];
+      if (instr.op != Op::BINARY && instr.op != Op::NEG && instr.op != Op::NOT)
+        continue;
+      if (users_[id].size() != 1 || f_.may_trap(id))
+        continue;
+      const Instr &user = f_.instrs[users_[id][0]];
+      inlined_[id] = user.op != Op::PHI && user.block == instr.block;
+    }
+
+  reads_.assign(count, std::vector<int>{});
+  for (auto &block : f_.blocks)
+    for (int id : block.instrs)
+      if (anchored(id))
+        for (int operand : f_.instrs[id].operands)
+          collect(operand, reads_[id]);
+
+  // liveness of values with slots, phi operands are live at the end of predecessor
+  std::vector<int> order = f_.reverse_postorder();
+  std::vector<std::set<int>> livein(f_.blocks.size());
+  auto liveout = [&](int b) {
+    std::set<int> live;
+    for (int succ : f_.blocks[b].succs) {
+      live.insert(livein[succ].begin(), livein[succ].end());
+      const std::vector<int> &preds = f_.blocks[succ].preds;
+      size_t index = std::find(preds.begin(), preds.end(), b) - preds.begin();
+      for (int id : f_.blocks[succ].instrs) {
+        if (f_.instrs[id].op != Op::PHI)
+          break;
+        int operand = f_.instrs[id].operands[index];
+        if (needs_slot(id) && f_.instrs[operand].op != Op::CONST)
+          live.insert(operand);
+      }
+    }
+    return live;
+  };
+  // scan block backward, defs are reported to visit before they leave live set
+  auto scan = [&](int b, std::set<int> &live, const std::function<void(int, const std::set<int> &)> &visit) {
+    const std::vector<int> &instrs = f_.blocks[b].instrs;
+    for (auto it = instrs.rbegin(); it != instrs.rend(); ++it) {
+      int id = *it;
+      if (f_.instrs[id].op == Op::PHI)
+        continue;
+      if (needs_slot(id)) {
+        visit(id, live);
+        live.erase(id);
+      }
+      live.insert(reads_[id].begin(), reads_[id].end());
+    }
+    for (int id : instrs) {
+      if (f_.instrs[id].op != Op::PHI)
+        break;
+      if (needs_slot(id))
+        visit(id, live);
+    }
+    for (int id : instrs) {
+      if (f_.instrs[id].op != Op::PHI)
+        break;
+      live.erase(id);
+    }
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+      std::set<int> live = liveout(*it);
+      scan(*it, live, [](int, const std::set<int> &) {});
+      if (live != livein[*it]) {
+        livein[*it] = std::move(live);
+        changed = true;
+      }
+    }
+  }
+
+  interference_.assign(count, std::set<int>{});
+  for (int b : order) {
+    std::set<int> live = liveout(b);
+    scan(b, live, [this](int def, const std::set<int> &live) {
+      for (int other : live)
+        if (other != def) {
+          interference_[def].insert(other);
+          interference_[other].insert(def);
+        }
+    });
+  }
+}
+
+//values are placed to slot of their variable when it does not interfere,
+//phis prefer slots of their operands to make copies on edges trivial
+void Rebuilder::assign_slots() {
+  slot_.assign(f_.instrs.size(), -1);
+  std::unordered_map<int, std::vector<int>> occupants;
+  std::vector<int> temps;
+  nextslot_ = f_.varsize;
+  auto fits = [&](int value, int slot) {
+    for (int other : occupants[slot])
+      if (interference_[value].count(other))
+        return false;
+    return true;
+  };
+  auto place = [&](int value, int slot) {
+    slot_[value] = slot;
+    occupants[slot].push_back(value);
+  };
+  for (int id : f_.blocks[0].instrs)
+    if (f_.instrs[id].op == Op::ENTRY && needs_slot(id))
+      place(id, f_.instrs[id].imm);
+  for (int b : f_.reverse_postorder())
+    for (int id : f_.blocks[b].instrs) {
+      const Instr &instr = f_.instrs[id];
+      if (!needs_slot(id) || slot_[id] >= 0)
+        continue;
+      std::vector<int> candidates;
+      if (instr.slot >= 0)
+        candidates.push_back(instr.slot);
+      if (instr.op == Op::PHI)
+        for (int operand : instr.operands)
+          if (slot_[operand] >= 0)
+            candidates.push_back(slot_[operand]);
+      for (int user : users_[id])
+        if (f_.instrs[user].op == Op::PHI && slot_[user] >= 0)
+          candidates.push_back(slot_[user]);
+      candidates.insert(candidates.end(), temps.begin(), temps.end());
+      int chosen = -1;
+      for (int slot : candidates)
+        if (fits(id, slot)) {
+          chosen = slot;
+          break;
+        }
+      if (chosen < 0) {
+        chosen = nextslot_;
+        nextslot_ += sizeof(int);
+        temps.push_back(chosen);
+      }
+      place(id, chosen);
+    }
+}
+
+//slots are numbered in order of their offsets, unused variables are left out
+void Rebuilder::compact_slots() {
+  for (int slot : slot_)
+    if (slot >= 0)
+      offsets_[slot] = 0;
+  for (auto &offset : offsets_) {
+    offset.second = size_;
+    size_ += sizeof(int);
+  }
+}
+
+NameInt *Rebuilder::variable(int slot) const {
+  auto name = f_.names.find(slot);
+  std::string varname = name != f_.names.end() ? name->second : "t" + std::to_string(slot);
+  return new NameInt(nullptr, 0, 0, offsets_.at(slot), varname);
+}
+
+PTree *Rebuilder::expr(int value) const {
+  const Instr &instr = f_.instrs[value];
+  if (instr.op == Op::CONST)
+    return new Imidiate<int>(nullptr, instr.imm);
+  if (inlined_[value])
+    return compute(value);
+  if (slot_[value] < 0)
+    throw std::logic_error{"Value without slot in out of SSA translation"};
+  return variable(slot_[value]);
+}
+
+PTree *Rebuilder::compute(int value) const {
+  const Instr &instr = f_.instrs[value];
+  switch (instr.op) {
+  case Op::BINARY: {
+    BinOp *binop = new BinOp(instr.binop, nullptr, expr(instr.operands[0]), expr(instr.operands[1]));
+    binop->safe_ = instr.safe;
+    return binop;
+  }
+  case Op::NEG:
+    return new UnOp(UnOpType::MINUS, nullptr, expr(instr.operands[0]));
+  case Op::NOT:
+    return new UnOp(UnOpType::NOT, nullptr, expr(instr.operands[0]));
+  case Op::INPUT:
+    return new Reserved(nullptr, Reserved::Types::Input);
+  default:
+    throw std::logic_error{"Unexpected instruction in out of SSA translation"};
+  }
+}
+
+void Rebuilder::emit_code(int block, Block *target) const {
+  for (int id : f_.blocks[block].instrs) {
+    const Instr &instr = f_.instrs[id];
+    if (!anchored(id) || instr.op == Op::CBR)
+      continue;
+    if (instr.op == Op::PRINT)
+      target->push_expression(new Expression(nullptr, new Output(nullptr, expr(instr.operands[0]))));
+    else if (slot_[id] >= 0)
+      target->push_expression(new Expression(nullptr, new Assign(nullptr, variable(slot_[id]), compute(id))));
+    else
+      target->push_expression(new Expression(nullptr, compute(id)));
+  }
+}
+
+void Rebuilder::emit_copy(Block *target, int dst, PTree *src) const {
+  target->push_expression(new Expression(nullptr, new Assign(nullptr, variable(dst), src)));
+}
+
+//phis of successor are parallel copy on the edge, it is sequentialized
+//with scratch slot for cycles
+void Rebuilder::emit_copies(int from, Block *target) {
+  if (f_.terminator(from).op != Op::BR)
+    return;
+  int to = f_.blocks[from].succs[0];
+  const std::vector<int> &preds = f_.blocks[to].preds;
+  size_t index = std::find(preds.begin(), preds.end(), from) - preds.begin();
+  std::vector<std::pair<int, int>> moves;
+  std::vector<std::pair<int, int>> constants;
+  for (int id : f_.blocks[to].instrs) {
+    if (f_.instrs[id].op != Op::PHI)
+      break;
+    if (!needs_slot(id))
+      continue;
+    const Instr &operand = f_.instrs[f_.instrs[id].operands[index]];
+    if (operand.op == Op::CONST)
+      constants.push_back({slot_[id], operand.imm});
+    else if (slot_[f_.instrs[id].operands[index]] != slot_[id])
+      moves.push_back({slot_[id], slot_[f_.instrs[id].operands[index]]});
+  }
+  while (!moves.empty()) {
+    bool progress = false;
+    for (size_t i = 0; i < moves.size() && !progress; ++i) {
+      bool blocked = false;
+      for (size_t j = 0; j < moves.size(); ++j)
+        blocked |= j != i && moves[j].second == moves[i].first;
+      if (blocked)
+        continue;
+      emit_copy(target, moves[i].first, variable(moves[i].second));
+      moves.erase(moves.begin() + i);
+      progress = true;
+    }
+    if (progress)
+      continue;
+    if (scratch_ < 0) {
+      scratch_ = nextslot_;
+      nextslot_ += sizeof(int);
+      offsets_[scratch_] = size_;
+      size_ += sizeof(int);
+    }
+    int saved = moves[0].first;
+    emit_copy(target, scratch_, variable(saved));
+    for (auto &move : moves)
+      if (move.second == saved)
+        move.second = scratch_;
+  }
+  for (auto &constant : constants)
+    emit_copy(target, constant.first, new Imidiate<int>(nullptr, constant.second));
+}
+
+void Rebuilder::emit_seq(const std::vector<Region> &seq, Block *target) {
+  for (auto &region : seq) {
+    if (region.kind == Region::Kind::Code) {
+      emit_code(region.block, target);
+      emit_copies(region.block, target);
+      continue;
+    }
+    int cond = f_.terminator(region.block).operands[0];
+    const Instr &condition = f_.instrs[cond];
+    if (region.kind == Region::Kind::If) {
+      if (condition.op == Op::CONST) {
+        emit_seq(region.arms[condition.imm != 0 ? 0 : 1], target);
+        continue;
+      }
+      Block *thenblk = new Block;
+      Block *elseblk = new Block;
+      emit_seq(region.arms[0], thenblk);
+      emit_seq(region.arms[1], elseblk);
+      // condition without side effects is dropped with empty arms
+      if (thenblk->operations.empty() && elseblk->operations.empty()) {
+        delete thenblk;
+        delete elseblk;
+        continue;
+      }
+      PTree *other = elseblk;
+      if (elseblk->operations.empty()) {
+        delete elseblk;
+        other = nullptr;
+      }
+      target->push_expression(new IfBlk(new Condition(nullptr, expr(cond)), nullptr, other, thenblk));
+      continue;
+    }
+    // loop is rotated when header computes something: header code runs before the loop
+    // and at the end of each iteration
+    emit_code(region.block, target);
+    if (condition.op == Op::CONST && condition.imm == 0)
+      continue;
+    Block *body = new Block;
+    emit_seq(region.arms[0], body);
+    emit_code(region.block, body);
+    target->push_expression(new WhileBlk(new Condition(nullptr, expr(cond)), nullptr, body));
+  }
+}
+
+Block *Rebuilder::rebuild() {
+  analyze();
+  assign_slots();
+  compact_slots();
+  Block *root = new Block;
+  emit_seq(f_.body, root);
+  return root;
+}
+
+Block *rebuild_tree(const Function &function, int &stacksize) {
+  Rebuilder rebuilder(function);
+  Block *root = rebuilder.rebuild();
+  stacksize = rebuilder.stacksize();
+  return root;
+}
+
+}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "paracl.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/*
+ssa structure:
+1) Instr - instruction of mid-level IR, instruction id is the SSA value it defines
+2) BasicBlock - instructions with one terminator at the end, phis at the beginning
+3) Region - structured shape of CFG (sequence, if, while), it is kept because tree
+   executors have no jumps and out of SSA translation rebuilds Block/IfBlk/WhileBlk
+4) Function - CFG with dominator tree and use-def chains, blocks[0] is entry
+5) compile_tree - lowers tree (after manage_tree_mem) to CFG with variable slots as memory,
+   then promotes slots to SSA values (phis are placed on dominance frontiers)
+6) rebuild_tree - out of SSA translation: phis become copies on incoming edges,
+   values get stack offsets (variable offset when it is free, otherwise a new slot),
+   then used offsets are compacted, so unused variables take no stack
+*/
+
+namespace ptree {
+
+namespace ssa {
+
+enum class Op : unsigned char {
+  CONST,  //value = imm
+  ENTRY,  //value of variable slot imm before program start
+  PHI,    //value = operands[i] if control came from preds[i]
+  BINARY, //value = operands[0] binop operands[1]
+  NEG,    //value = -operands[0]
+  NOT,    //value = !operands[0]
+  INPUT,  //value is read from stdin
+  PRINT,  //print operands[0]
+  LOAD,   //value = slot imm, exists only during construction
+  STORE,  //slot imm = operands[0], exists only during construction
+  BR,     //jump to succs[0]
+  CBR,    //jump to succs[0] if operands[0] is not zero, otherwise to succs[1]
+  RET
+};
+
+//return text name of operation
+std::string op_name(Op op);
+//return text name of binary operation
+std::string binop_name(BinOpType operation);
+
+struct Instr {
+  Op op;
+  BinOpType binop = BinOpType::UNDEF;
+  int imm = 0;
+  std::vector<int> operands;
+  //block which contains instruction, -1 if instruction is erased
+  int block = -1;
+  //offset of variable which holds value in source program, -1 for temporaries
+  int slot = -1;
+  //division which can not trap at its place, range analysis proves it
+  bool safe = false;
+};
+
+struct BasicBlock {
+  std::vector<int> instrs;
+  std::vector<int> preds;
+  std::vector<int> succs;
+  //immediate dominator, -1 for entry block
+  int idom = -1;
+  //children in dominator tree
+  std::vector<int> children;
+};
+
+struct Region {
+  enum class Kind { Code, If, While };
+  Kind kind;
+  //Code: block, If: block with condition, While: loop header
+  int block;
+  //If: join block, While: exit block
+  int merge = -1;
+  //If: then and else sequences, While: body sequence
+  std::vector<std::vector<Region>> arms = {};
+};
+
+class Function {
+  public:
+  std::vector<Instr> instrs;
+  std::vector<BasicBlock> blocks;
+  std::vector<Region> body;
+  //users[value] - instructions which use value, one entry per operand
+  std::vector<std::vector<int>> users;
+  //names of variables by their offset
+  std::unordered_map<int, std::string> names;
+  //stack size used by variables of source program
+  int varsize = 0;
+
+  //return blocks in reverse postorder from entry
+  std::vector<int> reverse_postorder() const;
+  //fill preds, idom and children of blocks
+  void compute_dominators();
+  //return true if block a dominates block b
+  bool dominates(int a, int b) const;
+  //fill users of all values
+  void compute_uses();
+  //add instruction to the end of block (before terminator if block has one), return its id
+  int insert(int block, Instr instr);
+  //add instruction before other one in its block, return its id
+  int insert_before(int position, Instr instr);
+  //move instruction to the end of block (before terminator)
+  void move(int value, int block);
+  //redirect all uses of value to other, users should be computed
+  void replace_uses(int value, int other);
+  //remove instruction from its block
+  void erase(int value);
+  //return terminator of block
+  const Instr &terminator(int block) const;
+  //return true if value is division or remainder which can trap (by zero or INT_MIN by -1),
+  //it can not be removed or moved; division proven safe by conditions of branches before it
+  //can trap when it is moved
+  bool may_trap(int value, bool moved = false) const;
+  //return std::string with listing of blocks and dominator tree
+  std::string dump() const;
+};
+
+//build SSA form of tree (after manage_tree_mem)
+Function compile_tree(const PTree *root);
+
+//build tree with bound offsets from SSA form, stacksize receives stack size for the new tree
+Block *rebuild_tree(const Function &function, int &stacksize);
+
+}
+
+}
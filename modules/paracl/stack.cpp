@@ -16,5 +16,8 @@ Stack& Stack::operator=(Stack&& old) {
     std::swap(memory, old.memory);
     return *this;
 }
+char *Stack::getmemory() const {
+    return memory;
+}
 
 }
\ No newline at end of file
@@ -40,6 +40,8 @@ public:
     void read(int offset, T &value) const {
         memcpy(&value, memory + offset, sizeof(value));
     }
+    //return pointer to Stack memory, used by native code
+    char *getmemory() const;
 };
 
 }
\ No newline at end of file
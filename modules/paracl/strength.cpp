@@ -0,0 +1,294 @@
+#include "strength.hpp"
+
+#include <climits>
+#include <algorithm>
+#include <map>
+
+namespace ptree {
+
+namespace ssa {
+
+//return k if value is 2^k, k > 0, otherwise -1
+static int log2_exact(unsigned value) {
+  if (value < 2 || (value & (value - 1)) != 0)
+    return -1;
+  int k = 0;
+  while ((1u << k) != value)
+    ++k;
+  return k;
+}
+
+//Hacker's Delight, 10-1
+Magic division_magic(int divisor) {
+  const unsigned two31 = 0x80000000u;
+  unsigned ad = divisor < 0 ? 0u - static_cast<unsigned>(divisor) : divisor;
+  unsigned t = two31 + (static_cast<unsigned>(divisor) >> 31);
+  unsigned anc = t - 1 - t % ad;
+  int p = 31;
+  unsigned q1 = two31 / anc, r1 = two31 - q1 * anc;
+  unsigned q2 = two31 / ad, r2 = two31 - q2 * ad;
+  unsigned delta;
+  do {
+    ++p;
+    q1 *= 2;
+    r1 *= 2;
+    if (r1 >= anc) {
+      ++q1;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if (r2 >= ad) {
+      ++q2;
+      r2 -= ad;
+    }
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+  unsigned multiplier = q2 + 1;
+  if (divisor < 0)
+    multiplier = 0u - multiplier;
+  return Magic{static_cast<int>(multiplier), p - 32};
+}
+
+StrengthReduction::StrengthReduction(Function &function) : f_(function) {}
+
+int StrengthReduction::constant(int value) {
+  Instr instr;
+  instr.op = Op::CONST;
+  instr.imm = value;
+  return f_.insert(0, instr);
+}
+
+//new operations are placed before the rewritten one
+int StrengthReduction::emit(BinOpType operation, int lhs, int rhs) {
+  Instr instr;
+  instr.op = Op::BINARY;
+  instr.binop = operation;
+  instr.operands = {lhs, rhs};
+  return f_.insert_before(position_, instr);
+}
+
+int StrengthReduction::negate(int operand) {
+  Instr instr;
+  instr.op = Op::NEG;
+  instr.operands = {operand};
+  return f_.insert_before(position_, instr);
+}
+
+//x * 2^k, x * (2^k + 1), x * (2^k - 1), return -1 if there is no cheaper form
+int StrengthReduction::multiply(int value, int factor) {
+  int k = log2_exact(factor < 0 ? 0u - static_cast<unsigned>(factor) : factor);
+  if (k > 0 && k < 31) {
+    int shifted = emit(BinOpType::SHIFT_LEFT, value, constant(k));
+    return factor < 0 ? negate(shifted) : shifted;
+  }
+  if (factor < 3)
+    return -1;
+  if ((k = log2_exact(factor - 1)) > 0)
+    return emit(BinOpType::ADDITION, emit(BinOpType::SHIFT_LEFT, value, constant(k)), value);
+  if (factor != INT_MAX && (k = log2_exact(factor + 1)) > 1)
+    return emit(BinOpType::SUBTRACTION, emit(BinOpType::SHIFT_LEFT, value, constant(k)), value);
+  return -1;
+}
+
+//quotient is rounded toward zero, so negative dividend is biased by divisor - 1 before shift
+int StrengthReduction::divide(int value, int divisor) {
+  if (divisor == 0 || divisor == 1 || divisor == -1 || divisor == INT_MIN)
+    return -1;
+  unsigned ad = divisor < 0 ? 0u - static_cast<unsigned>(divisor) : divisor;
+  int k = log2_exact(ad);
+  if (k > 0) {
+    int sign = emit(BinOpType::SHIFT_RIGHT, value, constant(31));
+    int bias = emit(BinOpType::BIT_AND, sign, constant(ad - 1));
+    int quotient = emit(BinOpType::SHIFT_RIGHT, emit(BinOpType::ADDITION, value, bias), constant(k));
+    return divisor < 0 ? negate(quotient) : quotient;
+  }
+  Magic magic = division_magic(divisor);
+  int quotient = emit(BinOpType::MUL_HIGH, value, constant(magic.multiplier));
+  if (divisor > 0 && magic.multiplier < 0)
+    quotient = emit(BinOpType::ADDITION, quotient, value);
+  if (divisor < 0 && magic.multiplier > 0)
+    quotient = emit(BinOpType::SUBTRACTION, quotient, value);
+  if (magic.shift > 0)
+    quotient = emit(BinOpType::SHIFT_RIGHT, quotient, constant(magic.shift));
+  // sar gives -1 for negative quotient, it is rounded up to zero
+  return emit(BinOpType::SUBTRACTION, quotient, emit(BinOpType::SHIFT_RIGHT, quotient, constant(31)));
+}
+
+//remainder has sign of dividend: x % 2^k is ((x + bias) & (2^k - 1)) - bias
+int StrengthReduction::remainder(int value, int divisor) {
+  if (divisor == 0 || divisor == 1 || divisor == -1 || divisor == INT_MIN)
+    return -1;
+  unsigned ad = divisor < 0 ? 0u - static_cast<unsigned>(divisor) : divisor;
+  if (log2_exact(ad) > 0) {
+    int mask = constant(ad - 1);
+    int bias = emit(BinOpType::BIT_AND, emit(BinOpType::SHIFT_RIGHT, value, constant(31)), mask);
+    int low = emit(BinOpType::BIT_AND, emit(BinOpType::ADDITION, value, bias), mask);
+    return emit(BinOpType::SUBTRACTION, low, bias);
+  }
+  int quotient = divide(value, divisor);
+  int product = multiply(quotient, divisor);
+  if (product < 0)
+    product = emit(BinOpType::MULTIPLICATION, quotient, constant(divisor));
+  return emit(BinOpType::SUBTRACTION, value, product);
+}
+
+//i = phi [start, i + step] and i * factor in loop: new counter j = phi [start * factor, j + step * factor]
+void StrengthReduction::reduce_loop(const Region &loop) {
+  int header = loop.block;
+  if (f_.blocks[header].preds.size() != 2)
+    return;
+  int preheader = f_.blocks[header].preds[0];
+  int latch = f_.blocks[header].preds[1];
+  std::vector<int> phis;
+  for (int id : f_.blocks[header].instrs)
+    if (f_.instrs[id].op == Op::PHI)
+      phis.push_back(id);
+  for (int phi : phis) {
+    const Instr &next = f_.instrs[f_.instrs[phi].operands[1]];
+    if (next.op != Op::BINARY || (next.binop != BinOpType::ADDITION && next.binop != BinOpType::SUBTRACTION))
+      continue;
+    int lhs = next.operands[0], rhs = next.operands[1];
+    if (next.binop == BinOpType::ADDITION && rhs == phi)
+      std::swap(lhs, rhs);
+    if (lhs != phi || f_.instrs[rhs].op != Op::CONST)
+      continue;
+    unsigned step = f_.instrs[rhs].imm;
+    if (next.binop == BinOpType::SUBTRACTION)
+      step = 0u - step;
+
+    std::map<int, int> counters;
+    std::vector<int> users = f_.users[phi];
+    for (int user : users) {
+      const Instr &mul = f_.instrs[user];
+      if (mul.block < 0 || mul.op != Op::BINARY || mul.binop != BinOpType::MULTIPLICATION)
+        continue;
+      int other = mul.operands[0] == phi ? mul.operands[1] : mul.operands[0];
+      if (f_.instrs[other].op != Op::CONST)
+        continue;
+      int factor = f_.instrs[other].imm;
+      if (factor == 0 || factor == 1 || factor == -1)
+        continue;
+      if (!counters.count(factor)) {
+        int init = f_.instrs[phi].operands[0];
+        int start;
+        if (f_.instrs[init].op == Op::CONST) {
+          start = constant(static_cast<int>(static_cast<unsigned>(f_.instrs[init].imm) * factor));
+        } else {
+          Instr instr;
+          instr.op = Op::BINARY;
+          instr.binop = BinOpType::MULTIPLICATION;
+          instr.operands = {init, other};
+          start = f_.insert(preheader, instr);
+        }
+        Instr counter;
+        counter.op = Op::PHI;
+        counter.operands = {start, start};
+        counter.block = header;
+        int id = f_.instrs.size();
+        f_.instrs.push_back(counter);
+        f_.blocks[header].instrs.insert(f_.blocks[header].instrs.begin(), id);
+        Instr increment;
+        increment.op = Op::BINARY;
+        increment.binop = BinOpType::ADDITION;
+        increment.operands = {id, constant(static_cast<int>(step * factor))};
+        f_.instrs[id].operands[1] = f_.insert(latch, increment);
+        f_.compute_uses();
+        counters[factor] = id;
+      }
+      f_.replace_uses(user, counters[factor]);
+      f_.erase(user);
+      ++inductions_;
+    }
+  }
+}
+
+void StrengthReduction::reduce_loops(const std::vector<Region> &seq) {
+  for (auto &region : seq) {
+    for (auto &arm : region.arms)
+      reduce_loops(arm);
+    if (region.kind == Region::Kind::While)
+      reduce_loop(region);
+  }
+}
+
+//x % 2^k == 0 and x % 2^k != 0 test low bits
+void StrengthReduction::reduce_parity(int id) {
+  const Instr &instr = f_.instrs[id];
+  if (instr.op != Op::BINARY || (instr.binop != BinOpType::EQUAL && instr.binop != BinOpType::NON_EQUAL))
+    return;
+  for (int i = 0; i < 2; ++i) {
+    const Instr &zero = f_.instrs[instr.operands[1 - i]];
+    int rem = instr.operands[i];
+    const Instr &operand = f_.instrs[rem];
+    if (zero.op != Op::CONST || zero.imm != 0 || operand.op != Op::BINARY || operand.binop != BinOpType::REMAINDER)
+      continue;
+    const Instr &divisor = f_.instrs[operand.operands[1]];
+    if (divisor.op != Op::CONST || divisor.imm == INT_MIN || f_.users[rem].size() != 1)
+      continue;
+    unsigned ad = divisor.imm < 0 ? 0u - static_cast<unsigned>(divisor.imm) : divisor.imm;
+    if (log2_exact(ad) <= 0)
+      continue;
+    int mask = constant(ad - 1);
+    Instr &reduced = f_.instrs[rem];
+    f_.users[reduced.operands[1]].erase(
+        std::find(f_.users[reduced.operands[1]].begin(), f_.users[reduced.operands[1]].end(), rem));
+    reduced.binop = BinOpType::BIT_AND;
+    reduced.operands[1] = mask;
+    f_.users[mask].push_back(rem);
+    ++rewritten_;
+    return;
+  }
+}
+
+void StrengthReduction::reduce(int id) {
+  const Instr &instr = f_.instrs[id];
+  if (instr.block < 0 || instr.op != Op::BINARY)
+    return;
+  int lhs = instr.operands[0], rhs = instr.operands[1];
+  bool lconst = f_.instrs[lhs].op == Op::CONST, rconst = f_.instrs[rhs].op == Op::CONST;
+  if (lconst == rconst)
+    return;
+  position_ = id;
+  int res = -1;
+  switch (instr.binop) {
+  case BinOpType::MULTIPLICATION:
+    res = lconst ? multiply(rhs, f_.instrs[lhs].imm) : multiply(lhs, f_.instrs[rhs].imm);
+    break;
+  case BinOpType::DIVISION:
+    if (rconst)
+      res = divide(lhs, f_.instrs[rhs].imm);
+    break;
+  case BinOpType::REMAINDER:
+    if (rconst)
+      res = remainder(lhs, f_.instrs[rhs].imm);
+    break;
+  default:
+    break;
+  }
+  if (res < 0)
+    return;
+  f_.replace_uses(id, res);
+  f_.erase(id);
+  ++rewritten_;
+}
+
+void StrengthReduction::run() {
+  f_.compute_uses();
+  reduce_loops(f_.body);
+  std::vector<int> instrs;
+  for (auto &block : f_.blocks)
+    instrs.insert(instrs.end(), block.instrs.begin(), block.instrs.end());
+  for (int id : instrs)
+    reduce_parity(id);
+  for (int id : instrs)
+    reduce(id);
+}
+
+int StrengthReduction::getrewritten() const { return rewritten_; }
+
+int StrengthReduction::getinductions() const { return inductions_; }
+
+}
+
+}
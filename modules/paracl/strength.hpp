@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ssa.hpp"
+
+#include <vector>
+
+namespace ptree {
+
+namespace ssa {
+
+//magic number of signed division by constant: x / divisor is
+//(mul_high(x, multiplier) +/- x) >> shift plus one for negative quotient
+struct Magic {
+  int multiplier;
+  int shift;
+};
+
+//return magic number for divisor, |divisor| > 1
+Magic division_magic(int divisor);
+
+//strength reduction: multiplication, division and remainder by constants become shifts,
+//masks and multiplication by magic number (results are the same as C signed division),
+//multiplication of loop counter by constant becomes a new counter with addition
+class StrengthReduction {
+  Function &f_;
+  int position_ = -1;
+  int rewritten_ = 0;
+  int inductions_ = 0;
+
+  int constant(int value);
+  int emit(BinOpType operation, int lhs, int rhs);
+  int negate(int operand);
+  int multiply(int value, int factor);
+  int divide(int value, int divisor);
+  int remainder(int value, int divisor);
+  void reduce_loop(const Region &loop);
+  void reduce_loops(const std::vector<Region> &seq);
+  void reduce_parity(int id);
+  void reduce(int id);
+
+  public:
+  StrengthReduction(Function &function);
+  void run();
+  //count of rewritten operations
+  int getrewritten() const;
+  //count of multiplications replaced by new loop counters
+  int getinductions() const;
+};
+
+}
+
+}
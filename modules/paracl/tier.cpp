@@ -0,0 +1,129 @@
+#include "tier.hpp"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+namespace ptree {
+
+using namespace std::chrono;
+
+long TierManager::threshold = 0;
+long TierManager::regions = 0;
+long TierManager::entries = 0;
+long TierManager::osr = 0;
+std::atomic<long> TierManager::failed{0};
+long TierManager::fastns = 0;
+std::atomic<long> TierManager::compilens{0};
+
+//background compilations, joined at exit if program did not wait for them
+static struct Workers {
+  std::vector<std::thread> threads;
+  void join() {
+    for (auto &worker : threads)
+      worker.join();
+    threads.clear();
+  }
+  ~Workers() { join(); }
+} workers;
+
+TierRegion::TierRegion(const PTree *unit) : unit_(unit), state_(0) {}
+
+void TierRegion::compile() {
+  auto start = steady_clock::now();
+  // counters and regions are kept by TierManager, tree walker changes only quickened evaluators of
+  // BinOp, which are not read by compile_tree, so tree can be read concurrently
+  try {
+    program_ = regcode::compile_tree(unit_);
+    state_.store(1, std::memory_order_release);
+  } catch (std::exception &) {
+    ++TierManager::failed;
+    state_.store(2, std::memory_order_release);
+  }
+  TierManager::compilens += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+}
+
+bool TierRegion::ready() const { return state_.load(std::memory_order_acquire) == 1; }
+
+void TierRegion::run(Stack *stack) { machine_.run(program_, stack); }
+
+std::shared_ptr<TierRegion> TierManager::compile(const PTree *unit) {
+  ++regions;
+  auto region = std::make_shared<TierRegion>(unit);
+  // thread shares the region, so it can finish after the node has dropped it
+  workers.threads.emplace_back([region] { region->compile(); });
+  return region;
+}
+
+void TierManager::wait() { workers.join(); }
+
+void TierManager::enter(TierRegion &region, Stack *stack, bool osr_entry) {
+  ++(osr_entry ? osr : entries);
+  auto start = steady_clock::now();
+  region.run(stack);
+  fastns += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+}
+
+void TierManager::run(const PTree *root, Stack *stack) { execute(root, stack); }
+
+void TierManager::execute(const PTree *unit, Stack *stack) {
+  if (unit == nullptr)
+    return;
+  if (auto blk = dynamic_cast<const Block *>(unit)) {
+    block(blk, stack);
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    execute(ifblock->condition_->is_true(stack) ? ifblock->getright() : ifblock->getleft(), stack);
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    loop(whileblock, stack);
+    return;
+  }
+  unit->execute(stack);
+}
+
+void TierManager::block(const Block *blk, Stack *stack) {
+  NodeState &state = nodes_[blk];
+  if (state.region && state.region->ready()) {
+    enter(*state.region, stack, false);
+    return;
+  }
+  if (++state.count == threshold && !state.region)
+    state.region = compile(blk);
+  for (auto expr : blk->operations)
+    execute(expr, stack);
+}
+
+void TierManager::loop(const WhileBlk *whileblock, Stack *stack) {
+  if (whileblock->condition_ == nullptr)
+    throw std::logic_error{"No condition in while cycle"};
+  // elements of unordered_map keep their place when nested nodes are added
+  NodeState &state = nodes_[whileblock];
+  for (;;) {
+    // on-stack replacement: compiled loop continues from the loop header
+    if (state.region && state.region->ready()) {
+      enter(*state.region, stack, true);
+      break;
+    }
+    if (!whileblock->condition_->is_true(stack))
+      break;
+    if (++state.count == threshold && !state.region)
+      state.region = compile(whileblock);
+    execute(whileblock->getleft(), stack);
+  }
+}
+
+void TierManager::report(std::ostream &out, long total) {
+  out << "Tier tree: " << (total - fastns) / 1000000 << " ms, tier regvm: " << fastns / 1000000
+      << " ms" << std::endl;
+  out << "Regions compiled: " << regions - failed << ", failed: " << failed << ", entries: " << entries
+      << ", on-stack replacements: " << osr << ", background compilation: " << compilens / 1000000
+      << " ms" << std::endl;
+}
+
+}
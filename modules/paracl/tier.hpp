@@ -0,0 +1,81 @@
+#pragma once
+
+#include "paracl.hpp"
+#include "regcode.hpp"
+#include "regvm.hpp"
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+
+/*
+tiered execution:
+1) every program starts in tree walker of TierManager, it counts executions of every Block and
+   iterations of every WhileBlk by node, tree nodes keep no state of tiering
+2) hot region is compiled to register machine code by background thread, tree walker continues
+3) Block runs compiled code on its next execution, WhileBlk switches in the loop header
+   (on-stack replacement), it is safe because all variables live on fixed offsets in Stack
+*/
+
+namespace ptree {
+
+//subtree compiled to register machine in background
+class TierRegion {
+  const PTree *unit_;
+  regcode::Program program_;
+  RegisterVM machine_;
+  //0 - compiling, 1 - ready, 2 - failed
+  std::atomic<int> state_;
+
+public:
+  TierRegion(const PTree *unit);
+  TierRegion(const TierRegion &other) = delete;
+  TierRegion &operator=(const TierRegion &other) = delete;
+  //compile subtree, called from background thread
+  void compile();
+  //return true if compiled code can be run
+  bool ready() const;
+  //run compiled region, variables are taken from stack and written back
+  void run(Stack *stack);
+};
+
+//tree walker of tiered engine
+class TierManager {
+  //count of executions of Block or iterations of WhileBlk and its compiled region
+  struct NodeState {
+    long count = 0;
+    std::shared_ptr<TierRegion> region;
+  };
+  std::unordered_map<const PTree *, NodeState> nodes_;
+
+  void execute(const PTree *unit, Stack *stack);
+  void block(const Block *block, Stack *stack);
+  void loop(const WhileBlk *whileblock, Stack *stack);
+
+  //start background compilation of hot region
+  static std::shared_ptr<TierRegion> compile(const PTree *unit);
+  //run compiled region and account its time
+  static void enter(TierRegion &region, Stack *stack, bool osr_entry);
+
+public:
+  //executions of Block or iterations of WhileBlk before compilation, 0 disables tiering
+  static long threshold;
+  //statistics for --time-stamp
+  static long regions;
+  static long entries;
+  static long osr;
+  static std::atomic<long> failed;
+  //nanoseconds spent in compiled code and in background compilation
+  static long fastns;
+  static std::atomic<long> compilens;
+
+  //run program, stack should be created with MemManager::getmaxstacksize() size
+  void run(const PTree *root, Stack *stack);
+  //wait for all background compilations, tree should not be destroyed before it
+  static void wait();
+  //print per tier time, total is execution time in nanoseconds
+  static void report(std::ostream &out, long total);
+};
+
+}
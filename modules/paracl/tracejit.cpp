@@ -0,0 +1,249 @@
+#include "tracejit.hpp"
+
+#include <stdexcept>
+
+namespace ptree {
+
+long LoopTrace::threshold = 0;
+int LoopTrace::maxsides = 16;
+int LoopTrace::traces = 0;
+int LoopTrace::sidetraces = 0;
+int LoopTrace::failed = 0;
+
+static bool contains_loop(const PTree *unit) {
+  if (unit == nullptr)
+    return false;
+  if (dynamic_cast<const WhileBlk *>(unit))
+    return true;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      if (contains_loop(expr))
+        return true;
+    return false;
+  }
+  return contains_loop(unit->getleft()) || contains_loop(unit->getright());
+}
+
+LoopTrace::LoopTrace(const WhileBlk *loop) : loop_(loop) {}
+
+bool LoopTrace::traceable(const WhileBlk *loop) { return !contains_loop(loop->getleft()); }
+
+void LoopTrace::record_stmt(const PTree *unit, Stack *stack, int path) {
+  if (unit == nullptr)
+    return;
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    frames_.push_back(Frame{block, 0});
+    for (size_t i = 0; i < block->operations.size(); ++i) {
+      frames_.back().next = i + 1;
+      record_stmt(block->operations[i], stack, path);
+    }
+    frames_.pop_back();
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    bool taken = ifblock->condition_->is_true(stack);
+    exits_.push_back(Exit{ifblock, taken, frames_, 0, -1});
+    paths_[path].push_back(Entry{ifblock, static_cast<int>(exits_.size()) - 1});
+    record_stmt(taken ? ifblock->getright() : ifblock->getleft(), stack, path);
+    return;
+  }
+  if (auto expression = dynamic_cast<const Expression *>(unit)) {
+    record_stmt(expression->getright(), stack, path);
+    return;
+  }
+  unit->execute(stack);
+  paths_[path].push_back(Entry{unit, -1});
+}
+
+void LoopTrace::record_rest(Stack *stack, int path) {
+  while (!frames_.empty()) {
+    // frames_ can grow inside record_stmt, so top frame is addressed by index
+    size_t top = frames_.size() - 1;
+    while (frames_[top].next < frames_[top].block->operations.size()) {
+      const PTree *unit = frames_[top].block->operations[frames_[top].next++];
+      record_stmt(unit, stack, path);
+    }
+    frames_.pop_back();
+  }
+}
+
+bool LoopTrace::record(Stack *stack) {
+  paths_.assign(1, std::vector<Entry>{});
+  exits_.clear();
+  frames_.clear();
+  record_stmt(loop_->getleft(), stack, 0);
+  if (!compile()) {
+    ++failed;
+    return false;
+  }
+  ++traces;
+  return true;
+}
+
+void LoopTrace::resume(int exit, Stack *stack) {
+  const IfBlk *ifblock = exits_[exit].ifblk;
+  const PTree *other = exits_[exit].taken ? ifblock->getleft() : ifblock->getright();
+  if (++exits_[exit].count == threshold && static_cast<int>(paths_.size()) <= maxsides) {
+    // side trace starts from the other arm and lasts to the end of iteration
+    size_t nexits = exits_.size();
+    paths_.push_back(std::vector<Entry>{});
+    int path = paths_.size() - 1;
+    frames_ = exits_[exit].frames;
+    record_stmt(other, stack, path);
+    record_rest(stack, path);
+    exits_[exit].side = path;
+    if (compile()) {
+      ++sidetraces;
+    } else {
+      // previous native code is kept, it does not know about new exits
+      exits_.resize(nexits);
+      exits_[exit].side = -1;
+      paths_.pop_back();
+      ++failed;
+    }
+    return;
+  }
+  if (other != nullptr)
+    other->execute(stack);
+  const std::vector<Frame> &frames = exits_[exit].frames;
+  for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame)
+    for (size_t i = frame->next; i < frame->block->operations.size(); ++i)
+      frame->block->operations[i]->execute(stack);
+}
+
+bool LoopTrace::compile() {
+  TraceCompiler compiler;
+  std::unique_ptr<JitCode> code = compiler.compile(loop_, *this);
+  if (!code)
+    return false;
+  code_ = std::move(code);
+  return true;
+}
+
+bool LoopTrace::run(Stack *stack) {
+  int exit = code_->enter(stack);
+  if (exit == 0)
+    return true;
+  resume(exit - 1, stack);
+  return false;
+}
+
+const std::vector<std::vector<LoopTrace::Entry>> &LoopTrace::getpaths() const { return paths_; }
+
+const std::vector<LoopTrace::Exit> &LoopTrace::getexits() const { return exits_; }
+
+void TraceEngine::run(const PTree *root, Stack *stack) { execute(root, stack); }
+
+bool TraceEngine::has_loop(const PTree *unit) {
+  auto it = loopy_.find(unit);
+  if (it == loopy_.end())
+    it = loopy_.emplace(unit, contains_loop(unit)).first;
+  return it->second;
+}
+
+void TraceEngine::execute(const PTree *unit, Stack *stack) {
+  if (unit == nullptr)
+    return;
+  if (!has_loop(unit)) {
+    unit->execute(stack);
+    return;
+  }
+  if (auto block = dynamic_cast<const Block *>(unit)) {
+    for (auto expr : block->operations)
+      execute(expr, stack);
+    return;
+  }
+  if (auto ifblock = dynamic_cast<const IfBlk *>(unit)) {
+    if (ifblock->condition_ == nullptr)
+      throw std::logic_error{"Missing condition in if block"};
+    execute(ifblock->condition_->is_true(stack) ? ifblock->getright() : ifblock->getleft(), stack);
+    return;
+  }
+  if (auto whileblock = dynamic_cast<const WhileBlk *>(unit)) {
+    loop(whileblock, stack);
+    return;
+  }
+  unit->execute(stack);
+}
+
+void TraceEngine::loop(const WhileBlk *whileblock, Stack *stack) {
+  if (whileblock->condition_ == nullptr)
+    throw std::logic_error{"No condition in while cycle"};
+  // elements of unordered_map keep their place when nested loops are added
+  LoopState &state = loops_[whileblock];
+  for (;;) {
+    if (state.trace) {
+      if (state.trace->run(stack))
+        break;
+      continue;
+    }
+    if (!whileblock->condition_->is_true(stack))
+      break;
+    if (++state.backedges == LoopTrace::threshold && LoopTrace::traceable(whileblock)) {
+      // recording executes the iteration, trace is dropped if it can not be compiled
+      state.trace = std::make_unique<LoopTrace>(whileblock);
+      if (!state.trace->record(stack))
+        state.trace.reset();
+      continue;
+    }
+    execute(whileblock->getleft(), stack);
+  }
+}
+
+void TraceCompiler::compile_path(int path, int head) {
+  for (auto &entry : trace_->getpaths()[path]) {
+    if (entry.exit < 0) {
+      compile_stmt(entry.unit);
+      continue;
+    }
+    const LoopTrace::Exit &exit = trace_->getexits()[entry.exit];
+    compile_branch(exit.ifblk->condition_, exitlabels_[entry.exit], !exit.taken);
+  }
+  byte(0xE9); // jmp rel32
+  rel32(head);
+}
+
+std::unique_ptr<JitCode> TraceCompiler::compile(const WhileBlk *loop, const LoopTrace &trace) {
+#ifdef PCL_JIT_X86_64
+  reset();
+  trace_ = &trace;
+  exitlabels_.clear();
+  try {
+    byte(0x53);                         // push rbx
+    byte(0x48); byte(0x89); byte(0xFB); // mov rbx, rdi
+    int head = newlabel();
+    int done = newlabel();
+    for (size_t i = 0; i < trace.getexits().size(); ++i)
+      exitlabels_.push_back(newlabel());
+    bind(head);
+    compile_branch(loop->condition_, done, false);
+    compile_path(0, head);
+    for (size_t i = 0; i < trace.getexits().size(); ++i) {
+      bind(exitlabels_[i]);
+      if (trace.getexits()[i].side >= 0) {
+        compile_path(trace.getexits()[i].side, head);
+        continue;
+      }
+      byte(0xB8); // mov eax, imm32
+      dword(i + 1);
+      byte(0x5B); // pop rbx
+      byte(0xC3); // ret
+    }
+    bind(done);
+    byte(0x31); byte(0xC0); // xor eax, eax
+    byte(0x5B);             // pop rbx
+    byte(0xC3);             // ret
+  } catch (jit_unsupported &e) {
+    error_ = e.what();
+    return std::unique_ptr<JitCode>{};
+  }
+  return finish();
+#else
+  error_ = "native code generation is not supported on this target";
+  return std::unique_ptr<JitCode>{};
+#endif
+}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "paracl.hpp"
+#include "jit.hpp"
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+/*
+tracing jit structure:
+1) TraceEngine walks statements of tree and counts iterations of every WhileBlk,
+   when loop is hot LoopTrace records next iteration
+2) trace is linear path through loop body: statements and guards on conditions of IfBlk
+3) trace is compiled by TraceCompiler to native loop, guard fail leaves native code
+   and the rest of iteration is interpreted from the place of the fail (Stack is shared)
+4) hot guard fail records side trace from the other arm of IfBlk to the end of iteration,
+   side traces are compiled in the same native code, so data-dependent branches stay native
+*/
+
+namespace ptree {
+
+class LoopTrace {
+public:
+  //place in Block to continue from: operations[next] is the next statement
+  struct Frame {
+    const Block *block;
+    size_t next;
+  };
+  //statement of trace, guard when exit is not negative
+  struct Entry {
+    const PTree *unit;
+    int exit;
+  };
+  //guard on IfBlk condition
+  struct Exit {
+    const IfBlk *ifblk;
+    bool taken;
+    //enclosing blocks from loop body to IfBlk
+    std::vector<Frame> frames;
+    long count;
+    //index of side trace path, -1 if guard fail leaves native code
+    int side;
+  };
+
+private:
+  const WhileBlk *loop_;
+  //0 - main trace, other - side traces
+  std::vector<std::vector<Entry>> paths_;
+  std::vector<Exit> exits_;
+  std::unique_ptr<JitCode> code_;
+  std::vector<Frame> frames_;
+
+  //execute statement and append it to path
+  void record_stmt(const PTree *unit, Stack *stack, int path);
+  //execute and append statements left in frames_
+  void record_rest(Stack *stack, int path);
+  //interpret iteration from guard fail to its end
+  void resume(int exit, Stack *stack);
+  bool compile();
+
+public:
+  //iterations before trace recording, 0 disables tracing
+  static long threshold;
+  //max count of side traces in one loop
+  static int maxsides;
+  //statistics for --time-stamp
+  static int traces;
+  static int sidetraces;
+  static int failed;
+
+  LoopTrace(const WhileBlk *loop);
+  //return true if loop body has no nested loops
+  static bool traceable(const WhileBlk *loop);
+  //execute one iteration of loop body and record it, return false if trace can not be compiled
+  bool record(Stack *stack);
+  //run native loop, return true if loop is finished or false after interpreted side exit
+  bool run(Stack *stack);
+
+  const std::vector<std::vector<Entry>> &getpaths() const;
+  const std::vector<Exit> &getexits() const;
+};
+
+//tree walker of --trace-jit, loops keep their counters and traces here, so tree nodes
+//are not changed and other statements are executed by tree engine
+class TraceEngine {
+  struct LoopState {
+    long backedges = 0;
+    std::unique_ptr<LoopTrace> trace;
+  };
+  std::unordered_map<const WhileBlk *, LoopState> loops_;
+  //true if subtree has a while loop, subtrees without loops are executed by tree engine
+  std::unordered_map<const PTree *, bool> loopy_;
+
+  bool has_loop(const PTree *unit);
+  void execute(const PTree *unit, Stack *stack);
+  void loop(const WhileBlk *whileblock, Stack *stack);
+public:
+  //run program, stack should be created with MemManager::getmaxstacksize() size
+  void run(const PTree *root, Stack *stack);
+};
+
+//compiles LoopTrace to native loop, code returns 0 when loop condition fails
+//or (exit + 1) when guard without side trace fails
+class TraceCompiler : public JitCompiler {
+  const LoopTrace *trace_;
+  std::vector<int> exitlabels_;
+
+  void compile_path(int path, int head);
+public:
+  //return nullptr if trace can not be compiled, reason is kept in geterror()
+  std::unique_ptr<JitCode> compile(const WhileBlk *loop, const LoopTrace &trace);
+};
+
+}
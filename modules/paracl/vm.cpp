@@ -0,0 +1,360 @@
+#include "vm.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+namespace ptree {
+
+OpcodeProfile::OpcodeProfile(int ngram) : ngram_(ngram < 1 ? 1 : ngram) {}
+
+void OpcodeProfile::record(bytecode::Opcode op) {
+  window_.push_back(op);
+  if (window_.size() > ngram_)
+    window_.erase(window_.begin());
+  if (window_.size() == ngram_)
+    ++counts_[window_];
+}
+
+void OpcodeProfile::load(std::istream &in) {
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    long count;
+    std::string key, op;
+    if (!(fields >> count))
+      continue;
+    while (fields >> op)
+      key += (key.empty() ? "" : " ") + op;
+    loaded_[key] += count;
+  }
+}
+
+void OpcodeProfile::save(std::ostream &out) const {
+  std::map<std::string, long> merged = loaded_;
+  for (auto &it : counts_) {
+    std::string key;
+    for (auto op : it.first)
+      key += (key.empty() ? "" : " ") + bytecode::opcode_name(op);
+    merged[key] += it.second;
+  }
+  std::vector<std::pair<long, std::string>> sorted;
+  for (auto &it : merged)
+    sorted.emplace_back(it.second, it.first);
+  std::sort(sorted.begin(), sorted.end(), [](const std::pair<long, std::string> &lhs,
+                                             const std::pair<long, std::string> &rhs) {
+    return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+  });
+  for (auto &it : sorted)
+    out << it.first << " " << it.second << std::endl;
+}
+
+void StackVM::run(const bytecode::Program &program, Stack *stack) {
+  execute<false>(program, stack);
+}
+
+void StackVM::run(const bytecode::Program &program, Stack *stack, OpcodeProfile &profile) {
+  profile_ = &profile;
+  execute<true>(program, stack);
+  profile_ = nullptr;
+}
+
+template <bool Profiling> void StackVM::execute(const bytecode::Program &program, Stack *stack) {
+  using bytecode::Opcode;
+  // value stack is allocated once, so instructions do not make any allocation
+  values_.resize(program.maxdepth + 1);
+  int *sp = values_.data();
+  const bytecode::Instruction *code = program.code.data();
+  const bytecode::Instruction *ip = code;
+  int value;
+
+  for (;;) {
+    if (Profiling)
+      profile_->record(ip->op);
+    switch (ip->op) {
+    case Opcode::PUSH:
+      *++sp = ip->arg;
+      break;
+    case Opcode::LOAD:
+      stack->read(ip->arg, value);
+      *++sp = value;
+      break;
+    case Opcode::STORE:
+      stack->write(ip->arg, *sp--);
+      break;
+    case Opcode::DUP:
+      value = *sp;
+      *++sp = value;
+      break;
+    case Opcode::POP:
+      --sp;
+      break;
+    case Opcode::ADD:
+      value = *sp--;
+      *sp = *sp + value;
+      break;
+    case Opcode::SUB:
+      value = *sp--;
+      *sp = *sp - value;
+      break;
+    case Opcode::MUL:
+      value = *sp--;
+      *sp = *sp * value;
+      break;
+    case Opcode::DIV:
+      value = *sp--;
+      *sp = *sp / value;
+      break;
+    case Opcode::REM:
+      value = *sp--;
+      *sp = *sp % value;
+      break;
+    case Opcode::EQ:
+      value = *sp--;
+      *sp = *sp == value;
+      break;
+    case Opcode::GE:
+      value = *sp--;
+      *sp = *sp >= value;
+      break;
+    case Opcode::LE:
+      value = *sp--;
+      *sp = *sp <= value;
+      break;
+    case Opcode::NE:
+      value = *sp--;
+      *sp = *sp != value;
+      break;
+    case Opcode::GT:
+      value = *sp--;
+      *sp = *sp > value;
+      break;
+    case Opcode::LT:
+      value = *sp--;
+      *sp = *sp < value;
+      break;
+    case Opcode::AND:
+      value = *sp--;
+      *sp = *sp && value;
+      break;
+    case Opcode::OR:
+      value = *sp--;
+      *sp = *sp || value;
+      break;
+    case Opcode::SHL:
+      value = *sp--;
+      *sp = shift_left(*sp, value);
+      break;
+    case Opcode::SHR:
+      value = *sp--;
+      *sp = *sp >> value;
+      break;
+    case Opcode::BAND:
+      value = *sp--;
+      *sp = *sp & value;
+      break;
+    case Opcode::MULHI:
+      value = *sp--;
+      *sp = mul_high(*sp, value);
+      break;
+    case Opcode::NEG:
+      *sp = -*sp;
+      break;
+    case Opcode::NOT:
+      *sp = !*sp;
+      break;
+    case Opcode::INC:
+      stack->read(ip->arg, value);
+      stack->write(ip->arg, ++value);
+      *++sp = value;
+      break;
+    case Opcode::DEC:
+      stack->read(ip->arg, value);
+      stack->write(ip->arg, --value);
+      *++sp = value;
+      break;
+    case Opcode::INPUT:
+      *++sp = readint();
+      break;
+    case Opcode::PRINT:
+      std::cout << *sp-- << std::endl;
+      break;
+    case Opcode::JMP:
+      ip = code + ip->arg;
+      continue;
+    case Opcode::JZ:
+      if (*sp-- == 0) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::HALT:
+      return;
+    case Opcode::ADD_VC:
+      stack->read(ip->arg, value);
+      *++sp = value + ip->arg2;
+      break;
+    case Opcode::SUB_VC:
+      stack->read(ip->arg, value);
+      *++sp = value - ip->arg2;
+      break;
+    case Opcode::MUL_VC:
+      stack->read(ip->arg, value);
+      *++sp = value * ip->arg2;
+      break;
+    case Opcode::DIV_VC:
+      stack->read(ip->arg, value);
+      *++sp = value / ip->arg2;
+      break;
+    case Opcode::REM_VC:
+      stack->read(ip->arg, value);
+      *++sp = value % ip->arg2;
+      break;
+    case Opcode::SHL_VC:
+      stack->read(ip->arg, value);
+      *++sp = shift_left(value, ip->arg2);
+      break;
+    case Opcode::SHR_VC:
+      stack->read(ip->arg, value);
+      *++sp = value >> ip->arg2;
+      break;
+    case Opcode::BAND_VC:
+      stack->read(ip->arg, value);
+      *++sp = value & ip->arg2;
+      break;
+    case Opcode::MULHI_VC:
+      stack->read(ip->arg, value);
+      *++sp = mul_high(value, ip->arg2);
+      break;
+    case Opcode::EQ_VC:
+      stack->read(ip->arg, value);
+      *++sp = value == ip->arg2;
+      break;
+    case Opcode::NE_VC:
+      stack->read(ip->arg, value);
+      *++sp = value != ip->arg2;
+      break;
+    case Opcode::LT_VC:
+      stack->read(ip->arg, value);
+      *++sp = value < ip->arg2;
+      break;
+    case Opcode::GT_VC:
+      stack->read(ip->arg, value);
+      *++sp = value > ip->arg2;
+      break;
+    case Opcode::LE_VC:
+      stack->read(ip->arg, value);
+      *++sp = value <= ip->arg2;
+      break;
+    case Opcode::GE_VC:
+      stack->read(ip->arg, value);
+      *++sp = value >= ip->arg2;
+      break;
+    case Opcode::JEQ:
+      value = *sp--;
+      if (*sp-- == value) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JNE:
+      value = *sp--;
+      if (*sp-- != value) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JLT:
+      value = *sp--;
+      if (*sp-- < value) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JGT:
+      value = *sp--;
+      if (*sp-- > value) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JLE:
+      value = *sp--;
+      if (*sp-- <= value) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JGE:
+      value = *sp--;
+      if (*sp-- >= value) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JEQ_VC:
+      stack->read(ip->arg2, value);
+      if (value == ip->arg3) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JNE_VC:
+      stack->read(ip->arg2, value);
+      if (value != ip->arg3) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JLT_VC:
+      stack->read(ip->arg2, value);
+      if (value < ip->arg3) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JGT_VC:
+      stack->read(ip->arg2, value);
+      if (value > ip->arg3) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JLE_VC:
+      stack->read(ip->arg2, value);
+      if (value <= ip->arg3) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::JGE_VC:
+      stack->read(ip->arg2, value);
+      if (value >= ip->arg3) {
+        ip = code + ip->arg;
+        continue;
+      }
+      break;
+    case Opcode::STORE_C:
+      stack->write(ip->arg, ip->arg2);
+      break;
+    case Opcode::ADD_VC_STORE:
+      stack->read(ip->arg2, value);
+      stack->write(ip->arg, value + ip->arg3);
+      break;
+    case Opcode::INC_POP:
+      stack->read(ip->arg, value);
+      stack->write(ip->arg, ++value);
+      break;
+    case Opcode::DEC_POP:
+      stack->read(ip->arg, value);
+      stack->write(ip->arg, --value);
+      break;
+    default:
+      throw std::logic_error{"Unknown opcode in virtual machine"};
+    }
+    ++ip;
+  }
+}
+
+}
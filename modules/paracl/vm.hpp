@@ -0,0 +1,41 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "stack.hpp"
+
+#include <vector>
+#include <map>
+#include <iostream>
+
+namespace ptree {
+
+//histogram of executed opcode sequences (n-grams) with given length
+class OpcodeProfile {
+  size_t ngram_;
+  std::vector<bytecode::Opcode> window_;
+  std::map<std::vector<bytecode::Opcode>, long> counts_;
+  std::map<std::string, long> loaded_;
+public:
+  OpcodeProfile(int ngram = 2);
+  //add executed opcode
+  void record(bytecode::Opcode op);
+  //add histogram saved by previous runs
+  void load(std::istream &in);
+  //write histogram sorted by count, one "count opcodes..." line per n-gram
+  void save(std::ostream &out) const;
+};
+
+//stack machine which runs bytecode program, variables are kept in Stack
+class StackVM {
+  std::vector<int> values_;
+  OpcodeProfile *profile_ = nullptr;
+
+  template <bool Profiling> void execute(const bytecode::Program &program, Stack *stack);
+public:
+  //run program, stack should be created with MemManager::getmaxstacksize() size
+  void run(const bytecode::Program &program, Stack *stack);
+  //run program and record executed opcodes to profile
+  void run(const bytecode::Program &program, Stack *stack, OpcodeProfile &profile);
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "programs.hpp"
+
+#include <cstdlib>
+#include <new>
+
+//replaced operator new counts allocations of the thread only when enabled, so it is
+//linked only to alloctester and does not change allocations of other suites
+namespace alloctest {
+thread_local bool counting = false;
+long allocations = 0;
+}
+
+void *operator new(std::size_t size) {
+	if (alloctest::counting)
+		++alloctest::allocations;
+	if (void *ptr = std::malloc(size))
+		return ptr;
+	throw std::bad_alloc{};
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+TEST(Eval, ZeroAllocationTest) {
+	// x = 0; y = 0; while (x < 100) { if ((x % 2) == 0) y = y + x; else y--; x++; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", num(0)),
+		assign("y", num(0)),
+		loop(bin(BinOpType::LESS, var("x"), num(100)), block({
+			branch(bin(BinOpType::EQUAL, bin(BinOpType::REMAINDER, var("x"), num(2)), num(0)),
+				block({assign("y", bin(BinOpType::ADDITION, var("y"), var("x")))}),
+				block({dec("y")})),
+			inc("x"),
+		})),
+	});
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	ptree::Stack stack(memfunc.getmaxstacksize());
+
+	alloctest::allocations = 0;
+	alloctest::counting = true;
+	root->execute(&stack);
+	alloctest::counting = false;
+
+	ASSERT_EQ(alloctest::allocations, 0);
+	int y;
+	stack.read(4, y);
+	ASSERT_EQ(y, 2450 - 50);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/cgen.hpp"
+#include "programs.hpp"
+
+#include <climits>
+#include <csignal>
+
+//output of program translated to C and loaded as native code, printf writes to stdout directly
+inline std::string run_native(ptree::Block *root) {
+	ptree::CEmitter cemitter;
+	ptree::NativeCode code(cemitter.emit(root));
+	testing::internal::CaptureStdout();
+	code.run();
+	return testing::internal::GetCapturedStdout();
+}
+
+TEST(Native, SequencingTest) {
+	// x = 5; x = x++; print x; y = x++ + x; print y; x = (x = 3); print x; z = (x = x + 1) + x-- * (x = 2); print z;
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", num(5)),
+		assign("x", un(UnOpType::POST_ADDITION, var("x"))),
+		print(var("x")),
+		assign("y", bin(BinOpType::ADDITION, un(UnOpType::POST_ADDITION, var("x")), var("x"))),
+		print(var("y")),
+		assign("x", new ptree::Assign(nullptr, var("x"), num(3))),
+		print(var("x")),
+		assign("z", bin(BinOpType::ADDITION, new ptree::Assign(nullptr, var("x"), bin(BinOpType::ADDITION, var("x"), num(1))),
+		                bin(BinOpType::MULTIPLICATION, un(UnOpType::POST_SUBTRACTION, var("x")),
+		                    new ptree::Assign(nullptr, var("x"), num(2))))),
+		print(var("z")),
+		print(var("x")),
+	});
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	std::string expected = programs::run_tree(root, memfunc.getmaxstacksize(), "");
+	ASSERT_EQ(expected, "6\n14\n3\n10\n2\n");
+	ASSERT_EQ(run_native(root), expected);
+}
+
+TEST(Native, OverflowTest) {
+	// overflow wraps around as in the other engines, translation is compiled without -fwrapv
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", num(INT_MAX)),
+		assign("y", num(INT_MIN)),
+		print(bin(BinOpType::ADDITION, var("x"), num(1))),
+		print(bin(BinOpType::SUBTRACTION, var("y"), num(1))),
+		print(bin(BinOpType::MULTIPLICATION, var("x"), var("x"))),
+		print(un(UnOpType::MINUS, var("y"))),
+		print(bin(BinOpType::SHIFT_LEFT, var("x"), num(1))),
+		print(bin(BinOpType::DIVISION, var("y"), num(7))),
+		print(bin(BinOpType::REMAINDER, var("y"), num(7))),
+	});
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	std::string expected = programs::run_tree(root, memfunc.getmaxstacksize(), "");
+	ASSERT_EQ(expected, "-2147483648\n2147483647\n1\n-2147483648\n-2\n-306783378\n-2\n");
+	ASSERT_EQ(run_native(root), expected);
+}
+
+TEST(Native, DivisionTrapTest) {
+	// division by zero and INT_MIN / -1 raise SIGFPE as idiv of the interpreter
+	using namespace programs;
+	for (auto operation : {BinOpType::DIVISION, BinOpType::REMAINDER}) {
+		ptree::Block *zero = block({assign("x", num(5)), print(bin(operation, var("x"), num(0)))});
+		ptree::Block *overflow = block({assign("x", num(INT_MIN)), print(bin(operation, var("x"), num(-1)))});
+		for (ptree::Block *root : {zero, overflow}) {
+			ptree::manage_tree_mem(root);
+			ASSERT_EXIT(run_native(root), testing::KilledBySignal(SIGFPE), "");
+		}
+	}
+}
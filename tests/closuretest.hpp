@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/closure.hpp"
+#include "programs.hpp"
+
+TEST(Closure, TreeOutputTest) {
+	for (ptree::Block *root : {programs::arithmetic(), programs::loops()}) {
+		ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+		int stacksize = memfunc.getmaxstacksize();
+		std::string expected = programs::run_tree(root, stacksize, "17 -5 4");
+
+		ptree::closure::Stmt program = ptree::closure::compile_tree(root);
+		ASSERT_EQ(programs::run(stacksize, "17 -5 4", program), expected);
+		// closures keep no state between runs
+		ASSERT_EQ(programs::run(stacksize, "17 -5 4", program), expected);
+	}
+}
+
+TEST(Closure, DeepNestingTest) {
+	// s = 0; n = ?; if (n > 0) { s = s + 1; while (s < 3) { s = s + 2; if (n > 1) { ... } } print s; }
+	// with 100 levels, and print of expression ((((n + 1) - 2) + 3) ...) 1000 levels deep
+	using namespace programs;
+	ptree::Block *inner = block({print(var("s"))});
+	for (int level = 100; level > 0; --level) {
+		ptree::Block *body = block({
+			assign("s", bin(BinOpType::ADDITION, var("s"), num(level))),
+			loop(bin(BinOpType::LESS, var("s"), num(level * 3)),
+				block({assign("s", bin(BinOpType::ADDITION, var("s"), num(2)))})),
+			branch(bin(BinOpType::MORE, var("n"), num(level)), inner),
+		});
+		inner = block({branch(bin(BinOpType::MORE, var("n"), num(level - 1)), body), print(var("s"))});
+	}
+	ptree::PTree *expr = var("n");
+	for (int depth = 1; depth <= 1000; ++depth)
+		expr = bin(depth % 2 ? BinOpType::ADDITION : BinOpType::SUBTRACTION, expr, num(depth));
+	ptree::Block *root = block({assign("s", num(0)), assign("n", input()), inner, print(expr)});
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	int stacksize = memfunc.getmaxstacksize();
+	ptree::closure::Stmt program = ptree::closure::compile_tree(root);
+	for (const char *input : {"0", "37", "150"}) {
+		std::string expected = programs::run_tree(root, stacksize, input);
+		ASSERT_EQ(programs::run(stacksize, input, program), expected);
+	}
+}
+
+TEST(Closure, InputTest) {
+	// a = ?; b = ?; c = ?; print a; print b; print c; bad and missing input is 0 as in tree interpreter
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("a", input()), assign("b", input()), assign("c", input()),
+		print(var("a")), print(var("b")), print(var("c")),
+	});
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	int stacksize = memfunc.getmaxstacksize();
+	ptree::closure::Stmt program = ptree::closure::compile_tree(root);
+	for (std::string input : {"7", "7 x 9"}) {
+		ASSERT_EQ(programs::run_tree(root, stacksize, input), "7\n0\n0\n");
+		ASSERT_EQ(programs::run(stacksize, input, program), "7\n0\n0\n");
+	}
+}
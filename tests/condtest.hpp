@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/closure.hpp"
+#include "../modules/paracl/regvm.hpp"
+
+TEST(Condition, BranchTest) {
+	// c = 0; z = 0; i = 0; while (i < 10 && !(i == 7)) { if (i % 2 == 0 || z++ > 100) c = c + 1; i++; }
+	ptree::Block on_true;
+	on_true.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "c"),
+		new ptree::BinOp(ptree::BinOpType::ADDITION, nullptr, new ptree::NameInt(nullptr, 0, "c"), new ptree::Imidiate<int>(1)))));
+	ptree::Block body;
+	body.push_expression(new ptree::IfBlk(new ptree::Condition(nullptr,
+		new ptree::BinOp(ptree::BinOpType::LOG_OR, nullptr,
+			new ptree::BinOp(ptree::BinOpType::EQUAL, nullptr,
+				new ptree::BinOp(ptree::BinOpType::REMAINDER, nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::Imidiate<int>(2)),
+				new ptree::Imidiate<int>(0)),
+			new ptree::BinOp(ptree::BinOpType::MORE, nullptr,
+				new ptree::UnOp(ptree::UnOpType::POST_ADDITION, nullptr, new ptree::NameInt(nullptr, 0, "z")), new ptree::Imidiate<int>(100)))),
+		nullptr, nullptr, &on_true));
+	body.push_expression(new ptree::Expression(nullptr, new ptree::UnOp(ptree::UnOpType::POST_ADDITION, nullptr, new ptree::NameInt(nullptr, 0, "i"))));
+	ptree::Block root;
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "c"), new ptree::Imidiate<int>(0))));
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "z"), new ptree::Imidiate<int>(0))));
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::Imidiate<int>(0))));
+	root.push_expression(new ptree::WhileBlk(new ptree::Condition(nullptr,
+		new ptree::BinOp(ptree::BinOpType::LOG_AND, nullptr,
+			new ptree::BinOp(ptree::BinOpType::LESS, nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::Imidiate<int>(10)),
+			new ptree::UnOp(ptree::UnOpType::NOT, nullptr,
+				new ptree::BinOp(ptree::BinOpType::EQUAL, nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::Imidiate<int>(7))))),
+		nullptr, &body));
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(&root);
+	ptree::regcode::Program program = ptree::regcode::compile_tree(&root);
+	// loop condition becomes two compare and branch instructions, || is computed because z++ is never skipped
+	int branches = 0;
+	for (auto &instr : program.code)
+		if (instr.op >= ptree::regcode::Opcode::JEQ && instr.op <= ptree::regcode::Opcode::JGT)
+			++branches;
+	ASSERT_EQ(branches, 2);
+
+	ptree::Stack tree_stack(memfunc.getmaxstacksize());
+	root.execute(&tree_stack);
+	ptree::Stack closure_stack(memfunc.getmaxstacksize());
+	ptree::closure::compile_tree(&root)(&closure_stack);
+	ptree::Stack reg_stack(memfunc.getmaxstacksize());
+	ptree::RegisterVM machine;
+	machine.run(program, &reg_stack);
+	for (ptree::Stack *stack : {&tree_stack, &closure_stack, &reg_stack}) {
+		int c, z, i;
+		stack->read(0, c);
+		stack->read(4, z);
+		stack->read(8, i);
+		ASSERT_EQ(c, 4);
+		ASSERT_EQ(z, 7);
+		ASSERT_EQ(i, 7);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/dce.hpp"
+#include "programs.hpp"
+
+TEST(Dce, DeadStoreTest) {
+	// x = ?; y = x * 2; z = 5; if (0) print y; print x;
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", input()),
+		assign("y", bin(BinOpType::MULTIPLICATION, var("x"), num(2))),
+		assign("z", num(5)),
+		branch(num(0), block({print(var("y"))})),
+		print(var("x")),
+	});
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::DeadCodeElimination elimination(function);
+	elimination.run();
+	ASSERT_EQ(elimination.getunreachable(), 1);
+	// print of y is unreachable, so y is a dead store
+	ASSERT_GE(elimination.getremoved(), 1);
+	for (auto &instr : function.instrs) {
+		if (instr.block >= 0) {
+			ASSERT_NE(instr.binop, ptree::BinOpType::MULTIPLICATION);
+		}
+	}
+
+	// only x keeps its slot
+	int stacksize = 0;
+	ptree::ssa::rebuild_tree(function, stacksize);
+	ASSERT_EQ(memfunc.getmaxstacksize(), 12);
+	ASSERT_EQ(stacksize, 4);
+}
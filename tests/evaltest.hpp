@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+
+TEST(Eval, ExpressionTest) {
+	ptree::NameInt *a = new ptree::NameInt(nullptr, 0, "a");
+	ptree::Block root;
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, a, new ptree::Imidiate<int>(7))));
+	ptree::MemManager memfunc = ptree::manage_tree_mem(&root);
+	ptree::Stack stack(memfunc.getmaxstacksize());
+	root.execute(&stack);
+
+	ptree::BinOp mul(ptree::BinOpType::MULTIPLICATION, nullptr, new ptree::NameInt(nullptr, 0, 0, a->getoffset(), "a"), new ptree::Imidiate<int>(3));
+	ASSERT_EQ(mul.eval(&stack), 21);
+	ptree::UnOp neg(ptree::UnOpType::NOT, nullptr, new ptree::Imidiate<int>(0));
+	ASSERT_EQ(neg.eval(&stack), 1);
+}
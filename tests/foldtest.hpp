@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/fold.hpp"
+#include "programs.hpp"
+
+TEST(Fold, RulesTest) {
+	// y = (x + 1) + 1; z = x * 1 + 2 * 3; w = !!(x < y); u = x / 0;
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", num(5)),
+		assign("y", bin(BinOpType::ADDITION, bin(BinOpType::ADDITION, var("x"), num(1)), num(1))),
+		assign("z", bin(BinOpType::ADDITION, bin(BinOpType::MULTIPLICATION, var("x"), num(1)), bin(BinOpType::MULTIPLICATION, num(2), num(3)))),
+		assign("w", un(UnOpType::NOT, un(UnOpType::NOT, bin(BinOpType::LESS, var("x"), var("y"))))),
+		assign("u", bin(BinOpType::DIVISION, var("x"), num(0))),
+	});
+	ptree::manage_tree_mem(root);
+	// assignments stay in place, folder rewrites their values
+	auto y = root->operations[1]->getright(), z = root->operations[2]->getright();
+	auto w = root->operations[3]->getright(), u = root->operations[4]->getright();
+
+	ptree::Folder folder;
+	ASSERT_EQ(folder.rewrite(root), root);
+	// (x + 1) + 1 -> x + 2
+	auto sum = dynamic_cast<ptree::BinOp *>(y->getright());
+	ASSERT_NE(sum, nullptr);
+	ASSERT_NE(dynamic_cast<ptree::NameInt *>(sum->getleft()), nullptr);
+	ASSERT_EQ(dynamic_cast<ptree::Imidiate<int> *>(sum->getright())->getvalue(), 2);
+	// x * 1 + 2 * 3 -> x + 6
+	sum = dynamic_cast<ptree::BinOp *>(z->getright());
+	ASSERT_NE(sum, nullptr);
+	ASSERT_NE(dynamic_cast<ptree::NameInt *>(sum->getleft()), nullptr);
+	ASSERT_EQ(dynamic_cast<ptree::Imidiate<int> *>(sum->getright())->getvalue(), 6);
+	// !!(x < y) -> x < y
+	auto compare = dynamic_cast<ptree::BinOp *>(w->getright());
+	ASSERT_NE(compare, nullptr);
+	ASSERT_EQ(compare->operation_, ptree::BinOpType::LESS);
+	// division by zero traps at run time, it is not folded
+	ASSERT_NE(dynamic_cast<ptree::BinOp *>(u->getright()), nullptr);
+	ASSERT_FALSE(folder.getapplied().empty());
+}
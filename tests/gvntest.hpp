@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/gvn.hpp"
+#include "programs.hpp"
+
+TEST(Gvn, RedundancyTest) {
+	// x = 7; a = x % 3; b = (3 > x) + x % 3; d = x < 3; x++; c = x % 3;
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", num(7)),
+		assign("a", bin(BinOpType::REMAINDER, var("x"), num(3))),
+		assign("b", bin(BinOpType::ADDITION, bin(BinOpType::MORE, num(3), var("x")), bin(BinOpType::REMAINDER, var("x"), num(3)))),
+		assign("d", bin(BinOpType::LESS, var("x"), num(3))),
+		inc("x"),
+		assign("c", bin(BinOpType::REMAINDER, var("x"), num(3))),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::ValueNumbering numbering(function);
+	numbering.run();
+	// second x % 3 and x < 3 are reused, x % 3 after x++ is a new value
+	ASSERT_EQ(numbering.getremoved(), 2);
+	int remainders = 0;
+	for (auto &instr : function.instrs)
+		remainders += instr.block >= 0 && instr.binop == ptree::BinOpType::REMAINDER;
+	ASSERT_EQ(remainders, 2);
+}
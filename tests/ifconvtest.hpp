@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/ifconv.hpp"
+#include "programs.hpp"
+
+TEST(IfConv, SelectTest) {
+	// y = 0; x = 0; while (x < 6) { if (x % 2 == 0) y = y + x; else y = y - 1; if (x > 4) print x; x = x + 1; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("y", num(0)),
+		assign("x", num(0)),
+		loop(bin(BinOpType::LESS, var("x"), num(6)), block({
+			branch(bin(BinOpType::EQUAL, bin(BinOpType::REMAINDER, var("x"), num(2)), num(0)),
+				block({assign("y", bin(BinOpType::ADDITION, var("y"), var("x")))}),
+				block({assign("y", bin(BinOpType::SUBTRACTION, var("y"), num(1)))})),
+			branch(bin(BinOpType::MORE, var("x"), num(4)), block({print(var("x"))})),
+			assign("x", bin(BinOpType::ADDITION, var("x"), num(1))),
+		})),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::IfConversion conversion(function);
+	conversion.run();
+	// if with print keeps its branch
+	ASSERT_EQ(conversion.getconverted(), 1);
+	ASSERT_EQ(conversion.getselects(), 1);
+
+	int stacksize = 0;
+	ptree::Block *rebuilt = ptree::ssa::rebuild_tree(function, stacksize);
+	ptree::Stack stack(stacksize);
+	testing::internal::CaptureStdout();
+	rebuilt->execute(&stack);
+	ASSERT_EQ(testing::internal::GetCapturedStdout(), "5\n");
+	int y;
+	stack.read(0, y);
+	// 0 - 1 + 2 - 1 + 4 - 1
+	ASSERT_EQ(y, 3);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/jit.hpp"
+#include "programs.hpp"
+
+#include <climits>
+#include <csignal>
+
+TEST(Jit, TreeOutputTest) {
+	for (ptree::Block *root : {programs::arithmetic(), programs::loops()}) {
+		ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+		int stacksize = memfunc.getmaxstacksize();
+		std::string expected = programs::run_tree(root, stacksize, "17 -5 4");
+
+		ptree::JitCompiler compiler;
+		std::unique_ptr<ptree::JitCode> code = compiler.compile(root);
+#ifdef PCL_JIT_X86_64
+		ASSERT_NE(code, nullptr) << compiler.geterror();
+		ASSERT_EQ(programs::run(stacksize, "17 -5 4", [&](ptree::Stack *stack) { code->run(stack); }), expected);
+#else
+		ASSERT_EQ(code, nullptr);
+#endif
+	}
+}
+
+TEST(Jit, UnsupportedTest) {
+	// print x; reads variable which is never declared
+	ptree::Block *root = programs::block({programs::print(new ptree::NameInt(nullptr, 0, 0, -1, "x"))});
+	ptree::JitCompiler compiler;
+	ASSERT_EQ(compiler.compile(root), nullptr);
+	ASSERT_FALSE(compiler.geterror().empty());
+}
+
+#ifdef PCL_JIT_X86_64
+TEST(Jit, LargeImmediateTest) {
+	// constants which do not fit in 8 bit fields of instructions
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", num(INT_MAX)),
+		assign("y", num(INT_MIN)),
+		print(var("x")),
+		print(var("y")),
+		print(bin(BinOpType::SUBTRACTION, var("x"), num(1000000007))),
+		print(bin(BinOpType::ADDITION, var("y"), num(65536))),
+		print(bin(BinOpType::MULTIPLICATION, num(32767), num(65536))),
+		print(bin(BinOpType::DIVISION, var("y"), num(-1000000007))),
+		print(bin(BinOpType::REMAINDER, var("x"), num(1000000007))),
+		print(bin(BinOpType::LESS, var("y"), num(-2147483647))),
+		print(bin(BinOpType::EQUAL, var("x"), num(INT_MAX))),
+	});
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	int stacksize = memfunc.getmaxstacksize();
+	ptree::JitCompiler compiler;
+	std::unique_ptr<ptree::JitCode> code = compiler.compile(root);
+	ASSERT_NE(code, nullptr) << compiler.geterror();
+	std::string expected = programs::run_tree(root, stacksize, "");
+	ASSERT_EQ(expected, "2147483647\n-2147483648\n1147483640\n-2147418112\n2147418112\n2\n147483633\n1\n1\n");
+	ASSERT_EQ(programs::run(stacksize, "", [&](ptree::Stack *stack) { code->run(stack); }), expected);
+}
+
+TEST(Jit, DivisionTrapTest) {
+	// n = ?; d = ?; print n / d; traps like the interpreter on zero and on INT_MIN / -1
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("n", input()),
+		assign("d", input()),
+		print(bin(BinOpType::DIVISION, var("n"), var("d"))),
+	});
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	int stacksize = memfunc.getmaxstacksize();
+	ptree::JitCompiler compiler;
+	std::unique_ptr<ptree::JitCode> code = compiler.compile(root);
+	ASSERT_NE(code, nullptr) << compiler.geterror();
+	auto run = [&](const std::string &input) { programs::run(stacksize, input, [&](ptree::Stack *stack) { code->run(stack); }); };
+	ASSERT_EQ(programs::run(stacksize, "-7 2", [&](ptree::Stack *stack) { code->run(stack); }), "-3\n");
+	ASSERT_EXIT(run("5 0"), testing::KilledBySignal(SIGFPE), "");
+	ASSERT_EXIT(run("-2147483648 -1"), testing::KilledBySignal(SIGFPE), "");
+}
+#endif
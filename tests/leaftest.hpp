@@ -13,7 +13,7 @@ TEST(PTree, MainTest) {
 TEST(Leaf, MainTest) {
 	ptree::Leaf leaf;
 	ASSERT_TRUE(leaf.isLeaf());
-	ASSERT_EQ(leaf.execute(), &leaf);
+	ASSERT_EQ(leaf.execute(nullptr), nullptr);
 }
 
 TEST(LeafImidiate, ConstructorTestInt) {
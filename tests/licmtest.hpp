@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/licm.hpp"
+#include "programs.hpp"
+
+TEST(Licm, UnswitchTest) {
+	// s = 0; i = 0; n = i + 5; while (i < 3) { if (n > 1) s = s + n * 2; else s = s - 1; i = i + 1; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("s", num(0)),
+		assign("i", num(0)),
+		assign("n", bin(BinOpType::ADDITION, var("i"), num(5))),
+		loop(bin(BinOpType::LESS, var("i"), num(3)), block({
+			branch(bin(BinOpType::MORE, var("n"), num(1)),
+				block({assign("s", bin(BinOpType::ADDITION, var("s"), bin(BinOpType::MULTIPLICATION, var("n"), num(2))))}),
+				block({assign("s", bin(BinOpType::SUBTRACTION, var("s"), num(1)))})),
+			assign("i", bin(BinOpType::ADDITION, var("i"), num(1))),
+		})),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::LoopInvariantMotion motion(function);
+	motion.run();
+	// n > 1 and n * 2 leave the loop, then loop is copied for both values of n > 1
+	ASSERT_EQ(motion.gethoisted(), 2);
+	ASSERT_EQ(motion.getunswitched(), 1);
+	int loops = 0;
+	for (auto &region : function.body)
+		for (auto &arm : region.arms)
+			for (auto &inner : arm)
+				loops += inner.kind == ptree::ssa::Region::Kind::While;
+	ASSERT_EQ(loops, 2);
+
+	int stacksize = 0;
+	ptree::Block *rebuilt = ptree::ssa::rebuild_tree(function, stacksize);
+	ptree::Stack stack(stacksize);
+	rebuilt->execute(&stack);
+	int s;
+	stack.read(0, s);
+	ASSERT_EQ(s, 30);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/llvm_jit.hpp"
+#include "programs.hpp"
+
+#include <csignal>
+
+TEST(LlvmJit, LoopTest) {
+	// s = 0; i = 0; while (i < 10) { s = s + i; i++; }
+	ptree::Block *root = programs::sum(10);
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	for (int optlevel = 0; optlevel <= 3; ++optlevel) {
+		ptree::LlvmCompiler compiler(optlevel);
+		std::unique_ptr<ptree::LlvmCode> code = compiler.compile(root);
+		if (!ptree::LlvmCompiler::available()) {
+			ASSERT_FALSE(code);
+			return;
+		}
+		ASSERT_TRUE(code) << compiler.geterror();
+		ptree::Stack stack(memfunc.getmaxstacksize());
+		code->run(&stack);
+		int s, i;
+		stack.read(0, s);
+		stack.read(4, i);
+		ASSERT_EQ(s, 45);
+		ASSERT_EQ(i, 10);
+	}
+}
+
+TEST(LlvmJit, DivisionTrapTest) {
+	// n = ?; d = ?; print n / d; print n % d; traps like the interpreter on zero and on INT_MIN / -1
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("n", input()),
+		assign("d", input()),
+		print(bin(BinOpType::DIVISION, var("n"), var("d"))),
+		print(bin(BinOpType::REMAINDER, var("n"), var("d"))),
+	});
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	int stacksize = memfunc.getmaxstacksize();
+	ptree::LlvmCompiler compiler;
+	std::unique_ptr<ptree::LlvmCode> code = compiler.compile(root);
+	if (!ptree::LlvmCompiler::available()) {
+		ASSERT_FALSE(code);
+		return;
+	}
+	ASSERT_TRUE(code) << compiler.geterror();
+	auto run = [&](const std::string &input) { return programs::run(stacksize, input, [&](ptree::Stack *stack) { code->run(stack); }); };
+	ASSERT_EQ(run("-7 2"), "-3\n-1\n");
+	ASSERT_EQ(run("-2147483648 1"), "-2147483648\n0\n");
+	ASSERT_EXIT(run("5 0"), testing::KilledBySignal(SIGFPE), "");
+	ASSERT_EXIT(run("-2147483648 -1"), testing::KilledBySignal(SIGFPE), "");
+}
@@ -5,7 +5,8 @@
 #include "../modules/paracl/nonleaf.hpp"
 
 TEST(NonLeaf, ConstructTest) {
-  ptree::NonLeaf r{nullptr, nullptr, nullptr};
+  // NonLeaf is abstract, expression is its simplest node
+  ptree::Expression r{nullptr, nullptr};
   std::string res = r.dump();
   ASSERT_FALSE(r.isLeaf());
 }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/passes.hpp"
+#include "programs.hpp"
+
+TEST(Passes, PipelineTest) {
+	// x = 2; print x + 3;
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("x", num(2)),
+		print(bin(BinOpType::ADDITION, var("x"), num(3))),
+	});
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	int stacksize = memfunc.getmaxstacksize();
+
+	ptree::PassManager passmanager;
+	ASSERT_THROW(passmanager.add("nosuchpass"), std::invalid_argument);
+	ASSERT_THROW(passmanager.add_level(3), std::invalid_argument);
+	passmanager.parse("ssa,ssa");
+	ASSERT_EQ(ptree::count_nodes(root), 10);
+	ptree::PTree *result = passmanager.run(root, stacksize);
+	ASSERT_EQ(passmanager.gettimings().size(), 2);
+	ASSERT_EQ(passmanager.gettimings()[0].before, 10);
+	ASSERT_TRUE(passmanager.gettimings()[1].error.empty());
+	ASSERT_EQ(passmanager.gettimings()[1].after, ptree::count_nodes(result));
+	// x is a constant, its slot is not used any more
+	ASSERT_LE(stacksize, memfunc.getmaxstacksize());
+	ptree::delete_tree(result);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/profile.hpp"
+#include "programs.hpp"
+
+#include <climits>
+#include <csignal>
+#include <sstream>
+
+TEST(Profile, GuideTest) {
+	// s = 0; h = 0; d = 5; i = 0; while (i < 100) { if (i % 8 == 0) h = h + 1; else s = s + i / d; i = i + 1; }
+	ptree::Block on_true;
+	on_true.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "h"),
+		new ptree::BinOp(ptree::BinOpType::ADDITION, nullptr, new ptree::NameInt(nullptr, 0, "h"), new ptree::Imidiate<int>(1)))));
+	ptree::Block on_false;
+	on_false.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "s"),
+		new ptree::BinOp(ptree::BinOpType::ADDITION, nullptr, new ptree::NameInt(nullptr, 0, "s"),
+			new ptree::BinOp(ptree::BinOpType::DIVISION, nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::NameInt(nullptr, 0, "d"))))));
+	ptree::Block body;
+	body.push_expression(new ptree::IfBlk(new ptree::Condition(nullptr,
+		new ptree::BinOp(ptree::BinOpType::EQUAL, nullptr,
+			new ptree::BinOp(ptree::BinOpType::REMAINDER, nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::Imidiate<int>(8)),
+			new ptree::Imidiate<int>(0))),
+		nullptr, &on_false, &on_true));
+	body.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "i"),
+		new ptree::BinOp(ptree::BinOpType::ADDITION, nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::Imidiate<int>(1)))));
+	ptree::Block root;
+	for (auto init : {std::make_pair("s", 0), std::make_pair("h", 0), std::make_pair("d", 5), std::make_pair("i", 0)})
+		root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, init.first),
+			new ptree::Imidiate<int>(init.second))));
+	root.push_expression(new ptree::WhileBlk(new ptree::Condition(nullptr,
+		new ptree::BinOp(ptree::BinOpType::LESS, nullptr, new ptree::NameInt(nullptr, 0, "i"), new ptree::Imidiate<int>(100))),
+		nullptr, &body));
+
+	std::map<const ptree::PTree *, int> ids = ptree::number_nodes(&root);
+	ptree::MemManager memfunc = ptree::manage_tree_mem(&root);
+	ptree::Profile profile;
+	ptree::Stack profile_stack(memfunc.getmaxstacksize());
+	ptree::Profiler(profile, ids).run(&root, &profile_stack);
+	ASSERT_EQ(profile.branches.begin()->second.taken, 13);
+	ASSERT_EQ(profile.loops.begin()->second.iterations, 100);
+
+	// saved profile is read back without changes
+	std::stringstream saved;
+	profile.save(saved);
+	ptree::Profile loaded;
+	loaded.load(saved);
+	std::stringstream resaved;
+	loaded.save(resaved);
+	ASSERT_EQ(saved.str(), resaved.str());
+
+	// both copies of versioned loop get hot else arm first and are unrolled by 4
+	ptree::ProfileGuide guide(loaded, ids);
+	guide.run(&root);
+	ASSERT_EQ(guide.report(), "Profile: 2 if reordered, 1 loops versioned, 2 loops unrolled");
+	ptree::Stack stack(memfunc.getmaxstacksize());
+	root.execute(&stack);
+	int s, h, i;
+	stack.read(0, s);
+	stack.read(4, h);
+	stack.read(12, i);
+	ASSERT_EQ(s, 830);
+	ASSERT_EQ(h, 13);
+	ASSERT_EQ(i, 100);
+}
+
+TEST(Profile, ArithmeticTest) {
+	// negation wraps around and division traps with SIGFPE as in engines
+	using namespace programs;
+	auto profile_run = [](ptree::Block *root) {
+		std::map<const ptree::PTree *, int> ids = ptree::number_nodes(root);
+		ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+		ptree::Profile profile;
+		ptree::Stack stack(memfunc.getmaxstacksize());
+		testing::internal::CaptureStdout();
+		ptree::Profiler(profile, ids).run(root, &stack);
+		return testing::internal::GetCapturedStdout();
+	};
+	ASSERT_EQ(profile_run(block({assign("x", num(INT_MIN)), print(un(UnOpType::MINUS, var("x")))})), "-2147483648\n");
+	ptree::Block *zero = block({assign("x", num(0)), print(bin(BinOpType::DIVISION, num(5), var("x")))});
+	ASSERT_EXIT(profile_run(zero), testing::KilledBySignal(SIGFPE), "");
+}
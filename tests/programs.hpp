@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+//small programs for engine tests and runner which compares engines by their output
+namespace programs {
+
+inline ptree::NameInt *var(const char *name) { return new ptree::NameInt(nullptr, 0, name); }
+inline ptree::Imidiate<int> *num(int value) { return new ptree::Imidiate<int>(value); }
+inline ptree::Reserved *input() { return new ptree::Reserved(nullptr, ptree::Reserved::Types::Input); }
+inline ptree::BinOp *bin(ptree::BinOpType operation, ptree::PTree *lhs, ptree::PTree *rhs) {
+	return new ptree::BinOp(operation, nullptr, lhs, rhs);
+}
+inline ptree::UnOp *un(ptree::UnOpType operation, ptree::PTree *operand) { return new ptree::UnOp(operation, nullptr, operand); }
+inline ptree::PTree *assign(const char *name, ptree::PTree *value) {
+	return new ptree::Expression(nullptr, new ptree::Assign(nullptr, var(name), value));
+}
+inline ptree::PTree *print(ptree::PTree *value) { return new ptree::Expression(nullptr, new ptree::Output(nullptr, value)); }
+inline ptree::PTree *inc(const char *name) {
+	return new ptree::Expression(nullptr, un(ptree::UnOpType::POST_ADDITION, var(name)));
+}
+inline ptree::PTree *dec(const char *name) {
+	return new ptree::Expression(nullptr, un(ptree::UnOpType::POST_SUBTRACTION, var(name)));
+}
+inline ptree::Block *block(std::initializer_list<ptree::PTree *> operations) {
+	ptree::Block *res = new ptree::Block;
+	for (auto operation : operations)
+		res->push_expression(operation);
+	return res;
+}
+inline ptree::PTree *loop(ptree::PTree *condition, ptree::Block *body) {
+	return new ptree::WhileBlk(new ptree::Condition(nullptr, condition), nullptr, body);
+}
+inline ptree::PTree *branch(ptree::PTree *condition, ptree::Block *then_blk, ptree::Block *else_blk = nullptr) {
+	return new ptree::IfBlk(new ptree::Condition(nullptr, condition), nullptr, else_blk, then_blk);
+}
+
+using ptree::BinOpType;
+using ptree::UnOpType;
+
+//s = 0; i = 0; while (i < n) { s = s + i; i++; }
+inline ptree::Block *sum(int n) {
+	return block({
+		assign("s", num(0)),
+		assign("i", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(n)), block({
+			assign("s", bin(BinOpType::ADDITION, var("s"), var("i"))),
+			inc("i"),
+		})),
+	});
+}
+
+//n = ?; d = ?; print of division and remainder with negative operands, comparisons and logical operations
+inline ptree::Block *arithmetic() {
+	return block({
+		assign("n", input()),
+		assign("d", input()),
+		print(bin(BinOpType::DIVISION, var("n"), var("d"))),
+		print(bin(BinOpType::REMAINDER, var("n"), var("d"))),
+		print(bin(BinOpType::DIVISION, un(UnOpType::MINUS, var("n")), var("d"))),
+		print(bin(BinOpType::REMAINDER, var("n"), un(UnOpType::MINUS, var("d")))),
+		print(bin(BinOpType::REMAINDER, un(UnOpType::MINUS, var("n")), un(UnOpType::MINUS, var("d")))),
+		print(bin(BinOpType::DIVISION, num(-100), var("d"))),
+		print(bin(BinOpType::REMAINDER, num(-100), num(7))),
+		print(bin(BinOpType::ADDITION, bin(BinOpType::MULTIPLICATION, var("n"), var("d")), bin(BinOpType::SUBTRACTION, num(3), var("n")))),
+		print(bin(BinOpType::LESS, var("n"), var("d"))),
+		print(bin(BinOpType::LESS_EQUAL, var("d"), var("n"))),
+		print(bin(BinOpType::MORE, var("n"), num(17))),
+		print(bin(BinOpType::MORE_EQUAL, var("n"), num(17))),
+		print(bin(BinOpType::EQUAL, var("d"), num(-5))),
+		print(bin(BinOpType::NON_EQUAL, var("d"), num(-5))),
+		print(bin(BinOpType::LOG_AND, var("n"), num(0))),
+		print(bin(BinOpType::LOG_OR, num(0), var("d"))),
+		print(un(UnOpType::NOT, var("n"))),
+		print(bin(BinOpType::MULTIPLICATION, input(), var("n"))),
+	});
+}
+
+//a = 0; i = -5; while (i < 6) { if (i != 0) { a = a + 100 / i; print a % i; } else print 0;
+//j = 0; while (j < 3 && i != 2) { if (j > 1 || i < -3) a = a - j * i; j++; } i++; } print a;
+inline ptree::Block *loops() {
+	ptree::Block *inner = block({
+		branch(bin(BinOpType::LOG_OR, bin(BinOpType::MORE, var("j"), num(1)), bin(BinOpType::LESS, var("i"), num(-3))),
+			block({assign("a", bin(BinOpType::SUBTRACTION, var("a"), bin(BinOpType::MULTIPLICATION, var("j"), var("i"))))})),
+		inc("j"),
+	});
+	ptree::Block *body = block({
+		branch(bin(BinOpType::NON_EQUAL, var("i"), num(0)),
+			block({
+				assign("a", bin(BinOpType::ADDITION, var("a"), bin(BinOpType::DIVISION, num(100), var("i")))),
+				print(bin(BinOpType::REMAINDER, var("a"), var("i"))),
+			}),
+			block({print(num(0))})),
+		assign("j", num(0)),
+		loop(bin(BinOpType::LOG_AND, bin(BinOpType::LESS, var("j"), num(3)), bin(BinOpType::NON_EQUAL, var("i"), num(2))), inner),
+		inc("i"),
+	});
+	return block({
+		assign("a", num(0)),
+		assign("i", num(-5)),
+		loop(bin(BinOpType::LESS, var("i"), num(6)), body),
+		print(var("a")),
+	});
+}
+
+//run engine on new stack with given input, return its output
+inline std::string run(int stacksize, const std::string &input, const std::function<void(ptree::Stack *)> &engine) {
+	std::istringstream in(input);
+	std::ostringstream out;
+	std::streambuf *cin_buf = std::cin.rdbuf(in.rdbuf());
+	std::streambuf *cout_buf = std::cout.rdbuf(out.rdbuf());
+	ptree::Stack stack(stacksize);
+	try {
+		engine(&stack);
+	} catch (...) {
+		std::cin.rdbuf(cin_buf);
+		std::cout.rdbuf(cout_buf);
+		throw;
+	}
+	std::cin.rdbuf(cin_buf);
+	std::cout.rdbuf(cout_buf);
+	return out.str();
+}
+
+//output of tree interpreter
+inline std::string run_tree(ptree::Block *root, int stacksize, const std::string &input) {
+	return run(stacksize, input, [root](ptree::Stack *stack) { root->execute(stack); });
+}
+
+}
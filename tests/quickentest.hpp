@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+
+TEST(Quicken, RequickenTest) {
+	// a = -7; b = 3;
+	ptree::NameInt *a = new ptree::NameInt(nullptr, 0, "a");
+	ptree::NameInt *b = new ptree::NameInt(nullptr, 0, "b");
+	ptree::Block root;
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, a, new ptree::Imidiate<int>(-7))));
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, b, new ptree::Imidiate<int>(3))));
+	ptree::MemManager memfunc = ptree::manage_tree_mem(&root);
+	ptree::Stack stack(memfunc.getmaxstacksize());
+	root.execute(&stack);
+	auto var = [](ptree::NameInt *name) { return new ptree::NameInt(nullptr, 0, 0, name->getoffset(), name->getvarname()); };
+
+	// a % 2 is specialised to variable op constant after the first evaluation
+	ptree::BinOp rem(ptree::BinOpType::REMAINDER, nullptr, var(a), new ptree::Imidiate<int>(2));
+	ASSERT_FALSE(rem.isquickened());
+	ASSERT_EQ(rem.eval(&stack), -1);
+	ASSERT_TRUE(rem.isquickened());
+	ASSERT_EQ(rem.eval(&stack), -1);
+
+	// operand becomes variable, node is specialised again for new kinds
+	rem.setright(var(b));
+	rem.dequicken();
+	ASSERT_EQ(rem.eval(&stack), -1);
+	ASSERT_TRUE(rem.isquickened());
+	rem.setleft(new ptree::Imidiate<int>(8));
+	rem.dequicken();
+	ASSERT_EQ(rem.eval(&stack), 2);
+	ASSERT_TRUE(rem.isquickened());
+
+	// nested operand has no specialisation, generic evaluation gives the same results
+	rem.setleft(new ptree::BinOp(ptree::BinOpType::SUBTRACTION, nullptr, var(a), new ptree::Imidiate<int>(1)));
+	rem.dequicken();
+	ASSERT_EQ(rem.eval(&stack), -2);
+	ASSERT_FALSE(rem.isquickened());
+
+	// specialised nodes agree with generic operate on every operation
+	for (auto operation : {ptree::BinOpType::ADDITION, ptree::BinOpType::SUBTRACTION, ptree::BinOpType::MULTIPLICATION,
+	                       ptree::BinOpType::DIVISION, ptree::BinOpType::REMAINDER, ptree::BinOpType::LESS,
+	                       ptree::BinOpType::NON_EQUAL, ptree::BinOpType::LOG_AND, ptree::BinOpType::LOG_OR}) {
+		ptree::BinOp varvar(operation, nullptr, var(a), var(b));
+		ptree::BinOp constvar(operation, nullptr, new ptree::Imidiate<int>(-7), var(b));
+		for (ptree::BinOp *binop : {&varvar, &constvar}) {
+			ASSERT_EQ(binop->eval(&stack), ptree::operate<int>(-7, 3, operation));
+			ASSERT_TRUE(binop->isquickened());
+			ASSERT_EQ(binop->eval(&stack), ptree::operate<int>(-7, 3, operation));
+		}
+	}
+}
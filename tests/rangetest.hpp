@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/range.hpp"
+#include "../modules/paracl/passes.hpp"
+#include "../modules/paracl/cgen.hpp"
+#include "programs.hpp"
+
+TEST(Range, DivisionTest) {
+	// s = 0; i = 0; while (i < 10) { if (i != 0) s = s + 100 / i; t = 5 / (i - 3); i = i + 1; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("s", num(0)),
+		assign("i", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(10)), block({
+			branch(bin(BinOpType::NON_EQUAL, var("i"), num(0)),
+				block({assign("s", bin(BinOpType::ADDITION, var("s"), bin(BinOpType::DIVISION, num(100), var("i"))))})),
+			assign("t", bin(BinOpType::DIVISION, num(5), bin(BinOpType::SUBTRACTION, var("i"), num(3)))),
+			assign("i", bin(BinOpType::ADDITION, var("i"), num(1))),
+		})),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::RangeAnalysis analysis(function);
+	analysis.run();
+	// i is in [0, 9] in loop body, so 100 / i is safe under i != 0 and i - 3 can be 0
+	ASSERT_EQ(analysis.getdivisions(), 2);
+	ASSERT_EQ(analysis.getsafe(), 1);
+	std::string report = analysis.report();
+	ASSERT_NE(report.find("; t: divisor [-3, 6] can be 0"), std::string::npos);
+	// i + 1 and i - 3 can not wrap, sum s grows without bound
+	ASSERT_EQ(analysis.getarithmetic(), 3);
+	ASSERT_EQ(analysis.getnowrap(), 2);
+	ASSERT_NE(report.find("; s: result"), std::string::npos);
+}
+
+TEST(Range, SafeDivisionTest) {
+	// i = 0; while (i < 10) { print 100 / (i + 1); print 5 % (i - 3); i = i + 1; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("i", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(10)), block({
+			print(bin(BinOpType::DIVISION, num(100), bin(BinOpType::ADDITION, var("i"), num(1)))),
+			print(bin(BinOpType::REMAINDER, num(5), bin(BinOpType::SUBTRACTION, var("i"), num(3)))),
+			assign("i", bin(BinOpType::ADDITION, var("i"), num(1))),
+		})),
+	});
+
+	int stacksize = ptree::manage_tree_mem(root).getmaxstacksize();
+	ptree::PassManager passmanager;
+	passmanager.add("range");
+	ptree::PTree *result = passmanager.run(root, stacksize);
+	ptree::CEmitter cemitter;
+	std::string source = cemitter.emit(result);
+	// divisor i + 1 is in [1, 10], division is emitted without trap check, i - 3 can be 0
+	std::string body = source.substr(source.find("pcl_main"));
+	ASSERT_EQ(body.find("pcl_div("), std::string::npos);
+	ASSERT_NE(body.find(" / "), std::string::npos);
+	ASSERT_NE(body.find("pcl_rem("), std::string::npos);
+	ptree::delete_tree(result);
+}
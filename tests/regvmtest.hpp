@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/regvm.hpp"
+#include "programs.hpp"
+
+#include <string>
+
+TEST(RegisterVM, TreeOutputTest) {
+	for (ptree::Block *root : {programs::arithmetic(), programs::loops()}) {
+		ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+		int stacksize = memfunc.getmaxstacksize();
+		std::string expected = programs::run_tree(root, stacksize, "17 -5 4");
+		ASSERT_FALSE(expected.empty());
+
+		ptree::regcode::Program program = ptree::regcode::compile_tree(root);
+		ASSERT_EQ(program.code.back().op, ptree::regcode::Opcode::HALT);
+		ptree::RegisterVM machine;
+		ASSERT_EQ(programs::run(stacksize, "17 -5 4", [&](ptree::Stack *stack) { machine.run(program, stack); }), expected);
+		// machine keeps threaded code between runs, second run is the same
+		ASSERT_EQ(programs::run(stacksize, "17 -5 4", [&](ptree::Stack *stack) { machine.run(program, stack); }), expected);
+	}
+}
+
+TEST(RegisterVM, RegisterPressureTest) {
+	// v0 = -7; v1 = -4; ... v39 = 110; print (v0 * 2 + (v1 * 2 - (... (v39 * 2 + ?)))); print v39;
+	// left operands wait in temporary registers while the right operand is computed
+	using namespace programs;
+	const int count = 40;
+	std::vector<std::string> names;
+	for (int i = 0; i < count; ++i)
+		names.push_back("v" + std::to_string(i));
+	ptree::Block *root = new ptree::Block;
+	for (int i = 0; i < count; ++i)
+		root->push_expression(assign(names[i].c_str(), num(3 * i - 7)));
+	ptree::PTree *expr = bin(BinOpType::ADDITION, bin(BinOpType::MULTIPLICATION, var(names[count - 1].c_str()), num(2)), input());
+	for (int i = count - 2; i >= 0; --i)
+		expr = bin(i % 2 ? BinOpType::SUBTRACTION : BinOpType::ADDITION,
+			bin(BinOpType::MULTIPLICATION, var(names[i].c_str()), num(2)), expr);
+	root->push_expression(print(expr));
+	root->push_expression(print(var(names[count - 1].c_str())));
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	int stacksize = memfunc.getmaxstacksize();
+	ptree::regcode::Program program = ptree::regcode::compile_tree(root);
+	ASSERT_EQ(program.varcount, count);
+	ASSERT_GE(program.regcount - program.varcount - static_cast<int>(program.constants.size()), count - 1);
+	ptree::RegisterVM machine;
+	ASSERT_EQ(programs::run(stacksize, "1000", [&](ptree::Stack *stack) { machine.run(program, stack); }),
+		programs::run_tree(root, stacksize, "1000"));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/sccp.hpp"
+#include "programs.hpp"
+
+TEST(Sccp, BranchPruneTest) {
+	// i = 0; k = 3; s = 0; while (i < 10) { if (k > 5) s = s + ?; else s = s + k; i = i + 1; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("i", num(0)),
+		assign("k", num(3)),
+		assign("s", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(10)), block({
+			branch(bin(BinOpType::MORE, var("k"), num(5)),
+				block({assign("s", bin(BinOpType::ADDITION, var("s"), input()))}),
+				block({assign("s", bin(BinOpType::ADDITION, var("s"), var("k")))})),
+			assign("i", bin(BinOpType::ADDITION, var("i"), num(1))),
+		})),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::ConstantPropagation propagation(function);
+	propagation.run();
+	// k > 5 is false, arm with input is never executed
+	int unreachable = 0;
+	for (size_t b = 0; b < function.blocks.size(); ++b)
+		unreachable += !propagation.executable(b);
+	ASSERT_EQ(unreachable, 1);
+	ASSERT_EQ(propagation.getbranches(), 1);
+	ASSERT_GE(propagation.getconstants(), 1);
+
+	int stacksize = 0;
+	ptree::Block *rebuilt = ptree::ssa::rebuild_tree(function, stacksize);
+	ptree::Stack stack(stacksize);
+	rebuilt->execute(&stack);
+	int s;
+	// k is not stored any more, slots are compacted
+	stack.read(4, s);
+	ASSERT_EQ(s, 30);
+}
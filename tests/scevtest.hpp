@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/scev.hpp"
+#include "programs.hpp"
+
+TEST(Scev, CollapseTest) {
+	// s = 0; i = 3; while (i < 10) { s = s + i; i = i + 1; } p = s; while (p < 100) p = p * 2; print s;
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("s", num(0)),
+		assign("i", num(3)),
+		loop(bin(BinOpType::LESS, var("i"), num(10)), block({
+			assign("s", bin(BinOpType::ADDITION, var("s"), var("i"))),
+			assign("i", bin(BinOpType::ADDITION, var("i"), num(1))),
+		})),
+		assign("p", var("s")),
+		loop(bin(BinOpType::LESS, var("p"), num(100)), block({assign("p", bin(BinOpType::MULTIPLICATION, var("p"), num(2)))})),
+		print(var("s")),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::ScalarEvolution evolution(function);
+	evolution.run();
+	// p is not affine, its loop stays
+	ASSERT_EQ(evolution.getloops(), 2);
+	ASSERT_EQ(evolution.getcollapsed().size(), 1);
+	ASSERT_EQ(evolution.getcollapsed()[0], "s, i");
+
+	// s after 7 iterations is 3 + 4 + ... + 9
+	for (auto &instr : function.instrs) {
+		if (instr.block < 0 || instr.op != ptree::ssa::Op::PRINT)
+			continue;
+		const ptree::ssa::Instr &merged = function.instrs[instr.operands[0]];
+		ASSERT_EQ(merged.op, ptree::ssa::Op::PHI);
+		ASSERT_EQ(function.instrs[merged.operands[0]].op, ptree::ssa::Op::CONST);
+		ASSERT_EQ(function.instrs[merged.operands[0]].imm, 42);
+	}
+
+	int stacksize = 0;
+	ptree::Block *rebuilt = ptree::ssa::rebuild_tree(function, stacksize);
+	int loops = 0;
+	for (auto unit : rebuilt->operations)
+		loops += dynamic_cast<ptree::WhileBlk *>(unit) != nullptr;
+	ASSERT_EQ(loops, 1);
+}
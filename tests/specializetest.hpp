@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/specialize.hpp"
+#include "programs.hpp"
+
+#include <climits>
+
+TEST(Specialize, BindTest) {
+	// a = ?; print a + ?; while (a > 0) { a = ?; }
+	ptree::Block body;
+	body.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "a"),
+		new ptree::Reserved(nullptr, ptree::Reserved::Types::Input))));
+	ptree::Block root;
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Assign(nullptr, new ptree::NameInt(nullptr, 0, "a"),
+		new ptree::Reserved(nullptr, ptree::Reserved::Types::Input))));
+	root.push_expression(new ptree::Expression(nullptr, new ptree::Output(nullptr,
+		new ptree::BinOp(ptree::BinOpType::ADDITION, nullptr, new ptree::NameInt(nullptr, 0, "a"),
+			new ptree::Reserved(nullptr, ptree::Reserved::Types::Input)))));
+	root.push_expression(new ptree::WhileBlk(new ptree::Condition(nullptr,
+		new ptree::BinOp(ptree::BinOpType::MORE, nullptr, new ptree::NameInt(nullptr, 0, "a"), new ptree::Imidiate<int>(0))), nullptr, &body));
+
+	// input in loop is read unknown number of times, so the third value is not bound
+	ptree::Specializer specializer({4, 5, 6});
+	specializer.bind(&root);
+	ASSERT_EQ(specializer.getbound(), 2u);
+	ptree::manage_tree_mem(&root);
+	ptree::PclEmitter emitter;
+	ASSERT_EQ(emitter.emit(&root), "a = 4;\nprint a + 5;\nwhile (a > 0) {\n  a = ?;\n}\n");
+}
+
+TEST(Specialize, MaskTest) {
+	// a = ?; print a & INT_MAX; print a & 7; masks of strength reduction are written with arithmetic
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("a", input()),
+		print(bin(BinOpType::BIT_AND, var("a"), num(INT_MAX))),
+		print(bin(BinOpType::BIT_AND, var("a"), num(7))),
+	});
+	ptree::manage_tree_mem(root);
+	ptree::PclEmitter emitter;
+	ASSERT_EQ(emitter.emit(root), "a = ?;\nprint a - (a < 0) * (-2147483647 - 1);\nprint (a % 8) + ((a % 8) < 0) * 8;\n");
+}
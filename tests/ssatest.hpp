@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/ssa.hpp"
+#include "programs.hpp"
+
+TEST(Ssa, RoundTripTest) {
+	// a = 0; b = 1; i = 0; while (i < 10) { t = a; a = b; b = t + b; i++; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("a", num(0)),
+		assign("b", num(1)),
+		assign("i", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(10)), block({
+			assign("t", var("a")),
+			assign("a", var("b")),
+			assign("b", bin(BinOpType::ADDITION, var("t"), var("b"))),
+			inc("i"),
+		})),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	// loop header holds phis of a, b and i and dominates loop body
+	int header = function.blocks[0].succs[0];
+	int phis = 0;
+	for (int id : function.blocks[header].instrs)
+		phis += function.instrs[id].op == ptree::ssa::Op::PHI;
+	ASSERT_EQ(phis, 3);
+	ASSERT_TRUE(function.dominates(header, function.blocks[header].succs[0]));
+	ASSERT_FALSE(function.dominates(function.blocks[header].succs[0], header));
+
+	int stacksize = 0;
+	ptree::Block *rebuilt = ptree::ssa::rebuild_tree(function, stacksize);
+	ptree::Stack stack(stacksize);
+	rebuilt->execute(&stack);
+	// values of a and b leave the loop in slots of their variables
+	int a, b;
+	stack.read(0, a);
+	stack.read(4, b);
+	ASSERT_EQ(a, 55);
+	ASSERT_EQ(b, 89);
+}
@@ -17,19 +17,19 @@ TEST(MemManager, FunctionalTest) {
 	ASSERT_EQ(0, memfunc("a"));
 	ASSERT_EQ(4, memfunc("b"));
 	ASSERT_EQ(8, memfunc.getmaxstacksize());
-	ASSERT_EQ(8, memfunc.openscope());
+	ASSERT_EQ(8, memfunc.openscope().second);
 	ASSERT_EQ(8, memfunc("c"));
 	memfunc.closescope();
 	ASSERT_EQ(12, memfunc.getmaxstacksize());
 	ASSERT_EQ(8, memfunc("d"));
 	ASSERT_EQ(12, memfunc("e"));
-	ASSERT_EQ(16, memfunc.openscope());
+	ASSERT_EQ(16, memfunc.openscope().second);
 	memfunc.closescope();
-	ASSERT_EQ(16, memfunc.openscope());
+	ASSERT_EQ(16, memfunc.openscope().second);
 	ASSERT_EQ(16, memfunc("b"));
-	ASSERT_EQ(20, memfunc.openscope());
+	ASSERT_EQ(20, memfunc.openscope().second);
 	ASSERT_EQ(memfunc.getnameoffset("b"), 16);
-	ASSERT_EQ(20, memfunc.openscope());
+	ASSERT_EQ(20, memfunc.openscope().second);
 	memfunc.closescope();
 	memfunc.closescope();
 	ASSERT_EQ(memfunc.getnameoffset("b"), 16);
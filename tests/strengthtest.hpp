@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/strength.hpp"
+#include "programs.hpp"
+
+TEST(Strength, MagicTest) {
+	// Hacker's Delight, table 10-1
+	ptree::ssa::Magic magic = ptree::ssa::division_magic(7);
+	ASSERT_EQ(static_cast<unsigned>(magic.multiplier), 0x92492493u);
+	ASSERT_EQ(magic.shift, 2);
+	magic = ptree::ssa::division_magic(3);
+	ASSERT_EQ(static_cast<unsigned>(magic.multiplier), 0x55555556u);
+	ASSERT_EQ(magic.shift, 0);
+}
+
+TEST(Strength, ReduceTest) {
+	// s = 0; x = -50; while (x < 50) { s = s + x / 7 + x % 8 + x / -4 + x * 12; x = x + 1; }
+	using namespace programs;
+	ptree::PTree *sum = bin(BinOpType::ADDITION, var("s"), bin(BinOpType::DIVISION, var("x"), num(7)));
+	sum = bin(BinOpType::ADDITION, sum, bin(BinOpType::REMAINDER, var("x"), num(8)));
+	sum = bin(BinOpType::ADDITION, sum, bin(BinOpType::DIVISION, var("x"), num(-4)));
+	sum = bin(BinOpType::ADDITION, sum, bin(BinOpType::MULTIPLICATION, var("x"), num(12)));
+	ptree::Block *root = block({
+		assign("s", num(0)),
+		assign("x", num(-50)),
+		loop(bin(BinOpType::LESS, var("x"), num(50)), block({
+			assign("s", sum),
+			assign("x", bin(BinOpType::ADDITION, var("x"), num(1))),
+		})),
+	});
+
+	ptree::manage_tree_mem(root);
+	ptree::ssa::Function function = ptree::ssa::compile_tree(root);
+	ptree::ssa::StrengthReduction reduction(function);
+	reduction.run();
+	ASSERT_EQ(reduction.getinductions(), 1);
+	ASSERT_EQ(reduction.getrewritten(), 3);
+
+	int stacksize = 0;
+	ptree::Block *rebuilt = ptree::ssa::rebuild_tree(function, stacksize);
+	ptree::Stack stack(stacksize);
+	rebuilt->execute(&stack);
+	int expected = 0;
+	for (int x = -50; x < 50; ++x)
+		expected += x / 7 + x % 8 + x / -4 + x * 12;
+	int s;
+	stack.read(0, s);
+	ASSERT_EQ(s, expected);
+}
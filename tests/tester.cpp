@@ -4,3 +4,27 @@
 #include "leaftest.hpp"
 #include "nonleaftest.hpp"
 #include "stacktest.hpp"
+#include "vmtest.hpp"
+#include "regvmtest.hpp"
+#include "jittest.hpp"
+#include "closuretest.hpp"
+#include "cgentest.hpp"
+#include "evaltest.hpp"
+#include "quickentest.hpp"
+#include "tracetest.hpp"
+#include "tiertest.hpp"
+#include "llvmtest.hpp"
+#include "ssatest.hpp"
+#include "passtest.hpp"
+#include "foldtest.hpp"
+#include "sccptest.hpp"
+#include "dcetest.hpp"
+#include "licmtest.hpp"
+#include "strengthtest.hpp"
+#include "scevtest.hpp"
+#include "gvntest.hpp"
+#include "ifconvtest.hpp"
+#include "condtest.hpp"
+#include "specializetest.hpp"
+#include "profiletest.hpp"
+#include "rangetest.hpp"
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/tier.hpp"
+#include "programs.hpp"
+
+TEST(Tier, LoopReplacementTest) {
+	// s = 0; i = 0; while (i < 100000) { s = s + i % 3; i++; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("s", num(0)),
+		assign("i", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(100000)), block({
+			assign("s", bin(BinOpType::ADDITION, var("s"), bin(BinOpType::REMAINDER, var("i"), num(3)))),
+			inc("i"),
+		})),
+	});
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	ptree::Stack stack(memfunc.getmaxstacksize());
+	long regions = ptree::TierManager::regions;
+	ptree::TierManager::threshold = 10;
+	ptree::TierManager().run(root, &stack);
+	ptree::TierManager::wait();
+	ptree::TierManager::threshold = 0;
+	// loop switches to compiled code at any iteration, result does not depend on it
+	int s, i;
+	stack.read(0, s);
+	stack.read(4, i);
+	ASSERT_EQ(s, 99999);
+	ASSERT_EQ(i, 100000);
+	ASSERT_GT(ptree::TierManager::regions, regions);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/tracejit.hpp"
+#include "programs.hpp"
+
+TEST(TraceJit, SideTraceTest) {
+	// s = 0; i = 0; while (i < 100) { if (i % 2 == 0) s = s + i; else s = s - 1; i++; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("s", num(0)),
+		assign("i", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(100)), block({
+			branch(bin(BinOpType::EQUAL, bin(BinOpType::REMAINDER, var("i"), num(2)), num(0)),
+				block({assign("s", bin(BinOpType::ADDITION, var("s"), var("i")))}),
+				block({assign("s", bin(BinOpType::SUBTRACTION, var("s"), num(1)))})),
+			inc("i"),
+		})),
+	});
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	ptree::Stack stack(memfunc.getmaxstacksize());
+	int traces = ptree::LoopTrace::traces;
+	ptree::LoopTrace::threshold = 3;
+	ptree::TraceEngine().run(root, &stack);
+	ptree::LoopTrace::threshold = 0;
+	int s, i;
+	stack.read(0, s);
+	stack.read(4, i);
+	ASSERT_EQ(s, 2400);
+	ASSERT_EQ(i, 100);
+#ifdef PCL_JIT_X86_64
+	ASSERT_EQ(ptree::LoopTrace::traces, traces + 1);
+#endif
+}
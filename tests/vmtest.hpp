@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../modules/paracl/memory_manager.hpp"
+#include "../modules/paracl/vm.hpp"
+#include "programs.hpp"
+
+TEST(StackVM, LoopTest) {
+	// s = 0; i = 0; while (i < 10) { s = s + i; i++; }
+	ptree::Block *root = programs::sum(10);
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	ptree::bytecode::Program program = ptree::bytecode::compile_tree(root);
+	ASSERT_EQ(program.code.back().op, ptree::bytecode::Opcode::HALT);
+
+	ptree::Stack stack(memfunc.getmaxstacksize());
+	ptree::StackVM machine;
+	machine.run(program, &stack);
+	int s, i;
+	stack.read(0, s);
+	stack.read(4, i);
+	ASSERT_EQ(s, 45);
+	ASSERT_EQ(i, 10);
+}
+
+TEST(StackVM, SuperinstructionTest) {
+	// s = 0; i = 0; while (i < 10) { s = s + i; i = i + 1; }
+	using namespace programs;
+	ptree::Block *root = block({
+		assign("s", num(0)),
+		assign("i", num(0)),
+		loop(bin(BinOpType::LESS, var("i"), num(10)), block({
+			assign("s", bin(BinOpType::ADDITION, var("s"), var("i"))),
+			assign("i", bin(BinOpType::ADDITION, var("i"), num(1))),
+		})),
+	});
+
+	ptree::MemManager memfunc = ptree::manage_tree_mem(root);
+	ptree::bytecode::Program plain = ptree::bytecode::compile_tree(root);
+	ptree::bytecode::Program program = ptree::bytecode::fuse_superinstructions(plain);
+	ASSERT_LT(program.code.size(), plain.code.size());
+	// loop condition becomes single compare and branch to the end of program
+	ASSERT_EQ(program.code[2].op, ptree::bytecode::Opcode::JGE_VC);
+	ASSERT_EQ(program.code[2].arg, static_cast<int>(program.code.size()) - 1);
+
+	ptree::Stack stack(memfunc.getmaxstacksize());
+	ptree::StackVM machine;
+	machine.run(program, &stack);
+	int s, i;
+	stack.read(0, s);
+	stack.read(4, i);
+	ASSERT_EQ(s, 45);
+	ASSERT_EQ(i, 10);
+}